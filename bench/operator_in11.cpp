@@ -0,0 +1,206 @@
+/**
+ * @file operator_in11.cpp
+ * @brief Benchmark of the operator `in` of operator_in11.hpp against `std::find`.
+ *
+ * Every case looks up a value missing from a `std::vector` of 8, 16, 32 and 64-bit integers of several sizes,
+ * so the whole range is scanned, with `std::find` as the baseline. Results are printed as a table and optionally
+ * written as JSON, so they can be compared between releases.
+ *
+ * Usage: operator_in11_bench [--lookups N] [--sizes S1,S2,...] [--json FILE]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "epics/operator_in11.hpp"
+
+namespace
+{
+    using clock_type = std::chrono::steady_clock;
+
+    /**
+     * @brief Benchmark parameters.
+     */
+    struct options
+    {
+        std::size_t lookups = 0;                                        ///< The lookups per case, 0 to scale by size.
+        std::vector<std::size_t> sizes{16, 64, 256, 1024, 4096, 65536}; ///< The numbers of elements.
+        std::string json;                                               ///< The file to write the JSON results to.
+    };
+
+    /**
+     * @brief Result of a single case.
+     */
+    struct result
+    {
+        unsigned int bits; ///< The element width.
+        std::size_t size;  ///< The number of elements.
+        double find_ns;    ///< Nanoseconds per lookup with std::find.
+        double in_ns;      ///< Nanoseconds per lookup with the operator in.
+    };
+
+    volatile std::uint64_t g_missing = 0; ///< The value looked up, read anew for every lookup.
+
+    /**
+     * @brief Time a lookup.
+     *
+     * @tparam Lookup The lookup type, called with the value to look up.
+     * @param lookups The number of lookups.
+     * @param lookup The lookup.
+     * @return double Nanoseconds per lookup.
+     */
+    template<typename Lookup>
+    double measure(std::size_t lookups, Lookup lookup)
+    {
+        std::size_t found                  = 0;
+        const clock_type::time_point start = clock_type::now();
+        for (std::size_t i = 0; i < lookups; ++i)
+        {
+            found += lookup(g_missing) ? 1 : 0;
+        }
+        const double ns = std::chrono::duration<double, std::nano>(clock_type::now() - start).count();
+        if (found != 0)
+        {
+            std::fprintf(stderr, "Found a missing value\n");
+            std::exit(EXIT_FAILURE);
+        }
+        return ns / static_cast<double>(lookups);
+    }
+
+    /**
+     * @brief Run the cases of an element type.
+     *
+     * @tparam T The element type.
+     * @param opts The benchmark parameters.
+     * @param results Where to append the results.
+     */
+    template<typename T>
+    void bench_width(const options& opts, std::vector<result>& results)
+    {
+        for (std::size_t size : opts.sizes)
+        {
+            std::vector<T> v(size);
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                v[i] = static_cast<T>(i % 100 + 1);
+            }
+            const std::size_t lookups =
+                opts.lookups != 0 ? opts.lookups : std::max<std::size_t>(1000, (std::size_t{1} << 26) / size);
+
+            result r;
+            r.bits    = sizeof(T) * 8;
+            r.size    = size;
+            r.find_ns = measure(
+                lookups,
+                [&v](std::uint64_t x) { return std::find(v.begin(), v.end(), static_cast<T>(x)) != v.end(); }
+            );
+            r.in_ns = measure(lookups, [&v](std::uint64_t x) { return static_cast<T>(x) in v; });
+            results.push_back(r);
+        }
+    }
+
+    /**
+     * @brief Write the results as JSON.
+     *
+     * @param os The stream to write to.
+     * @param results The results.
+     */
+    void write_json(std::ostream& os, const std::vector<result>& results)
+    {
+        os << "{\n  \"benchmark\": \"operator_in11\",\n  \"results\": [";
+        for (std::size_t i = 0; i < results.size(); ++i)
+        {
+            const result& r = results[i];
+            os << (i == 0 ? "\n" : ",\n") << "    {\"bits\": " << r.bits << ", \"size\": " << r.size
+               << ", \"find_ns\": " << r.find_ns << ", \"in_ns\": " << r.in_ns
+               << ", \"speedup\": " << r.find_ns / r.in_ns << '}';
+        }
+        os << "\n  ]\n}\n";
+    }
+
+    /**
+     * @brief Parse the command line.
+     *
+     * @param argc The number of arguments.
+     * @param argv The arguments.
+     * @param opts Where to store the parameters.
+     * @return bool Whether the command line is valid.
+     */
+    bool parse_args(int argc, char** argv, options& opts)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+            if (i + 1 == argc)
+            {
+                return false;
+            }
+            const std::string val = argv[++i];
+            if (arg == "--lookups")
+            {
+                opts.lookups = std::stoul(val);
+            }
+            else if (arg == "--sizes")
+            {
+                opts.sizes.clear();
+                std::istringstream iss{val};
+                std::string size;
+                while (std::getline(iss, size, ','))
+                {
+                    opts.sizes.push_back(std::stoul(size));
+                }
+            }
+            else if (arg == "--json")
+            {
+                opts.json = val;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return !opts.sizes.empty() && std::find(opts.sizes.begin(), opts.sizes.end(), 0) == opts.sizes.end();
+    }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    options opts;
+    if (!parse_args(argc, argv, opts))
+    {
+        std::fprintf(stderr, "Usage: %s [--lookups N] [--sizes S1,S2,...] [--json FILE]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::vector<result> results;
+    bench_width<std::uint8_t>(opts, results);
+    bench_width<std::uint16_t>(opts, results);
+    bench_width<std::uint32_t>(opts, results);
+    bench_width<std::uint64_t>(opts, results);
+
+    std::printf("%6s %8s %12s %12s %9s\n", "bits", "size", "find ns", "in ns", "speedup");
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+        const result& r = results[i];
+        std::printf("%6u %8zu %12.1f %12.1f %8.2fx\n", r.bits, r.size, r.find_ns, r.in_ns, r.find_ns / r.in_ns);
+    }
+
+    if (!opts.json.empty())
+    {
+        std::ofstream json{opts.json};
+        write_json(json, results);
+        if (!json)
+        {
+            std::fprintf(stderr, "Couldn't write %s\n", opts.json.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,535 @@
+/**
+ * @file pstream17.cpp
+ * @brief Throughput and latency benchmark of the pstream17.hpp wrappers.
+ *
+ * Every case runs the same chains on 1 to N threads and for several message sizes, against raw per-thread
+ * streams and a plain `std::mutex` as the baselines. Results are printed as a table and optionally written
+ * as JSON, so they can be compared between releases.
+ *
+ * Usage: pstream17_bench [--threads N] [--messages M] [--sizes S1,S2,...] [--json FILE]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "epics/pstream17.hpp"
+#include "epics/pstream_lz17.hpp"
+
+namespace
+{
+    using clock_type = std::chrono::steady_clock;
+
+    /**
+     * @brief Benchmark parameters.
+     */
+    struct options
+    {
+        unsigned int max_threads = 0;            ///< The largest number of threads.
+        std::size_t messages     = 20000;        ///< The number of chains per thread.
+        std::vector<std::size_t> sizes{16, 256}; ///< The message payload sizes.
+        std::string json;                        ///< The file to write the JSON results to, if any.
+    };
+
+    /**
+     * @brief Result of a single run.
+     */
+    struct result
+    {
+        std::string name;         ///< The benchmark case.
+        unsigned int threads;     ///< The number of threads.
+        std::size_t message_size; ///< The payload size.
+        std::size_t messages;     ///< The total number of chains.
+        double seconds;           ///< The wall time.
+        std::uint64_t p50;        ///< The median chain latency in nanoseconds.
+        std::uint64_t p99;        ///< The 99th percentile chain latency in nanoseconds.
+        std::uint64_t p999;       ///< The 99.9th percentile chain latency in nanoseconds.
+    };
+
+    /**
+     * @brief Stream buffer discarding everything, stateless so any number of threads can write into it.
+     */
+    class null_streambuf: public std::streambuf
+    {
+    protected:
+        int_type overflow(int_type ch) override
+        {
+            return traits_type::not_eof(ch);
+        }
+
+        std::streamsize xsputn(const char*, std::streamsize n) override
+        {
+            return n;
+        }
+    };
+
+    /**
+     * @brief Run a chain on several threads at once, timing every chain.
+     *
+     * @tparam Op The chain type, called as `op(thread, index)`.
+     * @param name The benchmark case.
+     * @param threads The number of threads.
+     * @param message_size The payload size.
+     * @param messages The number of chains per thread.
+     * @param op The chain.
+     * @return result The result of the run.
+     */
+    template<typename Op>
+    result measure(std::string name, unsigned int threads, std::size_t message_size, std::size_t messages, Op op)
+    {
+        std::vector<std::vector<std::uint64_t>> latencies(threads);
+        std::atomic<unsigned int> ready{0};
+        std::atomic<bool> go{false};
+
+        std::vector<std::thread> workers;
+        workers.reserve(threads);
+        for (unsigned int t = 0; t < threads; ++t)
+        {
+            workers.emplace_back(
+                [&, t]()
+                {
+                    std::vector<std::uint64_t>& samples = latencies[t];
+                    samples.reserve(messages);
+                    ++ready;
+                    while (!go)
+                    {
+                        std::this_thread::yield();
+                    }
+                    for (std::size_t j = 0; j < messages; ++j)
+                    {
+                        const clock_type::time_point start = clock_type::now();
+                        op(t, j);
+                        samples.push_back(static_cast<std::uint64_t>(
+                            std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - start).count()
+                        ));
+                    }
+                }
+            );
+        }
+        while (ready != threads)
+        {
+            std::this_thread::yield();
+        }
+
+        const clock_type::time_point start = clock_type::now();
+        go                                 = true;
+        for (std::thread& w : workers)
+        {
+            w.join();
+        }
+        const double seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+
+        std::vector<std::uint64_t> all;
+        all.reserve(threads * messages);
+        for (const std::vector<std::uint64_t>& samples : latencies)
+        {
+            all.insert(all.end(), samples.begin(), samples.end());
+        }
+        std::sort(all.begin(), all.end());
+        const auto percentile = [&all](double p)
+        { return all.empty() ? 0 : all[std::min(all.size() - 1, static_cast<std::size_t>(p * all.size()))]; };
+
+        result res;
+        res.name         = std::move(name);
+        res.threads      = threads;
+        res.message_size = message_size;
+        res.messages     = threads * messages;
+        res.seconds      = seconds;
+        res.p50          = percentile(0.5);
+        res.p99          = percentile(0.99);
+        res.p999         = percentile(0.999);
+        return res;
+    }
+
+    /**
+     * @brief Run the output benchmark cases.
+     *
+     * @param threads The number of threads.
+     * @param size The payload size.
+     * @param messages The number of chains per thread.
+     * @param results Where to append the results.
+     */
+    void bench_output(unsigned int threads, std::size_t size, std::size_t messages, std::vector<result>& results)
+    {
+        const std::string payload(size, 'x');
+
+        {
+            std::vector<std::ostringstream> streams(threads);
+            results.push_back(measure(
+                "raw ostringstream per thread", threads, size, messages,
+                [&](unsigned int t, std::size_t j) { streams[t] << t << ' ' << j << ' ' << payload << '\n'; }
+            ));
+        }
+        {
+            std::ostringstream oss;
+            std::mutex mtx;
+            results.push_back(measure(
+                "std::mutex + ostringstream", threads, size, messages,
+                [&](unsigned int t, std::size_t j)
+                {
+                    std::lock_guard<std::mutex> lk{mtx};
+                    oss << t << ' ' << j << ' ' << payload << '\n';
+                }
+            ));
+        }
+        {
+            std::ostringstream oss;
+            eps::postream postream{oss};
+            results.push_back(measure(
+                "postream<ostringstream>", threads, size, messages,
+                [&](unsigned int t, std::size_t j) { postream << t << ' ' << j << ' ' << payload << '\n'; }
+            ));
+        }
+        {
+            std::ostringstream oss;
+            eps::postream<std::ostringstream, eps::ttas_lock> postream{oss};
+            results.push_back(measure(
+                "postream<ostringstream, ttas_lock>", threads, size, messages,
+                [&](unsigned int t, std::size_t j) { postream << t << ' ' << j << ' ' << payload << '\n'; }
+            ));
+        }
+        {
+            std::ostringstream oss;
+            eps::postream<std::ostringstream, eps::ticket_lock> postream{oss};
+            results.push_back(measure(
+                "postream<ostringstream, ticket_lock>", threads, size, messages,
+                [&](unsigned int t, std::size_t j) { postream << t << ' ' << j << ' ' << payload << '\n'; }
+            ));
+        }
+        {
+            std::ostringstream oss;
+            eps::postream<std::ostringstream, eps::mcs_lock> postream{oss};
+            results.push_back(measure(
+                "postream<ostringstream, mcs_lock>", threads, size, messages,
+                [&](unsigned int t, std::size_t j) { postream << t << ' ' << j << ' ' << payload << '\n'; }
+            ));
+        }
+        {
+            std::ostringstream oss;
+            eps::buffered_postream postream{oss};
+            results.push_back(measure(
+                "buffered_postream<ostringstream>", threads, size, messages,
+                [&](unsigned int t, std::size_t j) { postream << t << ' ' << j << ' ' << payload << '\n'; }
+            ));
+        }
+        {
+            std::ostringstream oss;
+            eps::try_postream postream{oss, eps::contention_policy::park};
+            results.push_back(measure(
+                "try_postream<ostringstream>", threads, size, messages,
+                [&](unsigned int t, std::size_t j) { postream << t << ' ' << j << ' ' << payload << '\n'; }
+            ));
+        }
+        {
+            std::ostringstream oss;
+            eps::binary_postream postream{oss};
+            results.push_back(measure(
+                "binary_postream<ostringstream>", threads, size, messages,
+                [&](unsigned int t, std::size_t j) { postream << t << ' ' << j << ' ' << payload << '\n'; }
+            ));
+        }
+        {
+            std::ostringstream oss;
+            eps::sampled_postream postream{eps::postream{oss}, eps::sample_every{1000}};
+            results.push_back(measure(
+                "sampled_postream, every 1000th", threads, size, messages,
+                [&](unsigned int t, std::size_t j) { postream << t << ' ' << j << ' ' << payload << '\n'; }
+            ));
+        }
+        {
+            std::ostringstream oss{std::ios_base::out | std::ios_base::binary};
+            eps::lz_ostream lz{oss};
+            eps::postream postream{lz};
+            results.push_back(measure(
+                "postream<lz_ostream>", threads, size, messages,
+                [&](unsigned int t, std::size_t j) { postream << t << ' ' << j << ' ' << payload << '\n'; }
+            ));
+        }
+        {
+            std::ostringstream oss;
+            eps::sharded_postream postream{oss};
+            results.push_back(measure(
+                "sharded_postream<ostringstream>", threads, size, messages,
+                [&](unsigned int t, std::size_t j) { postream << t << ' ' << j << ' ' << payload << '\n'; }
+            ));
+        }
+
+        // The standard output goes nowhere while it's measured
+        null_streambuf null;
+        std::streambuf* const cout_buf = std::cout.rdbuf(&null);
+        {
+            std::mutex mtx;
+            results.push_back(measure(
+                "std::mutex + cout", threads, size, messages,
+                [&](unsigned int t, std::size_t j)
+                {
+                    std::lock_guard<std::mutex> lk{mtx};
+                    std::cout << t << ' ' << j << ' ' << payload << '\n';
+                }
+            ));
+        }
+        results.push_back(measure(
+            "pcout", threads, size, messages,
+            [&](unsigned int t, std::size_t j) { eps::pcout << t << ' ' << j << ' ' << payload << '\n'; }
+        ));
+        std::cout.rdbuf(cout_buf);
+    }
+
+    /**
+     * @brief Run the input benchmark cases.
+     *
+     * @param threads The number of threads.
+     * @param size The size of the read strings.
+     * @param messages The number of chains per thread.
+     * @param results Where to append the results.
+     */
+    void bench_input(unsigned int threads, std::size_t size, std::size_t messages, std::vector<result>& results)
+    {
+        std::string data;
+        data.reserve(messages * (size + 8));
+        for (std::size_t j = 0; j < messages; ++j)
+        {
+            data += std::to_string(j);
+            data += ' ';
+            data.append(size, 'x');
+            data += '\n';
+        }
+        std::string all_data;
+        all_data.reserve(threads * data.size());
+        for (unsigned int t = 0; t < threads; ++t)
+        {
+            all_data += data;
+        }
+
+        {
+            std::vector<std::istringstream> streams;
+            streams.reserve(threads);
+            for (unsigned int t = 0; t < threads; ++t)
+            {
+                streams.emplace_back(data);
+            }
+            std::vector<std::string> words(threads);
+            std::vector<std::size_t> numbers(threads);
+            results.push_back(measure(
+                "raw istringstream per thread", threads, size, messages,
+                [&](unsigned int t, std::size_t) { streams[t] >> numbers[t] >> words[t]; }
+            ));
+        }
+        {
+            std::istringstream iss{all_data};
+            std::mutex mtx;
+            std::vector<std::string> words(threads);
+            std::vector<std::size_t> numbers(threads);
+            results.push_back(measure(
+                "std::mutex + istringstream", threads, size, messages,
+                [&](unsigned int t, std::size_t)
+                {
+                    std::lock_guard<std::mutex> lk{mtx};
+                    iss >> numbers[t] >> words[t];
+                }
+            ));
+        }
+        {
+            std::istringstream iss{all_data};
+            eps::pistream pistream{iss};
+            std::vector<std::string> words(threads);
+            std::vector<std::size_t> numbers(threads);
+            results.push_back(measure(
+                "pistream<istringstream>", threads, size, messages,
+                [&](unsigned int t, std::size_t) { pistream >> numbers[t] >> words[t]; }
+            ));
+        }
+        {
+            std::istringstream iss{all_data};
+            eps::chunked_pistream reader{iss, 4096};
+            std::vector<eps::pistream_chunk<char>> chunks(threads);
+            std::vector<std::string_view> rests(threads);
+            std::vector<std::string> words(threads);
+            std::vector<std::size_t> numbers(threads);
+            results.push_back(measure(
+                "chunked_pistream<istringstream>", threads, size, messages,
+                [&](unsigned int t, std::size_t)
+                {
+                    // Records are parsed from the chunk the thread holds, outside the lock
+                    std::string_view& rest = rests[t];
+                    if (rest.empty())
+                    {
+                        if (!reader.next(chunks[t]))
+                        {
+                            return;
+                        }
+                        rest = chunks[t].view();
+                    }
+                    const std::size_t end         = rest.find('\n');
+                    const std::string_view record = rest.substr(0, end);
+                    rest.remove_prefix(end == std::string_view::npos ? rest.size() : end + 1);
+
+                    const std::size_t space = record.find(' ');
+                    std::from_chars(record.data(), record.data() + space, numbers[t]);
+                    words[t].assign(record.substr(space + 1));
+                }
+            ));
+        }
+    }
+
+    /**
+     * @brief Escape a string for JSON.
+     *
+     * @param s The string.
+     * @return std::string The quoted string.
+     */
+    std::string json_string(const std::string& s)
+    {
+        std::string res = "\"";
+        for (char c : s)
+        {
+            if (c == '"' || c == '\\')
+            {
+                res += '\\';
+            }
+            res += c;
+        }
+        return res + '"';
+    }
+
+    /**
+     * @brief Write the results as JSON.
+     *
+     * @param os The stream to write to.
+     * @param opts The benchmark parameters.
+     * @param results The results.
+     */
+    void write_json(std::ostream& os, const options& opts, const std::vector<result>& results)
+    {
+        os << "{\n  \"benchmark\": \"pstream17\",\n  \"hardware_concurrency\": " << std::thread::hardware_concurrency()
+           << ",\n  \"messages_per_thread\": " << opts.messages << ",\n  \"results\": [";
+        for (std::size_t i = 0; i < results.size(); ++i)
+        {
+            const result& r = results[i];
+            os << (i == 0 ? "\n" : ",\n") << "    {\"case\": " << json_string(r.name) << ", \"threads\": " << r.threads
+               << ", \"message_size\": " << r.message_size << ", \"messages\": " << r.messages
+               << ", \"seconds\": " << r.seconds << ", \"messages_per_second\": " << r.messages / r.seconds
+               << ", \"p50_ns\": " << r.p50 << ", \"p99_ns\": " << r.p99 << ", \"p999_ns\": " << r.p999 << '}';
+        }
+        os << "\n  ]\n}\n";
+    }
+
+    /**
+     * @brief Parse the command line.
+     *
+     * @param argc The number of arguments.
+     * @param argv The arguments.
+     * @param opts Where to store the parameters.
+     * @return bool Whether the command line is valid.
+     */
+    bool parse_args(int argc, char** argv, options& opts)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+            if (i + 1 == argc)
+            {
+                return false;
+            }
+            const std::string val = argv[++i];
+            if (arg == "--threads")
+            {
+                opts.max_threads = static_cast<unsigned int>(std::stoul(val));
+            }
+            else if (arg == "--messages")
+            {
+                opts.messages = std::stoul(val);
+            }
+            else if (arg == "--sizes")
+            {
+                opts.sizes.clear();
+                std::istringstream iss{val};
+                std::string size;
+                while (std::getline(iss, size, ','))
+                {
+                    opts.sizes.push_back(std::stoul(size));
+                }
+            }
+            else if (arg == "--json")
+            {
+                opts.json = val;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return opts.messages != 0 && !opts.sizes.empty();
+    }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    options opts;
+    if (!parse_args(argc, argv, opts))
+    {
+        std::fprintf(stderr, "Usage: %s [--threads N] [--messages M] [--sizes S1,S2,...] [--json FILE]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (opts.max_threads == 0)
+    {
+        opts.max_threads = std::max(4u, std::thread::hardware_concurrency());
+    }
+
+    std::vector<unsigned int> thread_counts;
+    for (unsigned int threads = 1; threads < opts.max_threads; threads *= 2)
+    {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(opts.max_threads);
+
+    std::vector<result> results;
+    std::printf(
+        "%-36s %7s %6s %14s %10s %10s %10s\n", "case", "threads", "size", "msg/s", "p50 ns", "p99 ns", "p999 ns"
+    );
+    for (std::size_t size : opts.sizes)
+    {
+        for (unsigned int threads : thread_counts)
+        {
+            const std::size_t first = results.size();
+            bench_output(threads, size, opts.messages, results);
+            bench_input(threads, size, opts.messages, results);
+            for (std::size_t i = first; i < results.size(); ++i)
+            {
+                const result& r = results[i];
+                std::printf(
+                    "%-36s %7u %6zu %14.0f %10llu %10llu %10llu\n", r.name.c_str(), r.threads, r.message_size,
+                    r.messages / r.seconds, static_cast<unsigned long long>(r.p50),
+                    static_cast<unsigned long long>(r.p99), static_cast<unsigned long long>(r.p999)
+                );
+            }
+            std::fflush(stdout);
+        }
+    }
+
+    if (!opts.json.empty())
+    {
+        std::ofstream json{opts.json};
+        write_json(json, opts, results);
+        if (!json)
+        {
+            std::fprintf(stderr, "Couldn't write %s\n", opts.json.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
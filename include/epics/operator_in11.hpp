@@ -11,6 +11,45 @@
 #define EPICS_OPERATOR_IN11_HPP
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if !defined(EPS_IN_NO_SIMD) && (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+/// @cond SHOW_INTERNAL
+#include <immintrin.h>
+
+#define EPS_IN_X86_KERNELS      1
+#define EPS_IN_TARGET(features) __attribute__((target(features)))
+/// @endcond
+#else
+#define EPS_IN_X86_KERNELS 0
+#endif
+
+/// @cond SHOW_INTERNAL
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#define EPS_IN_CXX14 1
+#define EPS_IN_CXX17 1
+#elif __cplusplus >= 201402L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201402L)
+#define EPS_IN_CXX14 1
+#define EPS_IN_CXX17 0
+#else
+#define EPS_IN_CXX14 0
+#define EPS_IN_CXX17 0
+#endif
+/// @endcond
 
 /**
  * @brief Namespace for EPICS library.
@@ -32,15 +71,588 @@ namespace eps
          *
          * @param val The value reference.
          */
-        __operator_in_lhs(const T& val): val{val}
+        constexpr __operator_in_lhs(const T& val): val{val}
         {}
 
         const T& val; ///< The value reference
     };
 
+    /**
+     * @brief Overload rank of the lookups, the lookup with the highest rank available for a container is used.
+     *
+     * @tparam N The rank.
+     */
+    template<unsigned int N>
+    struct __in_rank: __in_rank<N - 1>
+    {};
+
+    /**
+     * @brief The lowest overload rank.
+     */
+    template<>
+    struct __in_rank<0>
+    {};
+
+    /**
+     * @brief Maps any types to void, to detect member types and expressions in partial specializations.
+     */
+    template<typename...>
+    struct __in_void
+    {
+        typedef void type; ///< Always void.
+    };
+
+    /**
+     * @brief Holds a single key, see __in_converts_exactly.
+     *
+     * @tparam K The key type.
+     */
+    template<typename K>
+    struct __in_key_holder
+    {
+        K key[1]; ///< The key.
+    };
+
+    /**
+     * @brief Whether a value of type T converts to K implicitly and without narrowing, so looking it up among
+     * K finds what comparing it with K would.
+     *
+     * @tparam T The value type.
+     * @tparam K The key type.
+     */
+    template<typename T, typename K, typename = void>
+    struct __in_converts_exactly: std::false_type
+    {};
+
+    template<typename T, typename K>
+    struct __in_converts_exactly<T, K, decltype(static_cast<void>(__in_key_holder<K>{{std::declval<const T&>()}}))>
+        : std::true_type
+    {};
+
+    /**
+     * @brief Whether the comparator or the hash and equality of an associative container are transparent.
+     *
+     * @tparam C The container type.
+     */
+    template<typename C, typename = void>
+    struct __in_transparent: std::false_type
+    {};
+
+    template<typename C>
+    struct __in_transparent<C, typename __in_void<typename C::key_compare::is_transparent>::type>: std::true_type
+    {};
+
+    template<typename C>
+    struct __in_transparent<
+        C, typename __in_void<typename C::hasher::is_transparent, typename C::key_equal::is_transparent>::type>
+        : std::true_type
+    {};
+
+    /**
+     * @brief Whether a value of type T is a string with the characters of the string type C.
+     *
+     * @tparam T The value type.
+     * @tparam C The string type.
+     */
+    template<typename T, typename C, typename = void>
+    struct __in_string_like
+        : std::integral_constant<
+              bool,
+              std::is_same<typename std::decay<T>::type, const typename C::value_type*>::value ||
+                  std::is_same<typename std::decay<T>::type, typename C::value_type*>::value>
+    {};
+
+    template<typename T, typename C>
+    struct __in_string_like<T, C, typename __in_void<typename T::value_type, typename T::traits_type>::type>
+        : std::integral_constant<
+              bool,
+              std::is_same<typename T::value_type, typename C::value_type>::value &&
+                  std::is_same<typename T::traits_type, typename C::traits_type>::value>
+    {};
+
+    /**
+     * @brief Whether a string type's own `find()` looks values of type T up, i.e. T is its character type or a
+     * string of its characters. Otherwise it's a container without a lookup of its own.
+     *
+     * @tparam T The value type.
+     * @tparam C The container type.
+     */
+    template<typename T, typename C, typename = void>
+    struct __in_string_lookup_applies: std::true_type
+    {};
+
+    template<typename T, typename C>
+    struct __in_string_lookup_applies<T, C, typename __in_void<decltype(C::npos), typename C::value_type>::type>
+        : std::integral_constant<
+              bool,
+              __in_converts_exactly<T, typename C::value_type>::value || __in_string_like<T, C>::value>
+    {};
+
+    /**
+     * @brief Whether the container's own lookup finds a value of type T exactly if comparing the value with
+     * its elements would, i.e. the value converts to the key type without narrowing or the lookup is
+     * transparent. For instance, `3.5` isn't looked up in a `std::set<int>` with the set's `find()`, which
+     * would look `3` up. The lookups of containers without a key type are used as they are.
+     *
+     * @tparam T The value type.
+     * @tparam C The container type.
+     */
+    template<typename T, typename C, typename = void>
+    struct __in_own_lookup_applies: __in_string_lookup_applies<T, C>
+    {};
+
+    template<typename T, typename C>
+    struct __in_own_lookup_applies<T, C, typename __in_void<typename C::key_type>::type>
+        : std::integral_constant<
+              bool,
+              __in_converts_exactly<T, typename C::key_type>::value || __in_transparent<C>::value>
+    {};
+
+    /**
+     * @brief Looks a value up with the container's own `contains()`, e.g. of C++20 associative containers.
+     *
+     * @tparam T The value type.
+     * @tparam C The container type.
+     * @param val The value.
+     * @param c The container.
+     * @return bool If the value occurs in the container.
+     */
+    template<typename T, typename C>
+    auto __in(const T& val, const C& c, __in_rank<5>) -> typename std::enable_if<
+        __in_own_lookup_applies<T, C>::value,
+        decltype(static_cast<bool>(c.contains(val)))>::type
+    {
+        return static_cast<bool>(c.contains(val));
+    }
+
+    /**
+     * @brief Looks a value up with the container's own `find()` returning a position, e.g. of `std::basic_string`.
+     *
+     * @tparam T The value type.
+     * @tparam C The container type.
+     * @param val The value.
+     * @param c The container.
+     * @return bool If the value occurs in the container.
+     */
+    template<typename T, typename C>
+    auto __in(const T& val, const C& c, __in_rank<4>) -> typename std::enable_if<
+        __in_own_lookup_applies<T, C>::value,
+        decltype(static_cast<bool>(c.find(val) != C::npos))>::type
+    {
+        return c.find(val) != C::npos;
+    }
+
+    /**
+     * @brief Looks a value up with the container's own `find()` returning an iterator, e.g. of associative and
+     * unordered containers.
+     *
+     * @tparam T The value type.
+     * @tparam C The container type.
+     * @param val The value.
+     * @param c The container.
+     * @return bool If the value occurs in the container.
+     */
+    template<typename T, typename C>
+    auto __in(const T& val, const C& c, __in_rank<3>) -> typename std::enable_if<
+        __in_own_lookup_applies<T, C>::value,
+        decltype(static_cast<bool>(c.find(val) != c.end()))>::type
+    {
+        return c.find(val) != c.end();
+    }
+
+    /**
+     * @brief Looks a value up with the container's own `count()`.
+     *
+     * @tparam T The value type.
+     * @tparam C The container type.
+     * @param val The value.
+     * @param c The container.
+     * @return bool If the value occurs in the container.
+     */
+    template<typename T, typename C>
+    auto __in(const T& val, const C& c, __in_rank<2>) -> typename std::enable_if<
+        __in_own_lookup_applies<T, C>::value,
+        decltype(static_cast<bool>(c.count(val) != 0))>::type
+    {
+        return c.count(val) != 0;
+    }
+
+    /**
+     * @brief Unsigned integer type of a given size.
+     *
+     * @tparam W The size in bytes, 1, 2, 4 or 8.
+     */
+    template<std::size_t W>
+    struct __in_uint
+    {
+        typedef typename std::conditional<
+            W == 1, std::uint8_t,
+            typename std::conditional<
+                W == 2, std::uint16_t,
+                typename std::conditional<W == 4, std::uint32_t, std::uint64_t>::type>::type>::type
+            type; ///< The integer type.
+    };
+
+    /**
+     * @brief Whether a value of type T is looked up in a contiguous range of E with the membership kernels,
+     * i.e. both are the same integral or enumeration type, so they are equal exactly if their object
+     * representations are.
+     *
+     * @tparam T The value type.
+     * @tparam E The element type, possibly a cv-qualified reference.
+     */
+    template<typename T, typename E>
+    struct __in_kernel_eligible
+    {
+        typedef typename std::remove_cv<typename std::remove_reference<E>::type>::type element_type; ///< Bare E.
+
+        static constexpr bool value =
+            std::is_same<typename std::remove_cv<T>::type, element_type>::value &&
+            (std::is_integral<element_type>::value || std::is_enum<element_type>::value) &&
+            (sizeof(element_type) == 1 || sizeof(element_type) == 2 || sizeof(element_type) == 4 ||
+             sizeof(element_type) == 8); ///< Whether the kernels are used.
+    };
+
+    /**
+     * @brief Membership kernel signature.
+     *
+     * @param p The elements, not necessarily aligned.
+     * @param n The number of elements.
+     * @param v The object representation of the value looked up, zero-extended.
+     * @return bool If the value occurs in the elements.
+     */
+    typedef bool (*__in_kernel)(const char* p, std::size_t n, std::uint64_t v);
+
+    /**
+     * @brief Scalar membership kernel, comparing one element at a time.
+     *
+     * @tparam W The element size in bytes.
+     */
+    template<std::size_t W>
+    bool __in_find_scalar(const char* p, std::size_t n, std::uint64_t v)
+    {
+        typedef typename __in_uint<W>::type uint_t;
+
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            uint_t x;
+            std::memcpy(&x, p + i * W, W);
+            if (x == static_cast<uint_t>(v))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+#if EPS_IN_X86_KERNELS
+    /**
+     * @brief Broadcast a value to the W-byte lanes of an SSE2 register.
+     *
+     * @tparam W The lane size in bytes.
+     * @param v The value.
+     * @return __m128i The register.
+     */
+    template<std::size_t W>
+    EPS_IN_TARGET("sse2") inline __m128i __in_set1_sse2(std::uint64_t v)
+    {
+        return W == 1 ? _mm_set1_epi8(static_cast<char>(v))
+             : W == 2 ? _mm_set1_epi16(static_cast<short>(v))
+             : W == 4 ? _mm_set1_epi32(static_cast<int>(v))
+                      : _mm_set1_epi64x(static_cast<long long>(v));
+    }
+
+    /**
+     * @brief Compare the W-byte lanes of two SSE2 registers.
+     *
+     * SSE2 has no 64-bit comparison, 64-bit lanes are equal if both their 32-bit halves are.
+     *
+     * @tparam W The lane size in bytes.
+     * @param a The first register.
+     * @param b The second register.
+     * @return __m128i All ones in the equal lanes.
+     */
+    template<std::size_t W>
+    EPS_IN_TARGET("sse2") inline __m128i __in_cmpeq_sse2(__m128i a, __m128i b)
+    {
+        return W == 1 ? _mm_cmpeq_epi8(a, b)
+             : W == 2 ? _mm_cmpeq_epi16(a, b)
+             : W == 4 ? _mm_cmpeq_epi32(a, b)
+                      : _mm_and_si128(
+                            _mm_cmpeq_epi32(a, b), _mm_shuffle_epi32(_mm_cmpeq_epi32(a, b), _MM_SHUFFLE(2, 3, 0, 1))
+                        );
+    }
+
+    /**
+     * @brief SSE2 membership kernel, comparing 64 bytes of elements per iteration.
+     *
+     * @tparam W The element size in bytes.
+     */
+    template<std::size_t W>
+    EPS_IN_TARGET("sse2") bool __in_find_sse2(const char* p, std::size_t n, std::uint64_t v)
+    {
+        const std::size_t per = 16 / W;
+        const __m128i needle  = __in_set1_sse2<W>(v);
+
+        std::size_t i = 0;
+        for (; i + 4 * per <= n; i += 4 * per)
+        {
+            const __m128i* q = reinterpret_cast<const __m128i*>(p + i * W);
+            const __m128i a  = _mm_or_si128(
+                __in_cmpeq_sse2<W>(_mm_loadu_si128(q), needle), __in_cmpeq_sse2<W>(_mm_loadu_si128(q + 1), needle)
+            );
+            const __m128i b = _mm_or_si128(
+                __in_cmpeq_sse2<W>(_mm_loadu_si128(q + 2), needle), __in_cmpeq_sse2<W>(_mm_loadu_si128(q + 3), needle)
+            );
+            if (_mm_movemask_epi8(_mm_or_si128(a, b)) != 0)
+            {
+                return true;
+            }
+        }
+        for (; i + per <= n; i += per)
+        {
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i * W));
+            if (_mm_movemask_epi8(__in_cmpeq_sse2<W>(a, needle)) != 0)
+            {
+                return true;
+            }
+        }
+        return __in_find_scalar<W>(p + i * W, n - i, v);
+    }
+
+    /**
+     * @brief Broadcast a value to the W-byte lanes of an AVX2 register.
+     *
+     * @tparam W The lane size in bytes.
+     * @param v The value.
+     * @return __m256i The register.
+     */
+    template<std::size_t W>
+    EPS_IN_TARGET("avx2") inline __m256i __in_set1_avx2(std::uint64_t v)
+    {
+        return W == 1 ? _mm256_set1_epi8(static_cast<char>(v))
+             : W == 2 ? _mm256_set1_epi16(static_cast<short>(v))
+             : W == 4 ? _mm256_set1_epi32(static_cast<int>(v))
+                      : _mm256_set1_epi64x(static_cast<long long>(v));
+    }
+
+    /**
+     * @brief Compare the W-byte lanes of two AVX2 registers.
+     *
+     * @tparam W The lane size in bytes.
+     * @param a The first register.
+     * @param b The second register.
+     * @return __m256i All ones in the equal lanes.
+     */
+    template<std::size_t W>
+    EPS_IN_TARGET("avx2") inline __m256i __in_cmpeq_avx2(__m256i a, __m256i b)
+    {
+        return W == 1 ? _mm256_cmpeq_epi8(a, b)
+             : W == 2 ? _mm256_cmpeq_epi16(a, b)
+             : W == 4 ? _mm256_cmpeq_epi32(a, b)
+                      : _mm256_cmpeq_epi64(a, b);
+    }
+
+    /**
+     * @brief AVX2 membership kernel, comparing 128 bytes of elements per iteration.
+     *
+     * @tparam W The element size in bytes.
+     */
+    template<std::size_t W>
+    EPS_IN_TARGET("avx2") bool __in_find_avx2(const char* p, std::size_t n, std::uint64_t v)
+    {
+        const std::size_t per = 32 / W;
+        const __m256i needle  = __in_set1_avx2<W>(v);
+
+        std::size_t i = 0;
+        for (; i + 4 * per <= n; i += 4 * per)
+        {
+            const __m256i* q = reinterpret_cast<const __m256i*>(p + i * W);
+            const __m256i a  = _mm256_or_si256(
+                __in_cmpeq_avx2<W>(_mm256_loadu_si256(q), needle),
+                __in_cmpeq_avx2<W>(_mm256_loadu_si256(q + 1), needle)
+            );
+            const __m256i b = _mm256_or_si256(
+                __in_cmpeq_avx2<W>(_mm256_loadu_si256(q + 2), needle),
+                __in_cmpeq_avx2<W>(_mm256_loadu_si256(q + 3), needle)
+            );
+            if (!_mm256_testz_si256(_mm256_or_si256(a, b), _mm256_or_si256(a, b)))
+            {
+                return true;
+            }
+        }
+        for (; i + per <= n; i += per)
+        {
+            const __m256i a =
+                __in_cmpeq_avx2<W>(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i * W)), needle);
+            if (!_mm256_testz_si256(a, a))
+            {
+                return true;
+            }
+        }
+        return __in_find_scalar<W>(p + i * W, n - i, v);
+    }
+
+    /**
+     * @brief Compare the W-byte lanes of an AVX-512 register with a value.
+     *
+     * @tparam W The lane size in bytes.
+     * @param a The register.
+     * @param v The value.
+     * @return std::uint64_t The bits of the equal lanes.
+     */
+    template<std::size_t W>
+    EPS_IN_TARGET("avx512f,avx512bw") inline std::uint64_t __in_cmpeq_avx512(__m512i a, std::uint64_t v)
+    {
+        return W == 1 ? _mm512_cmpeq_epi8_mask(a, _mm512_set1_epi8(static_cast<char>(v)))
+             : W == 2 ? _mm512_cmpeq_epi16_mask(a, _mm512_set1_epi16(static_cast<short>(v)))
+             : W == 4 ? _mm512_cmpeq_epi32_mask(a, _mm512_set1_epi32(static_cast<int>(v)))
+                      : _mm512_cmpeq_epi64_mask(a, _mm512_set1_epi64(static_cast<long long>(v)));
+    }
+
+    /**
+     * @brief AVX-512 membership kernel, comparing 256 bytes of elements per iteration and the tail with a
+     * masked load.
+     *
+     * @tparam W The element size in bytes.
+     */
+    template<std::size_t W>
+    EPS_IN_TARGET("avx512f,avx512bw") bool __in_find_avx512(const char* p, std::size_t n, std::uint64_t v)
+    {
+        const std::size_t per = 64 / W;
+
+        std::size_t i = 0;
+        for (; i + 4 * per <= n; i += 4 * per)
+        {
+            const char* q = p + i * W;
+            if ((__in_cmpeq_avx512<W>(_mm512_loadu_si512(q), v) | __in_cmpeq_avx512<W>(_mm512_loadu_si512(q + 64), v) |
+                 __in_cmpeq_avx512<W>(_mm512_loadu_si512(q + 128), v) |
+                 __in_cmpeq_avx512<W>(_mm512_loadu_si512(q + 192), v)) != 0)
+            {
+                return true;
+            }
+        }
+        for (; i + per <= n; i += per)
+        {
+            if (__in_cmpeq_avx512<W>(_mm512_loadu_si512(p + i * W), v) != 0)
+            {
+                return true;
+            }
+        }
+        if (i == n)
+        {
+            return false;
+        }
+        // The lanes past the end are loaded as zeros, so they are masked out of the comparison as well
+        const std::uint64_t lanes = (std::uint64_t{1} << (n - i)) - 1;
+        const __m512i tail        = _mm512_maskz_loadu_epi8((std::uint64_t{1} << ((n - i) * W)) - 1, p + i * W);
+        return (__in_cmpeq_avx512<W>(tail, v) & lanes) != 0;
+    }
+
+    /**
+     * @brief Choose the widest membership kernel the processor supports.
+     *
+     * @tparam W The element size in bytes.
+     * @return __in_kernel The kernel.
+     */
+    template<std::size_t W>
+    __in_kernel __in_select_kernel()
+    {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512bw"))
+        {
+            return &__in_find_avx512<W>;
+        }
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return &__in_find_avx2<W>;
+        }
+        return &__in_find_sse2<W>;
+    }
+#endif
+
+    /**
+     * @brief Looks a value up in contiguous elements with the widest membership kernel the processor supports.
+     *
+     * Short ranges are searched with std::find, which is faster than calling a kernel for them.
+     *
+     * @tparam T The value type, also the element type.
+     * @param val The value.
+     * @param data The elements.
+     * @param n The number of elements.
+     * @return bool If the value occurs in the elements.
+     */
+    template<typename T>
+    bool __in_find_contiguous(const T& val, const T* data, std::size_t n)
+    {
+#if EPS_IN_X86_KERNELS
+        if (n * sizeof(T) >= 64)
+        {
+            static const __in_kernel kernel = __in_select_kernel<sizeof(T)>();
+
+            typename __in_uint<sizeof(T)>::type v;
+            std::memcpy(&v, &val, sizeof(T));
+            return kernel(reinterpret_cast<const char*>(data), n, v);
+        }
+#endif
+        return std::find(data, data + n, val) != data + n;
+    }
+
+    /**
+     * @brief Looks a value up in a contiguous container of integers or enumerators with a membership kernel,
+     * e.g. in `std::vector` or `std::array`.
+     *
+     * @tparam T The value type.
+     * @tparam C The container type.
+     * @param val The value.
+     * @param c The container.
+     * @return bool If the value occurs in the container.
+     */
+    template<typename T, typename C>
+    auto __in(const T& val, const C& c, __in_rank<1>) ->
+        typename std::enable_if<__in_kernel_eligible<T, decltype(*c.data())>::value, bool>::type
+    {
+        return __in_find_contiguous<typename std::remove_cv<T>::type>(val, c.data(), c.size());
+    }
+
+    /**
+     * @brief Looks a value up in a C-style array of integers or enumerators with a membership kernel.
+     *
+     * @tparam T The value type.
+     * @tparam E The element type.
+     * @tparam N The number of elements.
+     * @param val The value.
+     * @param c The array.
+     * @return bool If the value occurs in the array.
+     */
+    template<typename T, typename E, std::size_t N>
+    auto __in(const T& val, const E (&c)[N], __in_rank<1>) ->
+        typename std::enable_if<__in_kernel_eligible<T, E>::value, bool>::type
+    {
+        return __in_find_contiguous<typename std::remove_cv<T>::type>(val, c, N);
+    }
+
+    /**
+     * @brief Looks a value up with a linear search, for containers without a lookup of their own.
+     *
+     * @tparam T The value type.
+     * @tparam C The container type.
+     * @param val The value.
+     * @param c The container.
+     * @return bool If the value occurs in the container.
+     */
+    template<typename T, typename C>
+    bool __in(const T& val, const C& c, __in_rank<0>)
+    {
+        return std::find(std::begin(c), std::end(c), val) != std::end(c);
+    }
+
     /**
      * @brief Checks whether a value from __operator_in_lhs<T> occurs in a container.
      *
+     * Uses the container's own lookup if it has one, i.e. `contains()`, `find()` or `count()`,
+     * a SIMD membership kernel for contiguous containers of integers or enumerators and a linear search otherwise.
+     *
      * @tparam T The value type.
      * @tparam C The container type.
      * @param lhs __operator_in_lhs<T> struct hosting the value.
@@ -50,30 +662,1896 @@ namespace eps
     template<typename T, typename C>
     bool operator|(__operator_in_lhs<T> lhs, const C& c)
     {
-        return std::find(std::begin(c), std::end(c), lhs.val) != std::end(c);
+        return __in(lhs.val, c, __in_rank<5>{});
     }
 
     /**
-     * @brief Intermediate struct hosting the operator to wrap a value into __operator_in_lhs.
+     * @brief Less-than comparison of values of any types.
      */
-    struct __operator_in
-    {};
+    struct __in_less
+    {
+        /**
+         * @brief Compare two values.
+         *
+         * @tparam T The type of the first value.
+         * @tparam U The type of the second value.
+         * @param lhs The first value.
+         * @param rhs The second value.
+         * @return bool If the first value is less than the second one.
+         */
+        template<typename T, typename U>
+        bool operator()(const T& lhs, const U& rhs) const
+        {
+            return lhs < rhs;
+        }
+    };
 
     /**
-     * @brief Wraps a value into __operator_in_lhs.
+     * @brief Holds a reference to a range sorted by a comparison, see eps::sorted().
+     *
+     * @tparam R The range type.
+     * @tparam Compare The comparison type.
+     */
+    template<typename R, typename Compare>
+    struct __sorted_range
+    {
+        const R& range;  ///< The range reference.
+        Compare compare; ///< The comparison the range is sorted by.
+    };
+
+    /**
+     * @brief Checks whether a value from __operator_in_lhs<T> occurs in a sorted range with a binary search.
      *
      * @tparam T The value type.
-     * @param lhs The value.
-     * @param rhs __operator_in intermediate struct.
-     * @return __operator_in_lhs<T> The wrapped value.
+     * @tparam R The range type.
+     * @tparam Compare The comparison type.
+     * @param lhs __operator_in_lhs<T> struct hosting the value.
+     * @param r The sorted range.
+     * @return bool If the value occurs in the range.
      */
-    template<typename T>
-    __operator_in_lhs<T> operator|(const T& lhs, __operator_in rhs)
+    template<typename T, typename R, typename Compare>
+    bool operator|(__operator_in_lhs<T> lhs, const __sorted_range<R, Compare>& r)
     {
-        return __operator_in_lhs{lhs};
+        return std::binary_search(std::begin(r.range), std::end(r.range), lhs.val, r.compare);
+    }
+
+    /**
+     * @brief Integer type the values of a constant set are compared as, the underlying type for enumerations.
+     *
+     * @tparam T The value type.
+     */
+    template<typename T, bool = std::is_enum<T>::value>
+    struct __in_integer
+    {
+        typedef T type; ///< The integer type.
+    };
+
+    /**
+     * @brief Integer type the values of a constant set are compared as, the underlying type for enumerations.
+     *
+     * @tparam T The enumeration type.
+     */
+    template<typename T>
+    struct __in_integer<T, true>
+    {
+        typedef typename std::underlying_type<T>::type type; ///< The integer type.
+    };
+
+    /**
+     * @brief Order-preserving 64-bit key of a signed integer, its value offset by 2^63.
+     *
+     * @tparam I The integer type.
+     * @param v The integer.
+     * @return std::uint64_t The key.
+     */
+    template<typename I>
+    constexpr std::uint64_t __in_key(I v, std::true_type)
+    {
+        return static_cast<std::uint64_t>(static_cast<long long>(v)) ^ (std::uint64_t{1} << 63);
+    }
+
+    /**
+     * @brief Order-preserving 64-bit key of an unsigned integer, its value.
+     *
+     * @tparam I The integer type.
+     * @param v The integer.
+     * @return std::uint64_t The key.
+     */
+    template<typename I>
+    constexpr std::uint64_t __in_key(I v, std::false_type)
+    {
+        return static_cast<std::uint64_t>(v);
+    }
+
+    /**
+     * @brief Order-preserving 64-bit key of a value of a constant set, the values of a set are looked up by their
+     * keys.
+     *
+     * @tparam T The value type.
+     * @param v The value.
+     * @return std::uint64_t The key.
+     */
+    template<typename T>
+    constexpr std::uint64_t __in_key(T v)
+    {
+        return __in_key(
+            static_cast<typename __in_integer<T>::type>(v), std::is_signed<typename __in_integer<T>::type>{}
+        );
+    }
+
+    /**
+     * @brief Whether a signed integer is negative.
+     *
+     * @tparam U The integer type.
+     * @param x The integer.
+     * @return bool If the integer is negative.
+     */
+    template<typename U>
+    constexpr bool __in_negative(U x, std::true_type)
+    {
+        return x < 0;
+    }
+
+    /**
+     * @brief Whether an unsigned integer is negative, which it never is.
+     *
+     * @tparam U The integer type.
+     * @return bool false.
+     */
+    template<typename U>
+    constexpr bool __in_negative(U, std::false_type)
+    {
+        return false;
+    }
+
+    /**
+     * @brief Whether a value of the type of a constant set is representable as such, which it always is.
+     *
+     * @tparam T The type of the set.
+     * @tparam U The value type, T as well.
+     * @return bool true.
+     */
+    template<typename T, typename U>
+    constexpr bool __in_representable(const U&, std::true_type)
+    {
+        return true;
+    }
+
+    /**
+     * @brief Whether an integer is representable in the integer type of a constant set, otherwise it equals none of
+     * its values.
+     *
+     * @tparam T The type of the set.
+     * @tparam U The value type.
+     * @param x The value.
+     * @return bool If the value survives the conversion to T.
+     */
+    template<typename T, typename U>
+    constexpr bool __in_representable(const U& x, std::false_type)
+    {
+        return static_cast<U>(static_cast<T>(x)) == x &&
+               __in_negative(static_cast<T>(x), std::is_signed<T>{}) == __in_negative(x, std::is_signed<U>{});
+    }
+
+    /**
+     * @brief Whether a value of type U may be looked up in a constant set of T, i.e. both are integers or both are
+     * the same enumeration.
+     *
+     * @tparam T The type of the set.
+     * @tparam U The value type.
+     */
+    template<typename T, typename U>
+    struct __in_constant_comparable
+    {
+        static constexpr bool value = std::is_same<T, U>::value ||
+                                      (std::is_integral<T>::value && std::is_integral<U>::value); ///< If comparable.
+    };
+
+    /**
+     * @brief The keys of a constant set as an array.
+     *
+     * @tparam Ks The keys.
+     */
+    template<std::uint64_t... Ks>
+    struct __in_keys
+    {
+        static constexpr std::uint64_t data[sizeof...(Ks)] = {Ks...}; ///< The keys.
+    };
+
+    template<std::uint64_t... Ks>
+    constexpr std::uint64_t __in_keys<Ks...>::data[sizeof...(Ks)];
+
+    /**
+     * @brief The smaller of two keys, std::min isn't constexpr before C++14.
+     *
+     * @param a The first key.
+     * @param b The second key.
+     * @return std::uint64_t The smaller key.
+     */
+    constexpr std::uint64_t __in_lesser(std::uint64_t a, std::uint64_t b)
+    {
+        return b < a ? b : a;
+    }
+
+    /**
+     * @brief The greater of two keys, std::max isn't constexpr before C++14.
+     *
+     * @param a The first key.
+     * @param b The second key.
+     * @return std::uint64_t The greater key.
+     */
+    constexpr std::uint64_t __in_greater(std::uint64_t a, std::uint64_t b)
+    {
+        return a < b ? b : a;
+    }
+
+    /**
+     * @brief The smallest of the keys in [lo, hi), halving the range on every call to keep the recursion shallow.
+     *
+     * @param keys The keys.
+     * @param lo The first key.
+     * @param hi Past the last key, greater than lo.
+     * @return std::uint64_t The smallest key.
+     */
+    constexpr std::uint64_t __in_min_key(const std::uint64_t* keys, std::size_t lo, std::size_t hi)
+    {
+        return hi - lo == 1 ? keys[lo]
+                            : __in_lesser(
+                                  __in_min_key(keys, lo, lo + (hi - lo) / 2), __in_min_key(keys, lo + (hi - lo) / 2, hi)
+                              );
+    }
+
+    /**
+     * @brief The greatest of the keys in [lo, hi), halving the range on every call to keep the recursion shallow.
+     *
+     * @param keys The keys.
+     * @param lo The first key.
+     * @param hi Past the last key, greater than lo.
+     * @return std::uint64_t The greatest key.
+     */
+    constexpr std::uint64_t __in_max_key(const std::uint64_t* keys, std::size_t lo, std::size_t hi)
+    {
+        return hi - lo == 1 ? keys[lo]
+                            : __in_greater(
+                                  __in_max_key(keys, lo, lo + (hi - lo) / 2), __in_max_key(keys, lo + (hi - lo) / 2, hi)
+                              );
+    }
+
+    /**
+     * @brief The bits of the keys in [lo, hi) offset by the smallest key, all of them less than 64 apart.
+     *
+     * @param keys The keys.
+     * @param lo The first key.
+     * @param hi Past the last key, greater than lo.
+     * @param base The smallest key.
+     * @return std::uint64_t The bitmask.
+     */
+    constexpr std::uint64_t __in_key_mask(const std::uint64_t* keys, std::size_t lo, std::size_t hi, std::uint64_t base)
+    {
+        return hi - lo == 1 ? std::uint64_t{1} << (keys[lo] - base)
+                            : __in_key_mask(keys, lo, lo + (hi - lo) / 2, base) |
+                                  __in_key_mask(keys, lo + (hi - lo) / 2, hi, base);
+    }
+
+    /**
+     * @brief Whether a key equals none of the keys of an empty set.
+     *
+     * @return bool false.
+     */
+    constexpr bool __in_any_key(std::uint64_t)
+    {
+        return false;
+    }
+
+    /**
+     * @brief Whether a key equals any of the given keys, comparing with all of them without branches.
+     *
+     * @tparam Ks The types of the remaining keys.
+     * @param k The key looked up.
+     * @param first The first key.
+     * @param rest The remaining keys.
+     * @return bool If the key equals any of the keys.
+     */
+    template<typename... Ks>
+    constexpr bool __in_any_key(std::uint64_t k, std::uint64_t first, Ks... rest)
+    {
+        return (k == first) | __in_any_key(k, rest...);
+    }
+
+    /**
+     * @brief The test a constant set is checked with.
+     */
+    enum class __in_strategy
+    {
+        compare,     ///< Comparisons with every value, for small sets.
+        bitmask,     ///< A single bitmask, for values less than 64 apart.
+        perfect_hash ///< A perfect hash table, for larger sets.
+    };
+
+    /**
+     * @brief Chooses the test a constant set is checked with.
+     *
+     * @tparam Ks The keys of the set.
+     */
+    template<std::uint64_t... Ks>
+    struct __in_constant_strategy
+    {
+        static constexpr std::uint64_t span = __in_max_key(__in_keys<Ks...>::data, 0, sizeof...(Ks)) -
+                                              __in_min_key(__in_keys<Ks...>::data, 0, sizeof...(Ks)); ///< Key range.
+
+        /**
+         * @brief The test.
+         */
+        static constexpr __in_strategy value = sizeof...(Ks) <= 2                  ? __in_strategy::compare
+                                             : span < 64                           ? __in_strategy::bitmask
+                                             : sizeof...(Ks) <= 8 || !EPS_IN_CXX14 ? __in_strategy::compare
+                                                                                   : __in_strategy::perfect_hash;
+    };
+
+    /**
+     * @brief Test of a constant set.
+     *
+     * @tparam S The test.
+     * @tparam Ks The keys of the set.
+     */
+    template<__in_strategy S, std::uint64_t... Ks>
+    struct __in_constant_lookup;
+
+    /**
+     * @brief Test of a constant set comparing with every value.
+     *
+     * @tparam Ks The keys of the set.
+     */
+    template<std::uint64_t... Ks>
+    struct __in_constant_lookup<__in_strategy::compare, Ks...>
+    {
+        /**
+         * @brief Check whether a key is in the set.
+         *
+         * @param k The key.
+         * @return bool If the key is in the set.
+         */
+        static constexpr bool contains(std::uint64_t k)
+        {
+            return __in_any_key(k, Ks...);
+        }
+    };
+
+    /**
+     * @brief Test of a constant set with a bitmask of the values.
+     *
+     * @tparam Ks The keys of the set, less than 64 apart.
+     */
+    template<std::uint64_t... Ks>
+    struct __in_constant_lookup<__in_strategy::bitmask, Ks...>
+    {
+        static constexpr std::uint64_t base = __in_min_key(__in_keys<Ks...>::data, 0, sizeof...(Ks)); ///< Bit 0.
+        static constexpr std::uint64_t mask =
+            __in_key_mask(__in_keys<Ks...>::data, 0, sizeof...(Ks), base); ///< The bits of the keys.
+
+        /**
+         * @brief Check whether a key is in the set.
+         *
+         * @param k The key.
+         * @return bool If the key is in the set.
+         */
+        static constexpr bool contains(std::uint64_t k)
+        {
+            return ((mask >> ((k - base) & 63)) & static_cast<std::uint64_t>(k - base < 64)) != 0;
+        }
+    };
+
+#if EPS_IN_CXX14
+    /**
+     * @brief Mix the bits of a key, a bijection.
+     *
+     * @param x The key.
+     * @return std::uint64_t The mixed key.
+     */
+    constexpr std::uint64_t __in_mix(std::uint64_t x)
+    {
+        x ^= x >> 32;
+        x *= 0xD6E8FEB86659FD93;
+        x ^= x >> 32;
+        x *= 0xD6E8FEB86659FD93;
+        return x ^ (x >> 32);
+    }
+
+    /**
+     * @brief The smallest power of two not less than a number.
+     *
+     * @param n The number.
+     * @return std::size_t The power of two.
+     */
+    constexpr std::size_t __in_pow2_ceil(std::size_t n)
+    {
+        std::size_t p = 1;
+        while (p < n)
+        {
+            p <<= 1;
+        }
+        return p;
+    }
+
+    /**
+     * @brief Perfect hash table of the keys of a constant set.
+     *
+     * The keys are hashed into buckets and every bucket has a pilot of its own, chosen so that the slots of all
+     * the keys, hashed once more with the pilot of their bucket, are distinct.
+     *
+     * @tparam S The number of slots, a power of two.
+     * @tparam B The number of buckets, a power of two.
+     */
+    template<std::size_t S, std::size_t B>
+    struct __in_hash_table
+    {
+        std::uint32_t pilots[B]; ///< The pilot of every bucket.
+        std::uint64_t slots[S];  ///< The key of every slot, of a key hashed to another slot for the empty ones.
+        bool ok;                 ///< Whether every key got a slot of its own.
+
+        /**
+         * @brief The slot of a key.
+         *
+         * @param k The key.
+         * @return std::size_t The slot.
+         */
+        constexpr std::size_t slot(std::uint64_t k) const
+        {
+            const std::uint64_t h = __in_mix(k);
+            return static_cast<std::size_t>(__in_mix(h + pilots[h & (B - 1)]) & (S - 1));
+        }
+    };
+
+    /**
+     * @brief Build the perfect hash table of the keys of a constant set.
+     *
+     * The largest buckets are placed first while most of the slots are free, trying the pilots of a bucket in turn
+     * until its keys fit.
+     *
+     * @tparam S The number of slots, a power of two.
+     * @tparam B The number of buckets, a power of two.
+     * @tparam N The number of keys.
+     * @param keys The keys, possibly repeated.
+     * @return __in_hash_table<S, B> The table, not ok if a bucket ran out of pilots.
+     */
+    template<std::size_t S, std::size_t B, std::size_t N>
+    constexpr __in_hash_table<S, B> __in_build_hash_table(const std::uint64_t (&keys)[N])
+    {
+        __in_hash_table<S, B> table{};
+
+        // Group the keys by bucket
+        std::size_t start[B + 1]{}, filled[B]{};
+        std::uint64_t grouped[N]{};
+        for (std::size_t i = 0; i < N; ++i)
+        {
+            ++start[(__in_mix(keys[i]) & (B - 1)) + 1];
+        }
+        for (std::size_t b = 0; b < B; ++b)
+        {
+            start[b + 1] += start[b];
+        }
+        for (std::size_t i = 0; i < N; ++i)
+        {
+            const std::size_t b             = __in_mix(keys[i]) & (B - 1);
+            grouped[start[b] + filled[b]++] = keys[i];
+        }
+
+        // Order the buckets from the largest one
+        std::size_t order[B]{};
+        for (std::size_t i = 0; i < B; ++i)
+        {
+            std::size_t j = i;
+            for (; j != 0 && start[order[j - 1] + 1] - start[order[j - 1]] < start[i + 1] - start[i]; --j)
+            {
+                order[j] = order[j - 1];
+            }
+            order[j] = i;
+        }
+
+        bool used[S]{};
+        std::size_t placed[N]{};
+        for (std::size_t i = 0; i < B && start[order[i] + 1] != start[order[i]]; ++i)
+        {
+            const std::size_t b = order[i];
+            bool fits           = false;
+            for (std::uint32_t pilot = 0; pilot < 65536 && !fits; ++pilot)
+            {
+                table.pilots[b] = pilot;
+                fits            = true;
+                std::size_t n   = 0;
+                for (std::size_t k = start[b]; k < start[b + 1] && fits; ++k)
+                {
+                    // A repeated key shares the slot of its first occurrence
+                    bool repeated = false;
+                    for (std::size_t r = start[b]; r < k; ++r)
+                    {
+                        repeated = repeated || grouped[r] == grouped[k];
+                    }
+                    const std::size_t slot = table.slot(grouped[k]);
+                    if (repeated)
+                    {
+                        continue;
+                    }
+                    if (used[slot])
+                    {
+                        fits = false;
+                        break;
+                    }
+                    used[slot]        = true;
+                    table.slots[slot] = grouped[k];
+                    placed[n++]       = slot;
+                }
+                while (!fits && n != 0)
+                {
+                    used[placed[--n]] = false;
+                }
+            }
+            if (!fits)
+            {
+                return table;
+            }
+        }
+
+        for (std::size_t slot = 0; slot < S; ++slot)
+        {
+            if (!used[slot])
+            {
+                table.slots[slot] = keys[0];
+            }
+        }
+        table.ok = true;
+        return table;
+    }
+
+    /**
+     * @brief Test of a constant set with a perfect hash table, a single probe.
+     *
+     * @tparam Ks The keys of the set.
+     */
+    template<std::uint64_t... Ks>
+    struct __in_constant_lookup<__in_strategy::perfect_hash, Ks...>
+    {
+        typedef __in_hash_table<__in_pow2_ceil(2 * sizeof...(Ks)), __in_pow2_ceil(sizeof...(Ks) / 4)>
+            table_type; ///< The table type, at most half full with four keys per bucket on average.
+
+        /**
+         * @brief The table.
+         */
+        static constexpr table_type table = __in_build_hash_table<
+            __in_pow2_ceil(2 * sizeof...(Ks)), __in_pow2_ceil(sizeof...(Ks) / 4)>(__in_keys<Ks...>::data);
+
+        static_assert(table.ok, "Couldn't build a perfect hash table of the values");
+
+        /**
+         * @brief Check whether a key is in the set.
+         *
+         * @param k The key.
+         * @return bool If the key is in the set.
+         */
+        static constexpr bool contains(std::uint64_t k)
+        {
+            return table.slots[table.slot(k)] == k;
+        }
+    };
+
+    template<std::uint64_t... Ks>
+    constexpr typename __in_constant_lookup<__in_strategy::perfect_hash, Ks...>::table_type
+        __in_constant_lookup<__in_strategy::perfect_hash, Ks...>::table;
+#endif
+
+    /**
+     * @brief Intermediate struct hosting the operator to wrap a value into __operator_in_lhs.
+     */
+    struct __operator_in
+    {};
+
+    /**
+     * @brief Wraps a value into __operator_in_lhs.
+     *
+     * @tparam T The value type.
+     * @param lhs The value.
+     * @param rhs __operator_in intermediate struct.
+     * @return __operator_in_lhs<T> The wrapped value.
+     */
+    template<typename T>
+    constexpr __operator_in_lhs<T> operator|(const T& lhs, __operator_in rhs)
+    {
+        return static_cast<void>(rhs), __operator_in_lhs<T>{lhs};
+    }
+
+    /// @endcond
+
+    /**
+     * @brief Marks a range as sorted, so the operator `in` looks values up in it with a binary search.
+     *
+     * @code
+     * std::vector<int> ids = load_sorted_ids();
+     * if (id in eps::sorted(ids))
+     * {
+     *     // ...
+     * }
+     * @endcode
+     *
+     * @tparam R The range type.
+     * @param r The range sorted in ascending order, must outlive the expression.
+     * @return __sorted_range<R, __in_less> The marked range.
+     */
+    template<typename R>
+    __sorted_range<R, __in_less> sorted(const R& r)
+    {
+        return __sorted_range<R, __in_less>{r, __in_less{}};
+    }
+
+    /**
+     * @brief Marks a range as sorted by a comparison, so the operator `in` looks values up in it with a binary
+     * search.
+     *
+     * @tparam R The range type.
+     * @tparam Compare The comparison type.
+     * @param r The range sorted by the comparison, must outlive the expression.
+     * @param compare The comparison.
+     * @return __sorted_range<R, Compare> The marked range.
+     */
+    template<typename R, typename Compare>
+    __sorted_range<R, Compare> sorted(const R& r, Compare compare)
+    {
+        return __sorted_range<R, Compare>{r, compare};
+    }
+
+    /**
+     * @brief A set of constants the operator `in` checks values against with a test chosen at compile time:
+     * a bitmask for values less than 64 apart, comparisons with every value for small sets and a perfect hash
+     * table for larger ones (comparisons before C++14). Nothing is constructed at runtime and the check can be
+     * used in constant expressions.
+     *
+     * @code
+     * if (code in eps::value_set<int, 3, 17, 42, 99>{})
+     * {
+     *     // ...
+     * }
+     * static_assert(42 in eps::value_set<int, 3, 17, 42, 99>{}, "");
+     * @endcode
+     *
+     * @tparam T The value type, an integer or enumeration type.
+     * @tparam Vs The values.
+     */
+    template<typename T, T... Vs>
+    struct value_set
+    {
+    public:
+        static_assert(sizeof...(Vs) != 0, "A value_set needs at least one value");
+        static_assert(
+            (std::is_integral<T>::value && !std::is_same<T, bool>::value) || std::is_enum<T>::value,
+            "The values of a value_set must be integers or enumerators"
+        );
+
+        typedef T value_type; ///< The value type.
+
+        /**
+         * @brief Get the number of values the set was given.
+         *
+         * @return std::size_t The number of values.
+         */
+        static constexpr std::size_t size() noexcept
+        {
+            return sizeof...(Vs);
+        }
+
+        /**
+         * @brief Check whether a value is in the set, integers are compared by value regardless of their types.
+         *
+         * @tparam U The value type, an integer type if T is, T otherwise.
+         * @param val The value.
+         * @return bool If the value is in the set.
+         */
+        template<typename U>
+        static constexpr bool contains(const U& val)
+        {
+            static_assert(
+                __in_constant_comparable<T, U>::value,
+                "Only integers, or enumerators of the same type, can be looked up in a value_set"
+            );
+            return __in_representable<T>(val, std::is_same<T, U>{}) &&
+                   lookup_type::contains(__in_key(static_cast<T>(val)));
+        }
+
+    private:
+        typedef __in_constant_lookup<__in_constant_strategy<__in_key(Vs)...>::value, __in_key(Vs)...>
+            lookup_type; ///< The test of the set.
+    };
+
+#if EPS_IN_CXX17
+    /**
+     * @brief A set of constants the operator `in` checks values against with a test chosen at compile time,
+     * see eps::value_set.
+     *
+     * @code
+     * if (code in eps::values<3, 17, 42, 99>)
+     * {
+     *     // ...
+     * }
+     * @endcode
+     *
+     * @tparam V The first value, its type is the type of the set.
+     * @tparam Vs The other values.
+     */
+    template<auto V, decltype(V)... Vs>
+    inline constexpr value_set<decltype(V), V, Vs...> values{};
+#elif EPS_IN_CXX14
+    /**
+     * @brief A set of constants the operator `in` checks values against with a test chosen at compile time,
+     * see eps::value_set.
+     *
+     * @code
+     * if (code in eps::values<3, 17, 42, 99>)
+     * {
+     *     // ...
+     * }
+     * @endcode
+     *
+     * @tparam Vs The values.
+     */
+    template<long long... Vs>
+    constexpr value_set<long long, Vs...> values{};
+#endif
+
+    /// @cond SHOW_INTERNAL
+    /**
+     * @brief Checks whether a value from __operator_in_lhs<U> is in a constant set.
+     *
+     * @tparam U The value type.
+     * @tparam T The type of the set.
+     * @tparam Vs The values of the set.
+     * @param lhs __operator_in_lhs<U> struct hosting the value.
+     * @param s The set.
+     * @return bool If the value is in the set.
+     */
+    template<typename U, typename T, T... Vs>
+    constexpr bool operator|(__operator_in_lhs<U> lhs, const value_set<T, Vs...>& s)
+    {
+        return s.contains(lhs.val);
+    }
+
+    /// @endcond
+
+    /**
+     * @brief Compact result of a batch lookup, one bit per value telling whether it occurs in the container,
+     * see eps::each_of().
+     */
+    class membership_bitset
+    {
+    public:
+        /**
+         * @brief Construct a new membership_bitset object with all of the bits clear.
+         *
+         * @param size The number of bits.
+         */
+        explicit membership_bitset(std::size_t size): m_size{size}, m_words((size + 63) / 64, 0)
+        {}
+
+        /**
+         * @brief Get the number of bits.
+         *
+         * @return std::size_t The number of bits.
+         */
+        std::size_t size() const noexcept
+        {
+            return m_size;
+        }
+
+        /**
+         * @brief Get a bit.
+         *
+         * @param i The index of the bit, less than size().
+         * @return bool If the i-th value occurs in the container.
+         */
+        bool operator[](std::size_t i) const noexcept
+        {
+            return (m_words[i / 64] >> (i % 64) & 1) != 0;
+        }
+
+        /**
+         * @brief Set a bit.
+         *
+         * @param i The index of the bit, less than size().
+         */
+        void set(std::size_t i) noexcept
+        {
+            m_words[i / 64] |= std::uint64_t{1} << (i % 64);
+        }
+
+        /**
+         * @brief Get the number of set bits.
+         *
+         * @return std::size_t The number of values occurring in the container.
+         */
+        std::size_t count() const noexcept
+        {
+            std::size_t n = 0;
+            for (std::uint64_t w : m_words)
+            {
+                w = w - ((w >> 1) & 0x5555555555555555);
+                w = (w & 0x3333333333333333) + ((w >> 2) & 0x3333333333333333);
+                w = (w + (w >> 4)) & 0x0F0F0F0F0F0F0F0F;
+                n += static_cast<std::size_t>((w * 0x0101010101010101) >> 56);
+            }
+            return n;
+        }
+
+        /**
+         * @brief Check whether all of the bits are set.
+         *
+         * @return bool If all of the values occur in the container.
+         */
+        bool all() const noexcept
+        {
+            return count() == m_size;
+        }
+
+        /**
+         * @brief Check whether any of the bits is set.
+         *
+         * @return bool If any of the values occurs in the container.
+         */
+        bool any() const noexcept
+        {
+            return std::find_if(m_words.begin(), m_words.end(), [](std::uint64_t w) { return w != 0; }) !=
+                   m_words.end();
+        }
+
+        /**
+         * @brief Check whether none of the bits is set.
+         *
+         * @return bool If none of the values occurs in the container.
+         */
+        bool none() const noexcept
+        {
+            return !any();
+        }
+
+        /**
+         * @brief Get the words holding the bits, bit i is bit i % 64 of word i / 64.
+         *
+         * @return const std::uint64_t* The words, (size() + 63) / 64 of them.
+         */
+        const std::uint64_t* data() const noexcept
+        {
+            return m_words.data();
+        }
+
+    private:
+        std::size_t m_size;                 ///< The number of bits.
+        std::vector<std::uint64_t> m_words; ///< The bits.
+    };
+
+    /// @cond SHOW_INTERNAL
+    /**
+     * @brief What a batch lookup returns.
+     */
+    enum class __in_batch_mode
+    {
+        all,   ///< Whether all of the values occur.
+        any,   ///< Whether any of the values occurs.
+        count, ///< The number of values occurring.
+        each   ///< A membership_bitset of the values occurring.
+    };
+
+    /**
+     * @brief Holds a reference to a range of values looked up in a container all at once, see eps::all_of(),
+     * eps::any_of(), eps::count_of() and eps::each_of().
+     *
+     * @tparam R The range type.
+     * @tparam M What the lookup returns.
+     */
+    template<typename R, __in_batch_mode M>
+    struct __in_batch
+    {
+        const R& keys; ///< The range reference.
+    };
+
+    /**
+     * @brief Accumulates the result of a batch lookup.
+     *
+     * @tparam M What the lookup returns.
+     */
+    template<__in_batch_mode M>
+    struct __in_batch_result;
+
+    /**
+     * @brief Accumulates whether all of the values occur, stopping at the first one that doesn't.
+     */
+    template<>
+    struct __in_batch_result<__in_batch_mode::all>
+    {
+        typedef bool type; ///< The result type.
+
+        bool value; ///< The result.
+
+        /**
+         * @brief Construct a new __in_batch_result object.
+         */
+        explicit __in_batch_result(std::size_t): value{true}
+        {}
+
+        /**
+         * @brief Add the result of a value.
+         *
+         * @param found If the value occurs.
+         * @return bool If the lookup goes on.
+         */
+        bool add(std::size_t, bool found)
+        {
+            value = found;
+            return found;
+        }
+    };
+
+    /**
+     * @brief Accumulates whether any of the values occurs, stopping at the first one that does.
+     */
+    template<>
+    struct __in_batch_result<__in_batch_mode::any>
+    {
+        typedef bool type; ///< The result type.
+
+        bool value; ///< The result.
+
+        /**
+         * @brief Construct a new __in_batch_result object.
+         */
+        explicit __in_batch_result(std::size_t): value{false}
+        {}
+
+        /**
+         * @brief Add the result of a value.
+         *
+         * @param found If the value occurs.
+         * @return bool If the lookup goes on.
+         */
+        bool add(std::size_t, bool found)
+        {
+            value = found;
+            return !found;
+        }
+    };
+
+    /**
+     * @brief Accumulates the number of values occurring.
+     */
+    template<>
+    struct __in_batch_result<__in_batch_mode::count>
+    {
+        typedef std::size_t type; ///< The result type.
+
+        std::size_t value; ///< The result.
+
+        /**
+         * @brief Construct a new __in_batch_result object.
+         */
+        explicit __in_batch_result(std::size_t): value{0}
+        {}
+
+        /**
+         * @brief Add the result of a value.
+         *
+         * @param found If the value occurs.
+         * @return bool If the lookup goes on, always.
+         */
+        bool add(std::size_t, bool found)
+        {
+            value += found ? 1 : 0;
+            return true;
+        }
+    };
+
+    /**
+     * @brief Accumulates a bit per value.
+     */
+    template<>
+    struct __in_batch_result<__in_batch_mode::each>
+    {
+        typedef membership_bitset type; ///< The result type.
+
+        membership_bitset value; ///< The result.
+
+        /**
+         * @brief Construct a new __in_batch_result object.
+         *
+         * @param size The number of values.
+         */
+        explicit __in_batch_result(std::size_t size): value{size}
+        {}
+
+        /**
+         * @brief Add the result of a value.
+         *
+         * @param i The index of the value.
+         * @param found If the value occurs.
+         * @return bool If the lookup goes on, always.
+         */
+        bool add(std::size_t i, bool found)
+        {
+            if (found)
+            {
+                value.set(i);
+            }
+            return true;
+        }
+    };
+
+    /**
+     * @brief Look a range of values up one by one.
+     *
+     * @tparam M What the lookup returns.
+     * @tparam R The range type.
+     * @tparam Lookup The lookup type, called with a value.
+     * @param keys The values.
+     * @param lookup The lookup of a single value.
+     * @return __in_batch_result<M>::type The result.
+     */
+    template<__in_batch_mode M, typename R, typename Lookup>
+    typename __in_batch_result<M>::type __in_run_batch(const R& keys, Lookup lookup)
+    {
+        __in_batch_result<M> result{static_cast<std::size_t>(std::distance(std::begin(keys), std::end(keys)))};
+        std::size_t i = 0;
+        for (auto it = std::begin(keys); it != std::end(keys) && result.add(i, lookup(*it)); ++it, ++i)
+        {}
+        return std::move(result.value);
+    }
+
+    /**
+     * @brief Detects a container's own lookup, see the overloads of __in.
+     */
+    template<typename T, typename C>
+    auto __in_own_lookup(const T& val, const C& c, __in_rank<4>)
+        -> typename std::enable_if<
+            __in_own_lookup_applies<T, C>::value,
+            decltype(static_cast<void>(c.contains(val)), std::true_type{})>::type;
+
+    /**
+     * @brief Detects a container's own lookup, see the overloads of __in.
+     */
+    template<typename T, typename C>
+    auto __in_own_lookup(const T& val, const C& c, __in_rank<3>)
+        -> typename std::enable_if<
+            __in_own_lookup_applies<T, C>::value,
+            decltype(static_cast<void>(c.find(val) != C::npos), std::true_type{})>::type;
+
+    /**
+     * @brief Detects a container's own lookup, see the overloads of __in.
+     */
+    template<typename T, typename C>
+    auto __in_own_lookup(const T& val, const C& c, __in_rank<2>)
+        -> typename std::enable_if<
+            __in_own_lookup_applies<T, C>::value,
+            decltype(static_cast<void>(c.find(val) != c.end()), std::true_type{})>::type;
+
+    /**
+     * @brief Detects a container's own lookup, see the overloads of __in.
+     */
+    template<typename T, typename C>
+    auto __in_own_lookup(const T& val, const C& c, __in_rank<1>)
+        -> typename std::enable_if<
+            __in_own_lookup_applies<T, C>::value,
+            decltype(static_cast<void>(c.count(val) != 0), std::true_type{})>::type;
+
+    /**
+     * @brief Detects a container's own lookup, see the overloads of __in.
+     */
+    template<typename T, typename C>
+    std::false_type __in_own_lookup(const T& val, const C& c, __in_rank<0>);
+
+    /**
+     * @brief Detects elements comparable with each other and with the values looked up.
+     */
+    template<typename K, typename E>
+    auto __in_less_comparable(int) -> decltype(
+        static_cast<bool>(std::declval<const E&>() < std::declval<const E&>()),
+        static_cast<bool>(std::declval<const K&>() < std::declval<const E&>()),
+        static_cast<bool>(std::declval<const E&>() < std::declval<const K&>()), std::true_type{}
+    );
+
+    /**
+     * @brief Detects elements comparable with each other and with the values looked up.
+     */
+    template<typename K, typename E>
+    std::false_type __in_less_comparable(long);
+
+    /**
+     * @brief Detects a container searched with a membership kernel, see __in_find_contiguous.
+     */
+    template<typename T, typename C>
+    auto __in_kernel_applies(const C& c, int) ->
+        typename std::enable_if<__in_kernel_eligible<T, decltype(*c.data())>::value, std::true_type>::type;
+
+    /**
+     * @brief Detects a container searched with a membership kernel, see __in_find_contiguous.
+     */
+    template<typename T, typename E, std::size_t N>
+    auto __in_kernel_applies(const E (&)[N], int) ->
+        typename std::enable_if<__in_kernel_eligible<T, E>::value, std::true_type>::type;
+
+    /**
+     * @brief Detects a container searched with a membership kernel, see __in_find_contiguous.
+     */
+    template<typename T, typename C>
+    std::false_type __in_kernel_applies(const C&, long);
+
+    /**
+     * @brief Whether a batch lookup in a container sorts a copy of it first: the container has no lookup of its own
+     * and its elements are comparable with each other and with the values. Floating point isn't indexed, as NaN
+     * breaks the strict weak ordering sorting needs, nor are scalars looked up with class types, as the built-in <
+     * sorting the elements (by address for pointers) needn't order them like the values' own comparison.
+     *
+     * @tparam K The value type.
+     * @tparam C The container type.
+     */
+    template<typename K, typename C>
+    struct __in_batch_indexable
+    {
+        typedef typename std::decay<decltype(*std::begin(std::declval<const C&>()))>::type element_type; ///< Element.
+
+        static constexpr bool value =
+            !decltype(__in_own_lookup(std::declval<const K&>(), std::declval<const C&>(), __in_rank<4>{}))::value &&
+            decltype(__in_less_comparable<K, element_type>(0))::value && !std::is_floating_point<K>::value &&
+            !std::is_floating_point<element_type>::value &&
+            (std::is_scalar<K>::value || !std::is_scalar<element_type>::value); ///< If the container is indexed.
+    };
+
+    constexpr std::size_t __in_index_factor        = 6;   ///< Values per log2 of the elements past which to index.
+    constexpr std::size_t __in_kernel_index_factor = 128; ///< The same when searching with a membership kernel.
+
+    /**
+     * @brief Whether sorting a copy of a container pays off for looking a number of values up in it.
+     *
+     * Sorting costs about log2(n) comparisons per element and a binary search log2(n) comparisons, while a linear
+     * search costs n / 2 comparisons on average, far cheaper ones with a membership kernel comparing many elements
+     * at once. The factors are measured crossover points.
+     *
+     * @param m The number of values.
+     * @param n The number of elements.
+     * @param kernel If the container is searched with a membership kernel.
+     * @return bool If the container is indexed.
+     */
+    inline bool __in_index_pays_off(std::size_t m, std::size_t n, bool kernel)
+    {
+        std::size_t log2n = 1;
+        while (log2n < 64 && (std::size_t{1} << log2n) < n)
+        {
+            ++log2n;
+        }
+        return n >= 64 && m > (kernel ? __in_kernel_index_factor : __in_index_factor) * log2n;
+    }
+
+    /**
+     * @brief Sorted copy of a container, of scalars or of elements yielded by value.
+     *
+     * @tparam E The element type.
+     * @tparam Copy Whether the elements are copied.
+     */
+    template<typename E, bool Copy>
+    class __in_sorted_index
+    {
+    public:
+        /**
+         * @brief Construct a new __in_sorted_index object.
+         *
+         * @tparam C The container type.
+         * @param c The container.
+         */
+        template<typename C>
+        explicit __in_sorted_index(const C& c): m_entries(std::begin(c), std::end(c))
+        {
+            std::sort(m_entries.begin(), m_entries.end());
+        }
+
+        /**
+         * @brief Check whether a value occurs in the container, comparing it with == to the elements equivalent to it
+         * so that the result matches a linear search.
+         *
+         * @tparam K The value type.
+         * @param key The value.
+         * @return bool If the value occurs in the container.
+         */
+        template<typename K>
+        bool contains(const K& key) const
+        {
+            typedef typename std::vector<E>::const_iterator iterator;
+
+            const std::pair<iterator, iterator> range =
+                std::equal_range(m_entries.begin(), m_entries.end(), key, __in_less{});
+            return std::find_if(range.first, range.second, [&key](const E& e) { return e == key; }) != range.second;
+        }
+
+    private:
+        std::vector<E> m_entries; ///< The sorted elements.
+    };
+
+    /**
+     * @brief Compares elements through pointers to them, with each other and with values.
+     *
+     * @tparam E The element type.
+     */
+    template<typename E>
+    struct __in_deref_less
+    {
+        /**
+         * @brief Compare two elements.
+         */
+        bool operator()(const E* lhs, const E* rhs) const
+        {
+            return *lhs < *rhs;
+        }
+
+        /**
+         * @brief Compare an element with a value.
+         */
+        template<typename K>
+        bool operator()(const E* lhs, const K& rhs) const
+        {
+            return *lhs < rhs;
+        }
+
+        /**
+         * @brief Compare a value with an element.
+         */
+        template<typename K>
+        bool operator()(const K& lhs, const E* rhs) const
+        {
+            return lhs < *rhs;
+        }
+    };
+
+    /**
+     * @brief Sorted pointers to the elements of a container of class types, which aren't copied.
+     *
+     * @tparam E The element type.
+     */
+    template<typename E>
+    class __in_sorted_index<E, false>
+    {
+    public:
+        /**
+         * @brief Construct a new __in_sorted_index object.
+         *
+         * @tparam C The container type.
+         * @param c The container, must outlive the index.
+         */
+        template<typename C>
+        explicit __in_sorted_index(const C& c)
+        {
+            for (const E& e : c)
+            {
+                m_entries.push_back(std::addressof(e));
+            }
+            std::sort(m_entries.begin(), m_entries.end(), __in_deref_less<E>{});
+        }
+
+        /**
+         * @brief Check whether a value occurs in the container, comparing it with == to the elements equivalent to it
+         * so that the result matches a linear search.
+         *
+         * @tparam K The value type.
+         * @param key The value.
+         * @return bool If the value occurs in the container.
+         */
+        template<typename K>
+        bool contains(const K& key) const
+        {
+            typedef typename std::vector<const E*>::const_iterator iterator;
+
+            const std::pair<iterator, iterator> range =
+                std::equal_range(m_entries.begin(), m_entries.end(), key, __in_deref_less<E>{});
+            return std::find_if(range.first, range.second, [&key](const E* e) { return *e == key; }) != range.second;
+        }
+
+    private:
+        std::vector<const E*> m_entries; ///< Pointers to the elements, sorted by the elements.
+    };
+
+    /**
+     * @brief Looks a range of values up in a container with a lookup of its own, or with incomparable elements,
+     * one by one.
+     *
+     * @tparam M What the lookup returns.
+     * @tparam R The range type.
+     * @tparam C The container type.
+     * @param keys The values.
+     * @param c The container.
+     * @return __in_batch_result<M>::type The result.
+     */
+    template<__in_batch_mode M, typename R, typename C>
+    typename __in_batch_result<M>::type __in_batch_lookup(const R& keys, const C& c, std::false_type)
+    {
+        typedef typename std::decay<decltype(*std::begin(keys))>::type key_type;
+
+        return __in_run_batch<M>(keys, [&c](const key_type& key) { return __operator_in_lhs<key_type>{key} | c; });
+    }
+
+    /**
+     * @brief Looks a range of values up in a container searched linearly, sorting a copy of the container first
+     * if there are enough values for it to pay off.
+     *
+     * @tparam M What the lookup returns.
+     * @tparam R The range type.
+     * @tparam C The container type.
+     * @param keys The values.
+     * @param c The container.
+     * @return __in_batch_result<M>::type The result.
+     */
+    template<__in_batch_mode M, typename R, typename C>
+    typename __in_batch_result<M>::type __in_batch_lookup(const R& keys, const C& c, std::true_type)
+    {
+        typedef typename std::decay<decltype(*std::begin(keys))>::type key_type;
+        typedef typename std::decay<decltype(*std::begin(c))>::type element_type;
+
+        const std::size_t m = static_cast<std::size_t>(std::distance(std::begin(keys), std::end(keys)));
+        const std::size_t n = static_cast<std::size_t>(std::distance(std::begin(c), std::end(c)));
+        if (!__in_index_pays_off(m, n, EPS_IN_X86_KERNELS && decltype(__in_kernel_applies<key_type>(c, 0))::value))
+        {
+            return __in_batch_lookup<M>(keys, c, std::false_type{});
+        }
+        const __in_sorted_index<
+            element_type, std::is_scalar<element_type>::value ||
+                              !std::is_lvalue_reference<decltype(*std::begin(c))>::value>
+            index{c};
+        return __in_run_batch<M>(keys, [&index](const key_type& key) { return index.contains(key); });
+    }
+
+    /**
+     * @brief Looks a range of values from __operator_in_lhs<__in_batch<R, M>> up in a container.
+     *
+     * @tparam R The range type.
+     * @tparam M What the lookup returns.
+     * @tparam C The container type.
+     * @param lhs __operator_in_lhs<__in_batch<R, M>> struct hosting the values.
+     * @param c The container.
+     * @return __in_batch_result<M>::type The result.
+     */
+    template<typename R, __in_batch_mode M, typename C>
+    typename __in_batch_result<M>::type operator|(__operator_in_lhs<__in_batch<R, M>> lhs, const C& c)
+    {
+        typedef typename std::decay<decltype(*std::begin(lhs.val.keys))>::type key_type;
+
+        return __in_batch_lookup<M>(
+            lhs.val.keys, c, std::integral_constant<bool, __in_batch_indexable<key_type, C>::value>{}
+        );
+    }
+
+    /**
+     * @brief Looks a range of values from __operator_in_lhs<__in_batch<R, M>> up in a sorted range, one by one.
+     *
+     * @tparam R The range type.
+     * @tparam M What the lookup returns.
+     * @tparam S The sorted range type.
+     * @tparam Compare The comparison type.
+     * @param lhs __operator_in_lhs<__in_batch<R, M>> struct hosting the values.
+     * @param r The sorted range.
+     * @return __in_batch_result<M>::type The result.
+     */
+    template<typename R, __in_batch_mode M, typename S, typename Compare>
+    typename __in_batch_result<M>::type
+        operator|(__operator_in_lhs<__in_batch<R, M>> lhs, const __sorted_range<S, Compare>& r)
+    {
+        return __in_batch_lookup<M>(lhs.val.keys, r, std::false_type{});
+    }
+
+    /**
+     * @brief Looks a range of values from __operator_in_lhs<__in_batch<R, M>> up in a constant set, one by one.
+     *
+     * @tparam R The range type.
+     * @tparam M What the lookup returns.
+     * @tparam T The type of the set.
+     * @tparam Vs The values of the set.
+     * @param lhs __operator_in_lhs<__in_batch<R, M>> struct hosting the values.
+     * @param s The set.
+     * @return __in_batch_result<M>::type The result.
+     */
+    template<typename R, __in_batch_mode M, typename T, T... Vs>
+    typename __in_batch_result<M>::type
+        operator|(__operator_in_lhs<__in_batch<R, M>> lhs, const value_set<T, Vs...>& s)
+    {
+        return __in_batch_lookup<M>(lhs.val.keys, s, std::false_type{});
+    }
+
+    /// @endcond
+
+    /**
+     * @brief Marks a range of values to be looked up in a container all at once, the operator `in` returning
+     * whether all of them occur in it.
+     *
+     * Past a few values, a container without a lookup of its own is sorted once, as a copy, and the values are
+     * looked up in it with binary searches instead of a linear search each.
+     *
+     * @code
+     * if (eps::all_of(required_ids) in ids)
+     * {
+     *     // ...
+     * }
+     * @endcode
+     *
+     * @tparam R The range type.
+     * @param keys The values, must outlive the expression.
+     * @return __in_batch<R, __in_batch_mode::all> The marked range.
+     */
+    template<typename R>
+    __in_batch<R, __in_batch_mode::all> all_of(const R& keys)
+    {
+        return __in_batch<R, __in_batch_mode::all>{keys};
+    }
+
+    /**
+     * @brief Marks a range of values to be looked up in a container all at once, the operator `in` returning
+     * whether any of them occurs in it, see eps::all_of().
+     *
+     * @tparam R The range type.
+     * @param keys The values, must outlive the expression.
+     * @return __in_batch<R, __in_batch_mode::any> The marked range.
+     */
+    template<typename R>
+    __in_batch<R, __in_batch_mode::any> any_of(const R& keys)
+    {
+        return __in_batch<R, __in_batch_mode::any>{keys};
+    }
+
+    /**
+     * @brief Marks a range of values to be looked up in a container all at once, the operator `in` returning
+     * the number of them occurring in it, see eps::all_of().
+     *
+     * @tparam R The range type.
+     * @param keys The values, must outlive the expression.
+     * @return __in_batch<R, __in_batch_mode::count> The marked range.
+     */
+    template<typename R>
+    __in_batch<R, __in_batch_mode::count> count_of(const R& keys)
+    {
+        return __in_batch<R, __in_batch_mode::count>{keys};
+    }
+
+    /**
+     * @brief Marks a range of values to be looked up in a container all at once, the operator `in` returning
+     * an eps::membership_bitset of them occurring in it, see eps::all_of().
+     *
+     * @code
+     * const eps::membership_bitset known = eps::each_of(candidates) in ids;
+     * for (std::size_t i = 0; i < known.size(); ++i)
+     * {
+     *     if (!known[i])
+     *     {
+     *         // ...
+     *     }
+     * }
+     * @endcode
+     *
+     * @tparam R The range type.
+     * @param keys The values, must outlive the expression.
+     * @return __in_batch<R, __in_batch_mode::each> The marked range.
+     */
+    template<typename R>
+    __in_batch<R, __in_batch_mode::each> each_of(const R& keys)
+    {
+        return __in_batch<R, __in_batch_mode::each>{keys};
+    }
+
+    /// @cond SHOW_INTERNAL
+    constexpr std::size_t __in_par_min_size = std::size_t{1} << 18; ///< Elements below which a lookup stays serial.
+    constexpr std::size_t __in_par_block    = std::size_t{1} << 16; ///< Elements searched between checks for a match.
+
+    /**
+     * @brief Holds a reference to a range to be searched by several threads, see eps::par().
+     *
+     * @tparam R The range type.
+     */
+    template<typename R>
+    struct __par_range
+    {
+        const R& range; ///< The range reference.
+    };
+
+    /**
+     * @brief Lightweight pool of threads running the helpers of parallel lookups.
+     */
+    class __in_thread_pool
+    {
+    public:
+        /**
+         * @brief Get the pool shared by all parallel lookups, started on first use with a thread per hardware thread
+         * but one, as the thread doing a lookup takes part in it.
+         *
+         * @return __in_thread_pool& The pool.
+         */
+        static __in_thread_pool& instance()
+        {
+            static __in_thread_pool pool{
+                std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() - 1 : 0
+            };
+            return pool;
+        }
+
+        /**
+         * @brief Construct a new __in_thread_pool object.
+         *
+         * @param size The number of threads.
+         */
+        explicit __in_thread_pool(std::size_t size)
+        {
+            m_threads.reserve(size);
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                m_threads.emplace_back([this] { work(); });
+            }
+        }
+
+        /**
+         * @brief Destroy the __in_thread_pool object, after the queued tasks are run.
+         */
+        ~__in_thread_pool()
+        {
+            {
+                std::lock_guard<std::mutex> lock{m_mtx};
+                m_stop = true;
+            }
+            m_cv.notify_all();
+            for (std::thread& t : m_threads)
+            {
+                t.join();
+            }
+        }
+
+        /**
+         * @brief Get the number of threads.
+         *
+         * @return std::size_t The number of threads.
+         */
+        std::size_t size() const noexcept
+        {
+            return m_threads.size();
+        }
+
+        /**
+         * @brief Queue copies of a task, each to be run by a thread of the pool.
+         *
+         * @param task The task.
+         * @param copies The number of copies.
+         */
+        void submit(const std::function<void()>& task, std::size_t copies)
+        {
+            {
+                std::lock_guard<std::mutex> lock{m_mtx};
+                m_tasks.insert(m_tasks.end(), copies, task);
+            }
+            m_cv.notify_all();
+        }
+
+    private:
+        /**
+         * @brief Run the queued tasks until the pool is destroyed.
+         */
+        void work()
+        {
+            for (;;)
+            {
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock{m_mtx};
+                    m_cv.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+                    if (m_tasks.empty())
+                    {
+                        return;
+                    }
+                    task = std::move(m_tasks.front());
+                    m_tasks.pop_front();
+                }
+                task();
+            }
+        }
+
+        std::mutex m_mtx;                          ///< Guards the queue.
+        std::condition_variable m_cv;              ///< Signals queued tasks.
+        std::deque<std::function<void()>> m_tasks; ///< The queued tasks.
+        std::vector<std::thread> m_threads;        ///< The threads.
+        bool m_stop = false;                       ///< Whether the pool is being destroyed.
+    };
+
+    /**
+     * @brief Searches the elements [lo, hi) of a contiguous container of integers or enumerators with a membership
+     * kernel.
+     *
+     * @tparam T The value type.
+     * @tparam C The container type.
+     * @param val The value.
+     * @param c The container.
+     * @param lo The first element.
+     * @param hi Past the last element.
+     * @return bool If the value occurs in the elements.
+     */
+    template<typename T, typename C>
+    auto __in_search_block(const T& val, const C& c, std::size_t lo, std::size_t hi, __in_rank<1>) ->
+        typename std::enable_if<__in_kernel_eligible<T, decltype(*c.data())>::value, bool>::type
+    {
+        return __in_find_contiguous<typename std::remove_cv<T>::type>(val, c.data() + lo, hi - lo);
+    }
+
+    /**
+     * @brief Searches the elements [lo, hi) of a C-style array of integers or enumerators with a membership kernel.
+     *
+     * @tparam T The value type.
+     * @tparam E The element type.
+     * @tparam N The number of elements.
+     * @param val The value.
+     * @param c The array.
+     * @param lo The first element.
+     * @param hi Past the last element.
+     * @return bool If the value occurs in the elements.
+     */
+    template<typename T, typename E, std::size_t N>
+    auto __in_search_block(const T& val, const E (&c)[N], std::size_t lo, std::size_t hi, __in_rank<1>) ->
+        typename std::enable_if<__in_kernel_eligible<T, E>::value, bool>::type
+    {
+        return __in_find_contiguous<typename std::remove_cv<T>::type>(val, c + lo, hi - lo);
+    }
+
+    /**
+     * @brief Searches the elements [lo, hi) of a random access range linearly.
+     *
+     * @tparam T The value type.
+     * @tparam R The range type.
+     * @param val The value.
+     * @param r The range.
+     * @param lo The first element.
+     * @param hi Past the last element.
+     * @return bool If the value occurs in the elements.
+     */
+    template<typename T, typename R>
+    bool __in_search_block(const T& val, const R& r, std::size_t lo, std::size_t hi, __in_rank<0>)
+    {
+        typedef typename std::iterator_traits<decltype(std::begin(r))>::difference_type difference_type;
+
+        const auto first = std::begin(r) + static_cast<difference_type>(lo);
+        const auto last  = std::begin(r) + static_cast<difference_type>(hi);
+        return std::find(first, last, val) != last;
+    }
+
+    /**
+     * @brief State of a parallel lookup, shared by the thread doing it and the helpers from the pool.
+     *
+     * The range is split into blocks taken by the threads in turn, so they stop taking them as soon as any of
+     * them finds the value or fails. Helpers starting after the lookup is closed leave without touching the range.
+     *
+     * @tparam T The value type.
+     * @tparam R The range type.
+     */
+    template<typename T, typename R>
+    struct __in_par_job
+    {
+        /**
+         * @brief Construct a new __in_par_job object.
+         *
+         * @param val The value.
+         * @param range The range.
+         * @param n The number of elements.
+         */
+        __in_par_job(const T& val, const R& range, std::size_t n):
+            val{val}, range{range}, n{n}, blocks{(n + __in_par_block - 1) / __in_par_block}
+        {}
+
+        /**
+         * @brief Take part in the lookup as a helper, keeping an exception thrown by a comparison for the thread
+         * doing the lookup to rethrow, as it must not escape a thread of the pool.
+         */
+        void help()
+        {
+            ++busy;
+            if (!closed)
+            {
+                try
+                {
+                    search();
+                }
+                catch (...)
+                {
+                    if (!failed.exchange(true))
+                    {
+                        error = std::current_exception();
+                    }
+                    closed = true;
+                }
+            }
+            --busy;
+        }
+
+        /**
+         * @brief Search the blocks until there are none left, the value is found or the lookup is closed.
+         */
+        void search()
+        {
+            for (std::size_t b = 0;
+                 !found.load(std::memory_order_relaxed) && !closed.load(std::memory_order_relaxed) &&
+                 (b = next++) < blocks;)
+            {
+                const std::size_t hi = (std::min)(n, (b + 1) * __in_par_block);
+                if (__in_search_block(val, range, b * __in_par_block, hi, __in_rank<1>{}))
+                {
+                    found = true;
+                }
+            }
+        }
+
+        /**
+         * @brief Close the lookup, stopping the search, and wait for the helpers taking part to leave, after which
+         * the range isn't touched.
+         */
+        void close() noexcept
+        {
+            closed = true;
+            while (busy != 0)
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        const T& val;                     ///< The value.
+        const R& range;                   ///< The range.
+        const std::size_t n;              ///< The number of elements.
+        const std::size_t blocks;         ///< The number of blocks.
+        std::atomic<std::size_t> next{0}; ///< The next block to search.
+        std::atomic<std::size_t> busy{0}; ///< The number of helpers taking part.
+        std::atomic<bool> found{false};   ///< Whether the value was found.
+        std::atomic<bool> failed{false};  ///< Whether a helper failed.
+        std::atomic<bool> closed{false};  ///< Whether the lookup is over.
+        std::exception_ptr error;         ///< The exception of the first helper failing.
+    };
+
+    /**
+     * @brief Looks a value up in a random access range with the threads of a pool, the calling thread taking part.
+     *
+     * @tparam T The value type.
+     * @tparam R The range type.
+     * @param val The value.
+     * @param range The range.
+     * @param n The number of elements.
+     * @param pool The pool.
+     * @return bool If the value occurs in the range.
+     * @throws Whatever comparing the value with an element throws, in this thread or in a helper.
+     */
+    template<typename T, typename R>
+    bool __in_parallel(const T& val, const R& range, std::size_t n, __in_thread_pool& pool)
+    {
+        const std::shared_ptr<__in_par_job<T, R>> job = std::make_shared<__in_par_job<T, R>>(val, range, n);
+
+        // The range must not be touched once the lookup returns, even by throwing
+        struct job_close
+        {
+            __in_par_job<T, R>& job;
+
+            ~job_close()
+            {
+                job.close();
+            }
+        } close{*job};
+
+        pool.submit([job] { job->help(); }, (std::min)(pool.size(), job->blocks - 1));
+        job->search();
+        job->close();
+        if (job->error)
+        {
+            std::rethrow_exception(job->error);
+        }
+        return job->found;
+    }
+
+    /**
+     * @brief Detects a range searched in parallel: a random access range without a lookup of its own.
+     */
+    template<typename T, typename R>
+    auto __in_parallelizable(int) -> typename std::enable_if<
+        std::is_base_of<
+            std::random_access_iterator_tag,
+            typename std::iterator_traits<decltype(std::begin(std::declval<const R&>()))>::iterator_category>::value,
+        std::integral_constant<
+            bool,
+            !decltype(__in_own_lookup(std::declval<const T&>(), std::declval<const R&>(), __in_rank<4>{}))::value>>::
+        type;
+
+    /**
+     * @brief Detects a range searched in parallel: a random access range without a lookup of its own.
+     */
+    template<typename T, typename R>
+    std::false_type __in_parallelizable(long);
+
+    /**
+     * @brief Looks a value up in a range that isn't searched in parallel.
+     *
+     * @tparam T The value type.
+     * @tparam R The range type.
+     * @param val The value.
+     * @param r The range.
+     * @return bool If the value occurs in the range.
+     */
+    template<typename T, typename R>
+    bool __in_par_lookup(const T& val, const R& r, std::false_type)
+    {
+        return __operator_in_lhs<T>{val} | r;
+    }
+
+    /**
+     * @brief Looks a value up in a random access range in parallel, serially if the range is small or the
+     * processor has a single hardware thread.
+     *
+     * @tparam T The value type.
+     * @tparam R The range type.
+     * @param val The value.
+     * @param r The range.
+     * @return bool If the value occurs in the range.
+     */
+    template<typename T, typename R>
+    bool __in_par_lookup(const T& val, const R& r, std::true_type)
+    {
+        const std::size_t n = static_cast<std::size_t>(std::distance(std::begin(r), std::end(r)));
+        if (n < __in_par_min_size || __in_thread_pool::instance().size() == 0)
+        {
+            return __operator_in_lhs<T>{val} | r;
+        }
+        return __in_parallel(val, r, n, __in_thread_pool::instance());
+    }
+
+    /**
+     * @brief Checks whether a value from __operator_in_lhs<T> occurs in a range, searching it in parallel.
+     *
+     * @tparam T The value type.
+     * @tparam R The range type.
+     * @param lhs __operator_in_lhs<T> struct hosting the value.
+     * @param r The range.
+     * @return bool If the value occurs in the range.
+     */
+    template<typename T, typename R>
+    bool operator|(__operator_in_lhs<T> lhs, const __par_range<R>& r)
+    {
+        return __in_par_lookup(lhs.val, r.range, decltype(__in_parallelizable<T, R>(0)){});
+    }
+
+    /**
+     * @brief Looks a range of values from __operator_in_lhs<__in_batch<R, M>> up in a range, one by one, searching
+     * it in parallel for each of them.
+     *
+     * @tparam R The range type.
+     * @tparam M What the lookup returns.
+     * @tparam P The searched range type.
+     * @param lhs __operator_in_lhs<__in_batch<R, M>> struct hosting the values.
+     * @param r The searched range.
+     * @return __in_batch_result<M>::type The result.
+     */
+    template<typename R, __in_batch_mode M, typename P>
+    typename __in_batch_result<M>::type operator|(__operator_in_lhs<__in_batch<R, M>> lhs, const __par_range<P>& r)
+    {
+        return __in_batch_lookup<M>(lhs.val.keys, r, std::false_type{});
     }
 
     /// @endcond
+
+    /**
+     * @brief Marks a range to be searched by several threads, so the operator `in` splits a large range between
+     * the threads of an internal pool, which stop as soon as any of them finds the value.
+     *
+     * Ranges of fewer than 2^18 elements, ranges without random access iterators and containers with a lookup of
+     * their own are searched as they would be without it.
+     *
+     * @code
+     * if (id in eps::par(all_ids))
+     * {
+     *     // ...
+     * }
+     * @endcode
+     *
+     * @tparam R The range type.
+     * @param r The range, must outlive the expression.
+     * @return __par_range<R> The marked range.
+     */
+    template<typename R>
+    __par_range<R> par(const R& r)
+    {
+        return __par_range<R>{r};
+    }
 } // namespace eps
 
 /**
@@ -81,6 +2559,11 @@ namespace eps
  *
  * A macro analog of the operator `in` that, given a value and a container,
  * returns a boolean indicating whether the value occurs in the container.
+ * The container's own lookup is used if it has one, e.g. for sets, maps and strings,
+ * a binary search for a range marked with eps::sorted() and a test chosen at compile time
+ * for an eps::value_set. Ranges of values marked with eps::all_of(), eps::any_of(),
+ * eps::count_of() or eps::each_of() are looked up all at once, and a range marked with
+ * eps::par() is searched by several threads.
  */
 #define in | eps::__operator_in{} |
 
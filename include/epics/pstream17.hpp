@@ -9,11 +9,28 @@
 #ifndef EPICS_PSTREAM17_HPP
 #define EPICS_PSTREAM17_HPP
 
-#include <functional>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <mutex>
-#include <queue>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 /**
  * @brief Namespace for EPICS library.
@@ -21,220 +38,4078 @@
 namespace eps
 {
     /**
-     * @brief Base class for the pstreams.
+     * @brief Whether the pstreams collect lock statistics, i.e. `EPS_PSTREAM_STATS` is defined before including
+     * the header.
+     *
+     * Without it the statistics are compiled out and the snapshot functions return nothing.
      */
-    class pstream_base
+#ifdef EPS_PSTREAM_STATS
+    inline constexpr bool pstream_stats_enabled = true;
+#else
+    inline constexpr bool pstream_stats_enabled = false;
+#endif
+
+    /**
+     * @brief Snapshot of the lock statistics of a wrapped stream object.
+     *
+     * Durations are in nanoseconds. Histogram bucket 0 counts durations shorter than a nanosecond,
+     * bucket `i` counts durations of `[2^(i-1), 2^i)` nanoseconds, and the last bucket counts all the longer ones.
+     */
+    struct pstream_stats
     {
-    protected:
-        static inline std::mutex g_mtx;
+        static constexpr std::size_t histogram_size = 32; ///< The number of histogram buckets.
+
+        std::uint64_t acquisitions = 0;                             ///< The number of times the lock was taken.
+        std::uint64_t contended    = 0;                             ///< The acquisitions that had to wait.
+        std::uint64_t wait_ns      = 0;                             ///< Total time spent waiting for the lock.
+        std::uint64_t held_ns      = 0;                             ///< Total time the lock was held.
+        std::uint64_t chains       = 0;                             ///< The number of completed chains.
+        std::uint64_t actions      = 0;                             ///< The number of I/O operations in them.
+        std::array<std::uint64_t, histogram_size> wait_histogram{}; ///< Log-scale histogram of waiting times.
+        std::array<std::uint64_t, histogram_size> held_histogram{}; ///< Log-scale histogram of holding times.
     };
 
+    /// @cond SHOW_INTERNAL
     /**
-     * @brief Thread-safe wrapper type for input streams.
+     * @brief Tell the processor the calling thread is spinning.
+     */
+    inline void __cpu_relax() noexcept
+    {
+#if defined(__i386__) || defined(__x86_64__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+
+    /**
+     * @brief Wait a little while spinning on a lock, yielding the processor once the wait gets long.
      *
-     * @tparam istream_t The input stream type.
+     * @param spins The number of times the caller has waited so far, incremented.
      */
-    template<typename istream_t>
-    class pistream: private pstream_base
+    inline void __spin_wait(unsigned int& spins) noexcept
+    {
+        if (spins < 64)
+        {
+            ++spins;
+            __cpu_relax();
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    /// @endcond
+
+    /**
+     * @brief Test-and-test-and-set spinlock, a lock policy for the pstreams.
+     *
+     * Waiters spin reading the lock until it looks free and only then try to take it, so they spin in their own
+     * caches. The cheapest lock to take and release, but unfair: a releasing thread often takes it right back.
+     */
+    class ttas_lock
+    {
+    public:
+        /**
+         * @brief Take the lock, waiting for it if needed.
+         */
+        void lock() noexcept
+        {
+            unsigned int spins = 0;
+            while (m_locked.exchange(true, std::memory_order_acquire))
+            {
+                while (m_locked.load(std::memory_order_relaxed))
+                {
+                    __spin_wait(spins);
+                }
+            }
+        }
+
+        /**
+         * @brief Take the lock if it's free.
+         *
+         * @return bool Whether the lock was taken.
+         */
+        bool try_lock() noexcept
+        {
+            return !m_locked.load(std::memory_order_relaxed) && !m_locked.exchange(true, std::memory_order_acquire);
+        }
+
+        /**
+         * @brief Release the lock.
+         */
+        void unlock() noexcept
+        {
+            m_locked.store(false, std::memory_order_release);
+        }
+
+    private:
+        std::atomic<bool> m_locked{false}; ///< Whether the lock is taken.
+    };
+
+    /**
+     * @brief Fair ticket spinlock, a lock policy for the pstreams.
+     *
+     * Waiters take a ticket and are served in the order of their tickets, so no thread starves. A waiter that
+     * isn't running when its turn comes holds up all the waiters behind it, which makes the lock a poor fit for
+     * more threads than cores.
+     */
+    class ticket_lock
+    {
+    public:
+        /**
+         * @brief Take the lock, waiting for it if needed.
+         */
+        void lock() noexcept
+        {
+            const std::uint32_t ticket = m_next.fetch_add(1, std::memory_order_relaxed);
+            unsigned int spins         = 0;
+            while (m_serving.load(std::memory_order_acquire) != ticket)
+            {
+                __spin_wait(spins);
+            }
+        }
+
+        /**
+         * @brief Take the lock if it's free.
+         *
+         * @return bool Whether the lock was taken.
+         */
+        bool try_lock() noexcept
+        {
+            std::uint32_t serving = m_serving.load(std::memory_order_acquire);
+            return m_next.compare_exchange_strong(
+                serving, serving + 1, std::memory_order_acquire, std::memory_order_relaxed
+            );
+        }
+
+        /**
+         * @brief Release the lock.
+         */
+        void unlock() noexcept
+        {
+            m_serving.store(m_serving.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+    private:
+        alignas(64) std::atomic<std::uint32_t> m_next{0};    ///< The next ticket handed out.
+        alignas(64) std::atomic<std::uint32_t> m_serving{0}; ///< The ticket holding the lock.
+    };
+
+    /**
+     * @brief MCS queue spinlock, a lock policy for the pstreams.
+     *
+     * Waiters line up in a queue of nodes owned by the waiting threads and each of them spins on its own node,
+     * so a release touches the cache of the next waiter only, and the lock is handed over in arrival order.
+     * Scales best of the spinlocks under heavy contention, at the cost of a little more work per acquisition.
+     */
+    class mcs_lock
+    {
+    public:
+        /**
+         * @brief Take the lock, waiting for it if needed.
+         */
+        void lock() noexcept
+        {
+            node* const n    = __acquire_node();
+            node* const prev = m_tail.exchange(n, std::memory_order_acq_rel);
+            if (prev != nullptr)
+            {
+                prev->next.store(n, std::memory_order_release);
+                unsigned int spins = 0;
+                while (n->locked.load(std::memory_order_acquire))
+                {
+                    __spin_wait(spins);
+                }
+            }
+            m_holder = n;
+        }
+
+        /**
+         * @brief Take the lock if it's free.
+         *
+         * @return bool Whether the lock was taken.
+         */
+        bool try_lock() noexcept
+        {
+            node* const n  = __acquire_node();
+            node* expected = nullptr;
+            if (!m_tail.compare_exchange_strong(expected, n, std::memory_order_acquire, std::memory_order_relaxed))
+            {
+                n->in_use = false;
+                return false;
+            }
+            m_holder = n;
+            return true;
+        }
+
+        /**
+         * @brief Release the lock.
+         */
+        void unlock() noexcept
+        {
+            node* const n = m_holder;
+            node* next    = n->next.load(std::memory_order_acquire);
+            if (next == nullptr)
+            {
+                node* expected = n;
+                if (m_tail.compare_exchange_strong(
+                        expected, nullptr, std::memory_order_release, std::memory_order_relaxed
+                    ))
+                {
+                    n->in_use = false;
+                    return;
+                }
+                // A waiter has queued up but hasn't linked itself yet
+                unsigned int spins = 0;
+                while ((next = n->next.load(std::memory_order_acquire)) == nullptr)
+                {
+                    __spin_wait(spins);
+                }
+            }
+            next->locked.store(false, std::memory_order_release);
+            n->in_use = false;
+        }
+
+    private:
+        /**
+         * @brief Queue node of a thread waiting for or holding the lock.
+         */
+        struct alignas(64) node
+        {
+            std::atomic<node*> next{nullptr}; ///< The next waiter.
+            std::atomic<bool> locked{false};  ///< Whether the owner of the node has to keep waiting.
+            bool in_use = false;              ///< Whether the node is queued in a lock, owned by its thread.
+        };
+
+        /**
+         * @brief Get a free node of the calling thread, ready to be queued.
+         *
+         * A thread needs a node for every MCS lock it holds or waits for at once.
+         *
+         * @return node* The node.
+         */
+        static node* __acquire_node()
+        {
+            // A deque never moves its elements, nodes are reused as soon as they are free
+            static thread_local std::deque<node> t_nodes;
+
+            node* n = nullptr;
+            for (node& candidate : t_nodes)
+            {
+                if (!candidate.in_use)
+                {
+                    n = &candidate;
+                    break;
+                }
+            }
+            if (n == nullptr)
+            {
+                n = &t_nodes.emplace_back();
+            }
+            n->in_use = true;
+            n->next.store(nullptr, std::memory_order_relaxed);
+            n->locked.store(true, std::memory_order_relaxed);
+            return n;
+        }
+
+        alignas(64) std::atomic<node*> m_tail{nullptr}; ///< The last waiter, or the holder if nobody waits.
+        node* m_holder = nullptr;                       ///< The node of the holder, used by the holder only.
+    };
+
+    /// @cond SHOW_INTERNAL
+#ifdef EPS_PSTREAM_STATS
+    /**
+     * @brief Lock guarding a wrapped stream object, counting how it's used.
+     *
+     * Meets the Lockable requirements, so it works with the standard lock types. The counters are only
+     * updated by the lock holder, except the chain counters, and can be read at any time.
+     *
+     * @tparam lock_t The lock policy.
+     */
+    template<typename lock_t>
+    class __basic_stream_lock
     {
+    public:
+        /**
+         * @brief Take the lock, waiting for it if needed.
+         */
+        void lock()
+        {
+            std::uint64_t wait = 0;
+            if (m_mtx.try_lock())
+            {
+                m_acquired = clock_type::now();
+            }
+            else
+            {
+                const clock_type::time_point start = clock_type::now();
+                m_mtx.lock();
+                m_acquired = clock_type::now();
+                wait       = __ns(m_acquired - start);
+                __add(m_contended, 1);
+            }
+            __add(m_acquisitions, 1);
+            __add(m_wait_ns, wait);
+            __add(m_wait_histogram[__bucket(wait)], 1);
+        }
+
+        /**
+         * @brief Take the lock if it's free.
+         *
+         * @return bool Whether the lock was taken.
+         */
+        bool try_lock()
+        {
+            if (!m_mtx.try_lock())
+            {
+                return false;
+            }
+            m_acquired = clock_type::now();
+            __add(m_acquisitions, 1);
+            __add(m_wait_histogram[0], 1);
+            return true;
+        }
+
+        /**
+         * @brief Release the lock.
+         */
+        void unlock()
+        {
+            const std::uint64_t held = __ns(clock_type::now() - m_acquired);
+            __add(m_held_ns, held);
+            __add(m_held_histogram[__bucket(held)], 1);
+            m_mtx.unlock();
+        }
+
+        /**
+         * @brief Count a completed chain.
+         *
+         * @param actions The number of I/O operations in the chain.
+         */
+        void __count_chain(std::size_t actions)
+        {
+            m_chains.fetch_add(1, std::memory_order_relaxed);
+            m_actions.fetch_add(actions, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Read the counters.
+         *
+         * @return pstream_stats The current values of the counters.
+         */
+        pstream_stats __snapshot() const
+        {
+            pstream_stats stats;
+            stats.acquisitions = m_acquisitions.load(std::memory_order_relaxed);
+            stats.contended    = m_contended.load(std::memory_order_relaxed);
+            stats.wait_ns      = m_wait_ns.load(std::memory_order_relaxed);
+            stats.held_ns      = m_held_ns.load(std::memory_order_relaxed);
+            stats.chains       = m_chains.load(std::memory_order_relaxed);
+            stats.actions      = m_actions.load(std::memory_order_relaxed);
+            for (std::size_t i = 0; i < pstream_stats::histogram_size; ++i)
+            {
+                stats.wait_histogram[i] = m_wait_histogram[i].load(std::memory_order_relaxed);
+                stats.held_histogram[i] = m_held_histogram[i].load(std::memory_order_relaxed);
+            }
+            return stats;
+        }
+
     private:
+        using clock_type = std::chrono::steady_clock;
+        using counter_t  = std::atomic<std::uint64_t>;
+
+        /**
+         * @brief Add to a counter updated only by the lock holder.
+         *
+         * @param counter The counter.
+         * @param n The value to add.
+         */
+        static void __add(counter_t& counter, std::uint64_t n)
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Convert a duration to nanoseconds.
+         *
+         * @param d The duration.
+         * @return std::uint64_t The number of nanoseconds.
+         */
+        static std::uint64_t __ns(clock_type::duration d)
+        {
+            return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+        }
+
+        /**
+         * @brief Get the histogram bucket of a duration.
+         *
+         * @param ns The duration in nanoseconds.
+         * @return std::size_t The index of the bucket.
+         */
+        static std::size_t __bucket(std::uint64_t ns)
+        {
+            std::size_t bucket = 0;
+            while (ns != 0 && bucket < pstream_stats::histogram_size - 1)
+            {
+                ns >>= 1;
+                ++bucket;
+            }
+            return bucket;
+        }
+
+        lock_t m_mtx;                                                            ///< The actual lock.
+        clock_type::time_point m_acquired;                                       ///< When the lock was taken.
+        counter_t m_acquisitions{0};                                             ///< See pstream_stats.
+        counter_t m_contended{0};                                                ///< See pstream_stats.
+        counter_t m_wait_ns{0};                                                  ///< See pstream_stats.
+        counter_t m_held_ns{0};                                                  ///< See pstream_stats.
+        counter_t m_chains{0};                                                   ///< See pstream_stats.
+        counter_t m_actions{0};                                                  ///< See pstream_stats.
+        std::array<counter_t, pstream_stats::histogram_size> m_wait_histogram{}; ///< See pstream_stats.
+        std::array<counter_t, pstream_stats::histogram_size> m_held_histogram{}; ///< See pstream_stats.
+    };
+#else
+    /**
+     * @brief Lock guarding a wrapped stream object.
+     *
+     * @tparam lock_t The lock policy.
+     */
+    template<typename lock_t>
+    using __basic_stream_lock = lock_t;
+#endif
+
+    /**
+     * @brief Lock guarding a wrapped stream object with the default lock policy.
+     */
+    using __stream_lock = __basic_stream_lock<std::mutex>;
+
+    /**
+     * @brief Identity of a lock policy, the address of its instance of the variable.
+     *
+     * @tparam lock_t The lock policy.
+     */
+    template<typename lock_t>
+    inline constexpr char __lock_policy_tag = 0;
+
+    /**
+     * @brief Count a completed chain in the statistics of a stream, if they are enabled.
+     *
+     * @tparam lock_t The lock policy.
+     * @param lock The lock guarding the stream.
+     * @param actions The number of I/O operations in the chain.
+     */
+    template<typename lock_t>
+    void __count_chain([[maybe_unused]] __basic_stream_lock<lock_t>& lock, [[maybe_unused]] std::size_t actions)
+    {
+#ifdef EPS_PSTREAM_STATS
+        lock.__count_chain(actions);
+#endif
+    }
+
+    /// @endcond
+
+    /**
+     * @brief Base class for the pstreams.
+     *
+     * Every wrapped stream object is guarded by its own lock, shared by all the wrappers around that object,
+     * so wrappers around unrelated streams never block each other. All the wrappers around an object have to
+     * use the same lock policy.
+     */
+    class pstream_base
+    {
+        template<typename stream_t>
+        friend pstream_stats pstream_stats_of(const stream_t& stream);
+        friend std::vector<std::pair<const void*, pstream_stats>> pstream_stats_snapshot();
+
+    protected:
         /// @cond SHOW_INTERNAL
         /**
-         * @brief Accumulates I/O operations to perform atomically.
+         * @brief Registry entry of the lock guarding a wrapped stream object.
+         */
+        struct __stream_lock_entry
+        {
+            std::weak_ptr<void> lock;                         ///< The lock, of the policy below.
+            const void* policy                     = nullptr; ///< The lock policy, see __lock_policy_tag.
+            pstream_stats (*snapshot)(const void*) = nullptr; ///< Reads the statistics of the lock.
+
+            /**
+             * @brief Check whether the lock is gone.
+             *
+             * @return bool Whether no wrapper refers to the lock anymore.
+             */
+            bool expired() const
+            {
+                return lock.expired();
+            }
+        };
+
+        /**
+         * @brief Registry of the locks guarding the wrapped stream objects.
+         */
+        struct __stream_registry
+        {
+            std::mutex mtx;                                             ///< Guards the other members.
+            std::unordered_map<const void*, __stream_lock_entry> locks; ///< The locks by stream.
+            std::size_t sweep_at = 64;                                  ///< Sweeps expired at this size.
+        };
+
+        /**
+         * @brief Get the registry of the mutexes guarding the wrapped stream objects.
+         *
+         * @return __stream_registry& The registry.
+         */
+        static __stream_registry& __registry()
+        {
+            static __stream_registry s_registry;
+            return s_registry;
+        }
+
+        /**
+         * @brief Get the registry key of a stream object, i.e. the address of the most derived object.
+         *
+         * @tparam stream_t The stream type.
+         * @param stream Reference to the stream object.
+         * @return const void* The key.
+         */
+        template<typename stream_t>
+        static const void* __stream_key(const stream_t& stream)
+        {
+            if constexpr (std::is_polymorphic_v<stream_t>)
+            {
+                return dynamic_cast<const void*>(std::addressof(stream));
+            }
+            else
+            {
+                return static_cast<const void*>(std::addressof(stream));
+            }
+        }
+
+        /**
+         * @brief Get the lock guarding a stream object.
+         *
+         * Locks are kept in a registry keyed by the address of the most derived stream object, so
+         * e.g. `pcout` and `pcio` share the lock of `std::cout`. A lock lives as long as any wrapper refers to it.
+         *
+         * @tparam lock_t The lock policy.
+         * @tparam stream_t The stream type.
+         * @param stream Reference to the stream object.
+         * @return std::shared_ptr<__basic_stream_lock<lock_t>> The lock guarding the stream object.
+         * @throws std::logic_error If the stream object is guarded by a lock of another policy.
+         */
+        template<typename lock_t = std::mutex, typename stream_t>
+        static std::shared_ptr<__basic_stream_lock<lock_t>> __stream_mutex(stream_t& stream)
+        {
+            return __stream_mutex<lock_t>(__stream_key(stream));
+        }
+
+        /**
+         * @brief Get the lock registered for a stream object address.
+         *
+         * @tparam lock_t The lock policy.
+         * @param key Address of the most derived stream object.
+         * @return std::shared_ptr<__basic_stream_lock<lock_t>> The lock guarding the stream object.
+         * @throws std::logic_error If the stream object is guarded by a lock of another policy.
+         */
+        template<typename lock_t = std::mutex>
+        static std::shared_ptr<__basic_stream_lock<lock_t>> __stream_mutex(const void* key)
+        {
+            using stream_lock_t = __basic_stream_lock<lock_t>;
+
+            __stream_registry& registry = __registry();
+
+            std::lock_guard<std::mutex> lk{registry.mtx};
+            __stream_lock_entry& entry = registry.locks[key];
+            std::shared_ptr<void> held = entry.lock.lock();
+            if (held && entry.policy != &__lock_policy_tag<lock_t>)
+            {
+                throw std::logic_error{"eps::pstream_base: the stream is already guarded by another lock policy"};
+            }
+            std::shared_ptr<stream_lock_t> mtx = std::static_pointer_cast<stream_lock_t>(held);
+            if (!mtx)
+            {
+                mtx          = std::make_shared<stream_lock_t>();
+                entry.lock   = mtx;
+                entry.policy = &__lock_policy_tag<lock_t>;
+#ifdef EPS_PSTREAM_STATS
+                entry.snapshot = [](const void* lock)
+                {
+                    return static_cast<const stream_lock_t*>(lock)->__snapshot();
+                };
+#endif
+                if (registry.locks.size() >= registry.sweep_at)
+                {
+                    // Forget the streams nobody wraps anymore
+                    for (auto it = registry.locks.begin(); it != registry.locks.end();)
+                    {
+                        it = it->second.expired() ? registry.locks.erase(it) : std::next(it);
+                    }
+                    registry.sweep_at = 2 * registry.locks.size() + 64;
+                }
+            }
+            return mtx;
+        }
+
+        /// @endcond
+    };
+
+    /**
+     * @brief Get the lock statistics of a wrapped stream object.
+     *
+     * The statistics are kept as long as any wrapper refers to the stream object.
+     *
+     * @tparam stream_t The stream type.
+     * @param stream Reference to the stream object.
+     * @return pstream_stats The statistics, all zeros if there are none or they are disabled.
+     */
+    template<typename stream_t>
+    pstream_stats pstream_stats_of([[maybe_unused]] const stream_t& stream)
+    {
+#ifdef EPS_PSTREAM_STATS
+        pstream_base::__stream_registry& registry = pstream_base::__registry();
+
+        std::lock_guard<std::mutex> lk{registry.mtx};
+        const auto it = registry.locks.find(pstream_base::__stream_key(stream));
+        if (it != registry.locks.end())
+        {
+            if (std::shared_ptr<void> mtx = it->second.lock.lock())
+            {
+                return it->second.snapshot(mtx.get());
+            }
+        }
+#endif
+        return {};
+    }
+
+    /**
+     * @brief Get the lock statistics of all the wrapped stream objects, e.g. to export them.
+     *
+     * @return std::vector<std::pair<const void*, pstream_stats>> The statistics by the address of the most derived
+     * stream object, empty if they are disabled.
+     */
+    inline std::vector<std::pair<const void*, pstream_stats>> pstream_stats_snapshot()
+    {
+        std::vector<std::pair<const void*, pstream_stats>> res;
+#ifdef EPS_PSTREAM_STATS
+        pstream_base::__stream_registry& registry = pstream_base::__registry();
+
+        std::lock_guard<std::mutex> lk{registry.mtx};
+        for (const auto& [key, entry] : registry.locks)
+        {
+            if (std::shared_ptr<void> mtx = entry.lock.lock())
+            {
+                res.emplace_back(key, entry.snapshot(mtx.get()));
+            }
+        }
+#endif
+        return res;
+    }
+
+    /**
+     * @brief Thread-safe wrapper type for input streams.
+     *
+     * @tparam istream_t The input stream type.
+     * @tparam lock_t The lock policy, e.g. std::mutex, ttas_lock, ticket_lock or mcs_lock.
+     */
+    template<typename istream_t, typename lock_t = std::mutex>
+    class pistream: private pstream_base
+    {
+    private:
+        /// @cond SHOW_INTERNAL
+        using stream_lock_t = __basic_stream_lock<lock_t>; ///< The lock guarding the stream.
+
+        /**
+         * @brief Accumulates I/O operations to perform atomically.
+         *
+         * The operands of the chain are encoded in the type and kept by reference, so building a chain
+         * never allocates. Operands must outlive the full-expression the chain is built in.
+         *
+         * @tparam Ts The read value types, forwarding-reference style (`T&` for lvalues, `T` for rvalues).
+         */
+        template<typename... Ts>
+        class __pistream_temp
+        {
+            template<typename...>
+            friend class __pistream_temp;
+
+        public:
+            /**
+             * @brief Construct a new __pistream_temp object.
+             *
+             * @param istream Reference to the original input stream.
+             * @param mtx The lock guarding the original input stream.
+             * @param vals References to the values to read.
+             */
+            __pistream_temp(istream_t& istream, stream_lock_t& mtx, std::tuple<Ts&&...> vals):
+                m_istream{istream}, m_mtx{mtx}, m_vals{std::move(vals)}
+            {}
+
+            /**
+             * @brief Move constructor.
+             *
+             * @param other The other __pistream_temp object.
+             */
+            __pistream_temp(__pistream_temp&& other):
+                m_istream{other.m_istream},
+                m_mtx{other.m_mtx},
+                m_vals{std::move(other.m_vals)},
+                m_active{std::exchange(other.m_active, false)}
+            {}
+
+            /**
+             * @brief Destroy the __pistream_temp object performing the accumulated I/O operations atomically.
+             */
+            ~__pistream_temp()
+            {
+                if (!m_active)
+                {
+                    return;
+                }
+
+                std::lock_guard<stream_lock_t> lk{m_mtx};
+                std::apply([this](auto&... vals) { ((m_istream >> vals), ...); }, m_vals);
+                __count_chain(m_mtx, sizeof...(Ts));
+            }
+
+            /**
+             * @brief Add a new I/O operation to the chain.
+             *
+             * @tparam T The read value type.
+             * @param val Stores the value read after performing the action.
+             * @return __pistream_temp<Ts..., T> The chain extended with the new operation.
+             */
+            template<typename T>
+            __pistream_temp<Ts..., T> operator>>(T&& val)
+            {
+                m_active = false;
+                return {
+                    m_istream, m_mtx, std::tuple_cat(std::move(m_vals), std::forward_as_tuple(std::forward<T>(val)))
+                };
+            }
+
+        private:
+            /**
+             * @brief Reference to the original input stream.
+             */
+            istream_t& m_istream;
+            /**
+             * @brief The lock guarding the original input stream.
+             */
+            stream_lock_t& m_mtx;
+            /**
+             * @brief References to the values read upon the object destruction.
+             */
+            std::tuple<Ts&&...> m_vals;
+            /**
+             * @brief Whether the chain ends with this object, i.e. it wasn't extended or moved from.
+             */
+            bool m_active = true;
+        };
+
+    protected:
+        istream_t& m_istream;
+        /**
+         * @brief The lock guarding the original input stream.
+         */
+        std::shared_ptr<stream_lock_t> m_mtx;
+        /// @endcond
+
+    public:
+        /**
+         * @brief Construct a new pistream object.
+         *
+         * @param istream Reference to the original input stream.
+         */
+        explicit pistream(istream_t& istream): m_istream{istream}, m_mtx{__stream_mutex<lock_t>(istream)}
+        {}
+
+        /**
+         * @brief Reads a value after the chain of \>\>s is completed.
+         *
+         * @tparam T The read value type.
+         * @param val Reference to the value read.
+         * @return __pistream_temp<T> Temporary object to continue the chain of \>\>s.
+         */
+        template<typename T>
+        __pistream_temp<T> operator>>(T&& val)
+        {
+            return {m_istream, *m_mtx, std::forward_as_tuple(std::forward<T>(val))};
+        };
+    };
+
+    /**
+     * @brief Chunk of complete records read by a chunked_pistream.
+     *
+     * The chunk refers to the read-ahead buffer of the reader without copying it, the buffer is kept alive
+     * as long as any chunk refers to it. Records keep their trailing delimiter in view(), except possibly
+     * the last record of the input.
+     *
+     * @tparam char_t The character type.
+     * @tparam traits_t The character traits type.
+     */
+    template<typename char_t, typename traits_t = std::char_traits<char_t>>
+    class pistream_chunk
+    {
+        template<typename>
+        friend class chunked_pistream;
+
+    public:
+        using view_type = std::basic_string_view<char_t, traits_t>; ///< The view type of chunks and records.
+
+        /**
+         * @brief Get the characters of the chunk.
+         *
+         * @return view_type The characters, valid as long as the chunk isn't reassigned or destroyed.
+         */
+        view_type view() const
+        {
+            return m_view;
+        }
+
+        /**
+         * @brief Check whether the chunk holds no records.
+         *
+         * @return bool If the chunk is empty.
+         */
+        bool empty() const
+        {
+            return m_view.empty();
+        }
+
+        /**
+         * @brief Get the number of characters in the chunk.
+         *
+         * @return std::size_t The number of characters.
+         */
+        std::size_t size() const
+        {
+            return m_view.size();
+        }
+
+        /**
+         * @brief Call a function on every record of the chunk, without the delimiters.
+         *
+         * @tparam F The function type, called as `f(view_type record)`.
+         * @param f The function.
+         */
+        template<typename F>
+        void for_each_record(F&& f) const
+        {
+            view_type rest = m_view;
+            while (!rest.empty())
+            {
+                const std::size_t end = rest.find(m_delim);
+                if (end == view_type::npos)
+                {
+                    f(rest);
+                    return;
+                }
+                f(rest.substr(0, end));
+                rest.remove_prefix(end + 1);
+            }
+        }
+
+    private:
+        std::shared_ptr<const char_t[]> m_block; ///< The read-ahead buffer the chunk refers to.
+        view_type m_view;                        ///< The characters of the chunk.
+        char_t m_delim{};                        ///< The record delimiter.
+    };
+
+    /**
+     * @brief Thread-safe reader handing out whole chunks of records of an input stream.
+     *
+     * Every call to next() takes the mutex of the stream once and hands out up to about `chunk_size` characters
+     * of complete records, so workers parse them outside the lock and in parallel. The input is read in large
+     * blocks straight from the stream buffer into shared read-ahead buffers the chunks refer to without copying.
+     * A record longer than `chunk_size` is handed out whole in a chunk of its own.
+     *
+     * The reader consumes the input ahead of the chunks it has handed out, so the stream should not be read by
+     * other means meanwhile. The reader is shared by reference between the workers:
+     * @code
+     * eps::chunked_pistream reader{std::cin};
+     * // On every worker thread
+     * eps::pistream_chunk<char> chunk;
+     * while (reader.next(chunk))
+     * {
+     *     chunk.for_each_record([](std::string_view line) { parse(line); });
+     * }
+     * @endcode
+     *
+     * @tparam istream_t The input stream type, derived from `std::basic_istream`.
+     */
+    template<typename istream_t>
+    class chunked_pistream: pstream_base
+    {
+    public:
+        using char_type   = typename istream_t::char_type;          ///< The character type.
+        using traits_type = typename istream_t::traits_type;        ///< The character traits type.
+        using chunk_type  = pistream_chunk<char_type, traits_type>; ///< The chunk type.
+
+    private:
+        /// @cond SHOW_INTERNAL
+        using view_t = std::basic_string_view<char_type, traits_type>;
+
+        /**
+         * @brief Find the end of the chunk starting at the read position, if the read-ahead holds a whole record.
+         *
+         * @return std::size_t The position past the last delimiter of the chunk, or 0 if there's none.
+         */
+        std::size_t __chunk_end() const
+        {
+            const view_t ahead{m_block.get() + m_pos, m_end - m_pos};
+            const std::size_t last = ahead.substr(0, m_chunk_size).rfind(m_delim);
+            if (last != view_t::npos)
+            {
+                return m_pos + last + 1;
+            }
+            // A record longer than a chunk is handed out whole
+            const std::size_t first = ahead.find(m_delim, m_chunk_size);
+            return first != view_t::npos ? m_pos + first + 1 : 0;
+        }
+
+        /**
+         * @brief Read more of the input into the read-ahead, moving the partial record to a new buffer if needed.
+         */
+        void __refill()
+        {
+            if (m_capacity - m_end < m_chunk_size)
+            {
+                // Chunks handed out before keep the old buffer alive
+                const std::size_t partial  = m_end - m_pos;
+                const std::size_t capacity = std::max(m_block_size, 2 * partial + m_chunk_size);
+                std::shared_ptr<char_type[]> block{new char_type[capacity]};
+                traits_type::copy(block.get(), m_block.get() + m_pos, partial);
+                m_block    = std::move(block);
+                m_capacity = capacity;
+                m_pos      = 0;
+                m_end      = partial;
+            }
+
+            const std::streamsize n = m_istream.rdbuf()->sgetn(
+                m_block.get() + m_end, static_cast<std::streamsize>(m_capacity - m_end)
+            );
+            if (n <= 0)
+            {
+                m_eof = true;
+                m_istream.setstate(std::ios_base::eofbit);
+                return;
+            }
+            m_end += static_cast<std::size_t>(n);
+        }
+
+    protected:
+        /**
+         * @brief Reference to the original input stream.
+         */
+        istream_t& m_istream;
+        /**
+         * @brief The mutex guarding the original input stream.
+         */
+        std::shared_ptr<__stream_lock> m_mtx;
+        /**
+         * @brief The preferred size of chunks.
+         */
+        std::size_t m_chunk_size;
+        /**
+         * @brief The size of newly allocated read-ahead buffers.
+         */
+        std::size_t m_block_size;
+        /**
+         * @brief The record delimiter.
+         */
+        char_type m_delim;
+        /**
+         * @brief The current read-ahead buffer.
+         */
+        std::shared_ptr<char_type[]> m_block;
+        /**
+         * @brief The size of the current read-ahead buffer.
+         */
+        std::size_t m_capacity = 0;
+        /**
+         * @brief The position in the read-ahead buffer of the next chunk.
+         */
+        std::size_t m_pos = 0;
+        /**
+         * @brief The end of the read input in the read-ahead buffer.
+         */
+        std::size_t m_end = 0;
+        /**
+         * @brief Whether the end of the input has been reached.
+         */
+        bool m_eof = false;
+        /// @endcond
+
+    public:
+        /**
+         * @brief Construct a new chunked_pistream object reading newline-delimited records.
+         *
+         * @param istream Reference to the original input stream.
+         * @param chunk_size The preferred size of chunks.
+         */
+        explicit chunked_pistream(istream_t& istream, std::size_t chunk_size = 1 << 16):
+            chunked_pistream{istream, chunk_size, istream.widen('\n')}
+        {}
+
+        /**
+         * @brief Construct a new chunked_pistream object.
+         *
+         * @param istream Reference to the original input stream.
+         * @param chunk_size The preferred size of chunks.
+         * @param delim The record delimiter.
+         */
+        chunked_pistream(istream_t& istream, std::size_t chunk_size, char_type delim):
+            m_istream{istream},
+            m_mtx{__stream_mutex(istream)},
+            m_chunk_size{chunk_size == 0 ? 1 : chunk_size},
+            m_block_size{16 * m_chunk_size},
+            m_delim{delim}
+        {}
+
+        chunked_pistream(const chunked_pistream&)            = delete;
+        chunked_pistream& operator=(const chunked_pistream&) = delete;
+
+        /**
+         * @brief Take the next chunk of complete records.
+         *
+         * @param chunk Stores the chunk, releasing the one held before.
+         * @return bool Whether a chunk was taken, false at the end of the input.
+         */
+        bool next(chunk_type& chunk)
+        {
+            // The previous chunk is released outside the lock
+            chunk.m_block.reset();
+            chunk.m_view = {};
+
+            std::lock_guard<__stream_lock> lk{*m_mtx};
+            std::size_t end = 0;
+            while ((end = __chunk_end()) == 0)
+            {
+                if (m_eof)
+                {
+                    // The last record may lack a delimiter
+                    if (m_pos == m_end)
+                    {
+                        return false;
+                    }
+                    end = m_end;
+                    break;
+                }
+                __refill();
+            }
+
+            chunk.m_block = m_block;
+            chunk.m_view  = view_t{m_block.get() + m_pos, end - m_pos};
+            chunk.m_delim = m_delim;
+            m_pos         = end;
+            __count_chain(*m_mtx, 1);
+            return true;
+        }
+    };
+
+    /// @cond SHOW_INTERNAL
+    /**
+     * @brief Accumulates I/O operations to perform atomically.
+     *
+     * The operands of the chain are encoded in the type and kept by reference, so building a chain
+     * never allocates. Operands must outlive the full-expression the chain is built in.
+     * Once the chain is complete the wrapper it was started on writes the operands.
+     *
+     * @tparam postream_t The output stream wrapper type.
+     * @tparam Ts The written value types, forwarding-reference style (`T&` for lvalues, `T` for rvalues).
+     */
+    template<typename postream_t, typename... Ts>
+    class __postream_temp
+    {
+        template<typename, typename...>
+        friend class __postream_temp;
+
+    public:
+        /**
+         * @brief Construct a new __postream_temp object.
+         *
+         * @param postream Reference to the wrapper writing the operands.
+         * @param vals References to the values to write.
+         */
+        __postream_temp(const postream_t& postream, std::tuple<Ts&&...> vals):
+            m_postream{postream}, m_vals{std::move(vals)}
+        {}
+
+        /**
+         * @brief Move constructor.
+         *
+         * @param other The other __postream_temp object.
+         */
+        __postream_temp(__postream_temp&& other):
+            m_postream{other.m_postream},
+            m_vals{std::move(other.m_vals)},
+            m_active{std::exchange(other.m_active, false)}
+        {}
+
+        /**
+         * @brief Destroy the __postream_temp object performing the accumulated I/O operations atomically.
+         */
+        ~__postream_temp()
+        {
+            if (!m_active)
+            {
+                return;
+            }
+
+            std::apply([this](auto&... vals) { m_postream.__write(vals...); }, m_vals);
+        }
+
+        /**
+         * @brief Add a new I/O operation to the chain.
+         *
+         * @tparam T The written value type.
+         * @param val The value to write.
+         * @return __postream_temp<postream_t, Ts..., T> The chain extended with the new operation.
+         */
+        template<typename T>
+        __postream_temp<postream_t, Ts..., T> operator<<(T&& val)
+        {
+            m_active = false;
+            return {m_postream, std::tuple_cat(std::move(m_vals), std::forward_as_tuple(std::forward<T>(val)))};
+        }
+
+    private:
+        /**
+         * @brief Reference to the wrapper writing the operands.
+         */
+        const postream_t& m_postream;
+        /**
+         * @brief References to the values written upon the object destruction.
+         */
+        std::tuple<Ts&&...> m_vals;
+        /**
+         * @brief Whether the chain ends with this object, i.e. it wasn't extended or moved from.
+         */
+        bool m_active = true;
+    };
+
+    /// @endcond
+
+    /**
+     * @brief Thread-safe wrapper type for output streams.
+     *
+     * @tparam ostream_t The output stream type.
+     * @tparam lock_t The lock policy, e.g. std::mutex, ttas_lock, ticket_lock or mcs_lock.
+     */
+    template<typename ostream_t, typename lock_t = std::mutex>
+    class postream: pstream_base
+    {
+    private:
+        /// @cond SHOW_INTERNAL
+        using stream_lock_t = __basic_stream_lock<lock_t>; ///< The lock guarding the stream.
+
+        template<typename, typename...>
+        friend class __postream_temp;
+
+        /**
+         * @brief Write the operands of a complete chain atomically.
+         *
+         * @tparam Ts The written value types.
+         * @param vals The values to write.
+         */
+        template<typename... Ts>
+        void __write(Ts&... vals) const
+        {
+            std::lock_guard<stream_lock_t> lk{*m_mtx};
+            ((m_ostream << vals), ...);
+            __count_chain(*m_mtx, sizeof...(Ts));
+        }
+
+    protected:
+        /**
+         * @brief Reference to the original output stream.
+         */
+        ostream_t& m_ostream;
+        /**
+         * @brief The lock guarding the original output stream.
+         */
+        std::shared_ptr<stream_lock_t> m_mtx;
+        /// @endcond
+
+    public:
+        /**
+         * @brief Construct a new postream object.
+         *
+         * @param ostream Reference to the original output stream.
+         */
+        explicit postream(ostream_t& ostream): m_ostream{ostream}, m_mtx{__stream_mutex<lock_t>(ostream)}
+        {}
+
+        /**
+         * @brief Writes a value after the chain of \<\<s is completed.
+         *
+         * @tparam T The written value type.
+         * @param val The value to write.
+         * @return __postream_temp<postream, T> Temporary object to continue the chain of \<\<s.
+         */
+        template<typename T>
+        __postream_temp<postream, T> operator<<(T&& val)
+        {
+            return {*this, std::forward_as_tuple(std::forward<T>(val))};
+        }
+    };
+
+    /// @cond SHOW_INTERNAL
+    /**
+     * @brief Growable character buffer messages are formatted into.
+     *
+     * Clearing the buffer keeps its storage, so a buffer reused for many messages stops allocating
+     * once it has grown to fit the longest one.
+     *
+     * @tparam char_t The character type.
+     * @tparam traits_t The character traits type.
+     */
+    template<typename char_t, typename traits_t>
+    class __message_buffer: public std::basic_streambuf<char_t, traits_t>
+    {
+    public:
+        using int_type = typename traits_t::int_type;
+
+        /**
+         * @brief Get the characters written since the last clear().
+         *
+         * @return std::basic_string_view<char_t, traits_t> The buffered characters.
+         */
+        std::basic_string_view<char_t, traits_t> view() const
+        {
+            return {this->pbase(), static_cast<std::size_t>(this->pptr() - this->pbase())};
+        }
+
+        /**
+         * @brief Discard the buffered characters keeping the storage.
+         */
+        void clear()
+        {
+            this->setp(m_data.data(), m_data.data() + m_data.size());
+        }
+
+    protected:
+        int_type overflow(int_type ch) override
+        {
+            if (traits_t::eq_int_type(ch, traits_t::eof()))
+            {
+                return traits_t::not_eof(ch);
+            }
+
+            reserve(1);
+            *this->pptr() = traits_t::to_char_type(ch);
+            this->pbump(1);
+            return ch;
+        }
+
+        std::streamsize xsputn(const char_t* s, std::streamsize n) override
+        {
+            reserve(static_cast<std::size_t>(n));
+            traits_t::copy(this->pptr(), s, static_cast<std::size_t>(n));
+            advance(static_cast<std::size_t>(n));
+            return n;
+        }
+
+    private:
+        /**
+         * @brief Make room for more characters after the buffered ones.
+         *
+         * @param n The number of characters to make room for.
+         */
+        void reserve(std::size_t n)
+        {
+            const std::size_t used = static_cast<std::size_t>(this->pptr() - this->pbase());
+            if (m_data.size() - used >= n)
+            {
+                return;
+            }
+
+            m_data.resize(std::max(2 * m_data.size(), std::max<std::size_t>(used + n, 256)));
+            this->setp(m_data.data(), m_data.data() + m_data.size());
+            advance(used);
+        }
+
+        /**
+         * @brief Move the put pointer forward, in steps pbump() takes, so messages may exceed INT_MAX characters.
+         *
+         * @param n The number of characters.
+         */
+        void advance(std::size_t n)
+        {
+            constexpr std::size_t step = static_cast<std::size_t>(std::numeric_limits<int>::max());
+            for (; n > step; n -= step)
+            {
+                this->pbump(static_cast<int>(step));
+            }
+            this->pbump(static_cast<int>(n));
+        }
+
+        std::basic_string<char_t, traits_t> m_data; ///< The buffer storage.
+    };
+
+    /**
+     * @brief Formats messages into a __message_buffer.
+     *
+     * @tparam char_t The character type.
+     * @tparam traits_t The character traits type.
+     */
+    template<typename char_t, typename traits_t>
+    class __message_formatter
+    {
+    public:
+        /**
+         * @brief Construct a new __message_formatter object.
+         */
+        __message_formatter(): m_stream{&m_buffer}
+        {}
+
+        /**
+         * @brief Format the values as they would be written to the target stream.
+         *
+         * @tparam ostream_t The target stream type.
+         * @tparam Ts The formatted value types.
+         * @param target The stream the formatting settings are copied from.
+         * @param vals The values to format.
+         * @return std::basic_string_view<char_t, traits_t> The formatted message, valid until the next call.
+         */
+        template<typename ostream_t, typename... Ts>
+        std::basic_string_view<char_t, traits_t> format(const ostream_t& target, Ts&... vals)
+        {
+            m_buffer.clear();
+            m_stream.clear();
+            m_stream.flags(target.flags());
+            m_stream.precision(target.precision());
+            m_stream.width(0);
+            m_stream.fill(target.fill());
+            if (m_stream.getloc() != target.getloc())
+            {
+                m_stream.imbue(target.getloc());
+            }
+
+            ((m_stream << vals), ...);
+            return m_buffer.view();
+        }
+
+        /**
+         * @brief Get the error state of the last formatting.
+         *
+         * @return std::ios_base::iostate The error state.
+         */
+        std::ios_base::iostate rdstate() const
+        {
+            return m_stream.rdstate();
+        }
+
+        /**
+         * @brief Format the values with the calling thread's formatter and pass the message to a function.
+         *
+         * The thread's formatter is reused across messages; a message formatted while another one is
+         * being formatted on the same thread (e.g. from an operator<<) gets a formatter of its own.
+         *
+         * @tparam ostream_t The target stream type.
+         * @tparam F The function type.
+         * @tparam Ts The formatted value types.
+         * @param target The stream the formatting settings are copied from.
+         * @param f The function called with the formatter and the formatted message.
+         * @param vals The values to format.
+         */
+        template<typename ostream_t, typename F, typename... Ts>
+        static void with_message(const ostream_t& target, F&& f, Ts&... vals)
+        {
+            static thread_local __message_formatter t_formatter;
+
+            if (t_formatter.m_busy)
+            {
+                __message_formatter nested;
+                f(nested, nested.format(target, vals...));
+                return;
+            }
+
+            t_formatter.m_busy = true;
+            struct release
+            {
+                __message_formatter& formatter;
+
+                ~release()
+                {
+                    formatter.m_busy = false;
+                }
+            } r{t_formatter};
+            f(t_formatter, t_formatter.format(target, vals...));
+        }
+
+    private:
+        __message_buffer<char_t, traits_t> m_buffer;  ///< The buffer messages are formatted into.
+        std::basic_ostream<char_t, traits_t> m_stream; ///< The stream formatting into the buffer.
+        bool m_busy = false;                           ///< Whether a message is being formatted.
+    };
+
+    /// @endcond
+
+    /**
+     * @brief Thread-safe wrapper type for output streams formatting messages outside the lock.
+     *
+     * A complete chain of \<\<s is formatted into a reusable per-thread buffer with the formatting
+     * settings of the original stream, then the mutex of the stream is held only to write the formatted
+     * characters with a single `sputn` to its stream buffer. The time the mutex is held thus doesn't
+     * depend on what is being formatted.
+     *
+     * The values are formatted by a `std::basic_ostream<char_type, traits_type>`, so overloads of `operator<<`
+     * taking a more derived stream type are not considered. The flags, precision, fill character and locale
+     * of the stream are read without holding its mutex and must not be changed while messages are written,
+     * the field width of the stream is not used.
+     *
+     * @tparam ostream_t The output stream type, derived from `std::basic_ostream`.
+     */
+    template<typename ostream_t>
+    class buffered_postream: pstream_base
+    {
+    private:
+        /// @cond SHOW_INTERNAL
+        template<typename, typename...>
+        friend class __postream_temp;
+
+        using formatter_t = __message_formatter<typename ostream_t::char_type, typename ostream_t::traits_type>;
+
+        /**
+         * @brief Format the operands of a complete chain and write them atomically.
+         *
+         * @tparam Ts The written value types.
+         * @param vals The values to write.
+         */
+        template<typename... Ts>
+        void __write(Ts&... vals) const
+        {
+            formatter_t::with_message(
+                m_ostream,
+                [this](const formatter_t& formatter, auto message)
+                {
+                    std::lock_guard<__stream_lock> lk{*m_mtx};
+                    __count_chain(*m_mtx, sizeof...(Ts));
+                    typename ostream_t::sentry sentry{m_ostream};
+                    if (!sentry)
+                    {
+                        return;
+                    }
+
+                    const std::streamsize size = static_cast<std::streamsize>(message.size());
+                    if (m_ostream.rdbuf()->sputn(message.data(), size) != size)
+                    {
+                        m_ostream.setstate(std::ios_base::badbit);
+                    }
+                    m_ostream.setstate(formatter.rdstate() & (std::ios_base::failbit | std::ios_base::badbit));
+                },
+                vals...
+            );
+        }
+
+    protected:
+        /**
+         * @brief Reference to the original output stream.
+         */
+        ostream_t& m_ostream;
+        /**
+         * @brief The mutex guarding the original output stream.
+         */
+        std::shared_ptr<__stream_lock> m_mtx;
+        /// @endcond
+
+    public:
+        /**
+         * @brief Construct a new buffered_postream object.
+         *
+         * @param ostream Reference to the original output stream.
+         */
+        explicit buffered_postream(ostream_t& ostream): m_ostream{ostream}, m_mtx{__stream_mutex(ostream)}
+        {
+            // The fill character is initialized on first access, get it done before it's read concurrently
+            m_ostream.fill();
+        }
+
+        /**
+         * @brief Writes a value after the chain of \<\<s is completed.
+         *
+         * @tparam T The written value type.
+         * @param val The value to write.
+         * @return __postream_temp<buffered_postream, T> Temporary object to continue the chain of \<\<s.
+         */
+        template<typename T>
+        __postream_temp<buffered_postream, T> operator<<(T&& val)
+        {
+            return {*this, std::forward_as_tuple(std::forward<T>(val))};
+        }
+    };
+
+    /// @cond SHOW_INTERNAL
+    /**
+     * @brief Get a new unique wrapper id.
+     *
+     * Ids are never reused, so an id cached by a thread never refers to a wrapper created after the one it was
+     * cached for.
+     *
+     * @return std::uint64_t The id.
+     */
+    inline std::uint64_t __next_wrapper_id()
+    {
+        static std::atomic<std::uint64_t> s_next_id{0};
+        return s_next_id.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    class __thread_slot;
+
+    /**
+     * @brief The slots a thread has in the wrappers it writes through, keyed by the ids of the wrappers.
+     */
+    struct __thread_slot_map
+    {
+        std::mutex mtx;                                          ///< Guards the slots against unregistering wrappers.
+        std::unordered_map<std::uint64_t, __thread_slot*> slots; ///< The slots of the thread.
+
+        /**
+         * @brief Get the slot map of the calling thread, closing its slots when the thread exits.
+         *
+         * @return const std::shared_ptr<__thread_slot_map>& The slot map.
+         */
+        static const std::shared_ptr<__thread_slot_map>& __current();
+
+        /**
+         * @brief Check whether the slot map of the calling thread is gone, its slots closed by the thread exiting.
+         *
+         * Stays readable from the thread_local destructors running after that of the slot map.
+         *
+         * @return bool& If the slot map is gone.
+         */
+        static bool& __gone()
+        {
+            static thread_local bool t_gone = false;
+            return t_gone;
+        }
+    };
+
+    /**
+     * @brief State a wrapper keeps for a single thread writing through it.
+     *
+     * A slot is closed once its thread has exited, the wrapper may free it from then on. A slot created by a
+     * thread_local destructor running after the slot map of its thread is gone is never closed, and lives as long
+     * as the wrapper.
+     */
+    class __thread_slot
+    {
+        friend struct __thread_slot_map;
+        template<typename>
+        friend class __thread_slots;
+
+    public:
+        virtual ~__thread_slot() = default;
+
+        /**
+         * @brief Check whether the thread of the slot has exited.
+         *
+         * @return bool If the slot is closed.
+         */
+        bool closed() const
+        {
+            return m_closed.load(std::memory_order_acquire);
+        }
+
+    protected:
+        /**
+         * @brief Called on the thread of the slot as it exits, right before the slot is closed.
+         */
+        virtual void __thread_exit()
+        {}
+
+    private:
+        std::shared_ptr<__thread_slot_map> m_map; ///< The slot map of the thread.
+        std::atomic<bool> m_closed{false};        ///< Whether the thread has exited.
+    };
+
+    inline const std::shared_ptr<__thread_slot_map>& __thread_slot_map::__current()
+    {
+        struct holder
+        {
+            std::shared_ptr<__thread_slot_map> map = std::make_shared<__thread_slot_map>();
+
+            ~holder()
+            {
+                std::lock_guard<std::mutex> lk{map->mtx};
+                for (const auto& [id, slot] : map->slots)
+                {
+                    slot->__thread_exit();
+                    slot->m_closed.store(true, std::memory_order_release);
+                }
+                map->slots.clear();
+                __gone() = true;
+            }
+        };
+
+        static thread_local holder t_holder;
+        return t_holder.map;
+    }
+
+    /**
+     * @brief The slots of the threads writing through a wrapper.
+     *
+     * The wrapper must call __unregister() before it frees anything the __thread_exit() of its slots uses.
+     *
+     * @tparam slot_t The slot type, derived from __thread_slot.
+     */
+    template<typename slot_t>
+    class __thread_slots
+    {
+    public:
+        __thread_slots() = default;
+
+        __thread_slots(const __thread_slots&)            = delete;
+        __thread_slots& operator=(const __thread_slots&) = delete;
+
+        /**
+         * @brief Destroy the __thread_slots object unregistering the slots from their threads.
+         */
+        ~__thread_slots()
+        {
+            __unregister();
+        }
+
+        /**
+         * @brief Get the slot of the calling thread, creating it on first use.
+         *
+         * @tparam Args The types of the arguments of the slot constructor.
+         * @param args The arguments of the slot constructor.
+         * @return slot_t& The slot.
+         */
+        template<typename... Args>
+        slot_t& __get(Args&&... args)
+        {
+            // The slot cached before the thread started exiting is closed, and may have been freed since
+            static thread_local std::uint64_t t_last_id = ~std::uint64_t{0};
+            static thread_local slot_t* t_last          = nullptr;
+            static thread_local bool t_last_gone        = false;
+            const bool gone                             = __thread_slot_map::__gone();
+            if (t_last_id == m_id && t_last_gone == gone)
+            {
+                return *t_last;
+            }
+
+            slot_t* slot = nullptr;
+            if (gone)
+            {
+                // The slot map is destroyed, the slot isn't registered in it and stays open
+                std::unique_ptr<slot_t> created = std::make_unique<slot_t>(std::forward<Args>(args)...);
+                slot                            = created.get();
+                std::lock_guard<std::mutex> lk{m_mtx};
+                m_slots.push_back(std::move(created));
+            }
+            else
+            {
+                const std::shared_ptr<__thread_slot_map>& map = __thread_slot_map::__current();
+                {
+                    std::lock_guard<std::mutex> lk{map->mtx};
+                    const auto it = map->slots.find(m_id);
+                    if (it != map->slots.end())
+                    {
+                        slot = static_cast<slot_t*>(it->second);
+                    }
+                }
+                if (slot == nullptr)
+                {
+                    std::unique_ptr<slot_t> created = std::make_unique<slot_t>(std::forward<Args>(args)...);
+                    created->m_map                  = map;
+                    slot                            = created.get();
+                    {
+                        std::lock_guard<std::mutex> lk{m_mtx};
+                        m_slots.push_back(std::move(created));
+                    }
+                    std::lock_guard<std::mutex> lk{map->mtx};
+                    map->slots.emplace(m_id, slot);
+                }
+            }
+            t_last_id   = m_id;
+            t_last      = slot;
+            t_last_gone = gone;
+            return *slot;
+        }
+
+        /**
+         * @brief Remove the slots of the threads still running from their slot maps.
+         *
+         * Waits for the threads exiting at the same time to finish the __thread_exit() of their slots.
+         */
+        void __unregister()
+        {
+            std::lock_guard<std::mutex> lk{m_mtx};
+            for (const std::unique_ptr<slot_t>& slot : m_slots)
+            {
+                if (slot->m_map)
+                {
+                    std::lock_guard<std::mutex> map_lk{slot->m_map->mtx};
+                    slot->m_map->slots.erase(m_id);
+                }
+            }
+        }
+
+        /**
+         * @brief Call a function on every slot.
+         *
+         * @tparam F The function type.
+         * @param f The function, taking a slot_t&.
+         */
+        template<typename F>
+        void __for_each(F f)
+        {
+            std::lock_guard<std::mutex> lk{m_mtx};
+            for (const std::unique_ptr<slot_t>& slot : m_slots)
+            {
+                f(*slot);
+            }
+        }
+
+        /**
+         * @brief Free the closed slots matching a predicate.
+         *
+         * @tparam F The predicate type.
+         * @param pred The predicate, taking a slot_t&.
+         */
+        template<typename F>
+        void __erase_closed_if(F pred)
+        {
+            std::lock_guard<std::mutex> lk{m_mtx};
+            m_slots.erase(
+                std::remove_if(
+                    m_slots.begin(),
+                    m_slots.end(),
+                    [&pred](const std::unique_ptr<slot_t>& slot) { return slot->closed() && pred(*slot); }
+                ),
+                m_slots.end()
+            );
+        }
+
+    private:
+        std::uint64_t m_id = __next_wrapper_id();     ///< The id of the wrapper, keying its slots.
+        std::mutex m_mtx;                             ///< Guards the list of slots.
+        std::vector<std::unique_ptr<slot_t>> m_slots; ///< The slots of the threads.
+    };
+    /// @endcond
+
+    /**
+     * @brief What a try_postream does with a message when the stream is locked.
+     */
+    enum class contention_policy
+    {
+        drop, ///< Drop the message.
+        park  ///< Park the message in the overflow buffer of the thread, or drop it if the buffer is full.
+    };
+
+    /**
+     * @brief Thread-safe wrapper type for output streams never waiting for the lock.
+     *
+     * A complete chain of \<\<s is formatted into a reusable per-thread buffer like buffered_postream does, with
+     * the same restrictions on the formatting settings of the stream. Then the mutex of the stream is tried a
+     * bounded number of times. If it's taken, the message is written with a single `sputn` after the messages
+     * parked by the thread before, so the messages of a thread keep their order. Otherwise the message is dropped
+     * or parked in a bounded per-thread overflow buffer according to the contention_policy.
+     *
+     * A chain thus never waits for another thread, nor allocates once the buffers of the thread have grown,
+     * only the writing itself can take long if the stream buffer has to write out.
+     *
+     * @tparam ostream_t The output stream type, derived from `std::basic_ostream`.
+     */
+    template<typename ostream_t>
+    class try_postream: pstream_base
+    {
+    private:
+        /// @cond SHOW_INTERNAL
+        template<typename, typename...>
+        friend class __postream_temp;
+
+        using formatter_t = __message_formatter<typename ostream_t::char_type, typename ostream_t::traits_type>;
+        using string_t    = std::basic_string<typename ostream_t::char_type, typename ostream_t::traits_type>;
+        using view_t      = std::basic_string_view<typename ostream_t::char_type, typename ostream_t::traits_type>;
+
+        struct shared_state;
+
+        /**
+         * @brief The overflow buffer of a single thread.
+         */
+        struct overflow_slot: __thread_slot
+        {
+            shared_state& state; ///< The state of the wrapper.
+            string_t buffer;     ///< The messages parked by the thread.
+
+            /**
+             * @brief Construct a new overflow_slot object.
+             *
+             * @param state The state of the wrapper.
+             */
+            explicit overflow_slot(shared_state& state): state{state}
+            {}
+
+        protected:
+            /**
+             * @brief Write the messages the thread has parked and free the buffer as the thread exits.
+             */
+            void __thread_exit() override
+            {
+                if (!buffer.empty())
+                {
+                    std::lock_guard<__stream_lock> lk{*state.mtx};
+                    __write_locked(state.ostream, buffer, view_t{});
+                }
+                string_t{}.swap(buffer);
+            }
+        };
+
+        /**
+         * @brief State shared by the copies of a wrapper.
+         */
+        struct shared_state
+        {
+            ostream_t& ostream;                      ///< Reference to the original output stream.
+            std::shared_ptr<__stream_lock> mtx;      ///< The mutex guarding the original output stream.
+            contention_policy policy;                ///< What to do with a message when the stream is locked.
+            std::size_t spins;                       ///< The number of times the lock is retried.
+            std::size_t overflow_capacity;           ///< The size of the overflow buffer of each thread.
+            std::atomic<std::size_t> dropped{0};     ///< The number of dropped messages.
+            std::atomic<std::size_t> parked{0};      ///< The number of parked messages.
+            std::atomic<std::size_t> written{0};     ///< The number of written messages.
+            __thread_slots<overflow_slot> overflows; ///< The overflow buffers of the threads.
+
+            /**
+             * @brief Construct a new shared_state object.
+             *
+             * @param ostream Reference to the original output stream.
+             * @param mtx The mutex guarding the original output stream.
+             * @param policy What to do with a message when the stream is locked.
+             * @param spins The number of times the lock is retried.
+             * @param overflow_capacity The size of the overflow buffer of each thread.
+             */
+            shared_state(
+                ostream_t& ostream,
+                std::shared_ptr<__stream_lock> mtx,
+                contention_policy policy,
+                std::size_t spins,
+                std::size_t overflow_capacity
+            ):
+                ostream{ostream},
+                mtx{std::move(mtx)},
+                policy{policy},
+                spins{spins},
+                overflow_capacity{overflow_capacity}
+            {}
+
+            /**
+             * @brief Destroy the shared_state object writing the messages still parked by the running threads.
+             */
+            ~shared_state()
+            {
+                // The exited threads have written theirs already
+                overflows.__unregister();
+                overflows.__for_each(
+                    [this](overflow_slot& slot)
+                    {
+                        if (!slot.buffer.empty())
+                        {
+                            std::lock_guard<__stream_lock> lk{*mtx};
+                            __write_locked(ostream, slot.buffer, view_t{});
+                        }
+                    }
+                );
+            }
+        };
+
+        /**
+         * @brief Get the overflow buffer of the calling thread.
+         *
+         * @return string_t& The overflow buffer.
+         */
+        string_t& __overflow() const
+        {
+            return m_state->overflows.__get(*m_state).buffer;
+        }
+
+        /**
+         * @brief Try to take the mutex of the stream a bounded number of times.
+         *
+         * @return bool Whether the mutex was taken.
+         */
+        bool __try_lock() const
+        {
+            for (std::size_t i = 0; i <= m_state->spins; ++i)
+            {
+                if (m_mtx->try_lock())
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * @brief Write the parked messages and a message with the stream's mutex held.
+         *
+         * @param ostream Reference to the original output stream.
+         * @param overflow The overflow buffer of the calling thread.
+         * @param message The message.
+         */
+        static void __write_locked(ostream_t& ostream, string_t& overflow, view_t message)
+        {
+            typename ostream_t::sentry sentry{ostream};
+            if (!sentry)
+            {
+                return;
+            }
+
+            if (!overflow.empty())
+            {
+                // Written separately so the overflow buffer never grows past its capacity
+                const std::streamsize size = static_cast<std::streamsize>(overflow.size());
+                if (ostream.rdbuf()->sputn(overflow.data(), size) != size)
+                {
+                    ostream.setstate(std::ios_base::badbit);
+                }
+                overflow.clear();
+            }
+            const std::streamsize size = static_cast<std::streamsize>(message.size());
+            if (size != 0 && ostream.rdbuf()->sputn(message.data(), size) != size)
+            {
+                ostream.setstate(std::ios_base::badbit);
+            }
+        }
+
+        /**
+         * @brief Park a message in the overflow buffer of the calling thread, if the policy and the room allow.
+         *
+         * @param overflow The overflow buffer of the calling thread.
+         * @param message The message.
+         * @return bool Whether the message was parked.
+         */
+        bool __park(string_t& overflow, view_t message) const
+        {
+            if (m_state->policy != contention_policy::park ||
+                message.size() > m_state->overflow_capacity - overflow.size())
+            {
+                return false;
+            }
+            // Only the threads actually parking get a buffer
+            overflow.reserve(m_state->overflow_capacity);
+            overflow.append(message);
+            m_state->parked.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        /**
+         * @brief Format the operands of a complete chain and write them if the stream isn't locked.
+         *
+         * @tparam Ts The written value types.
+         * @param vals The values to write.
+         */
+        template<typename... Ts>
+        void __write(Ts&... vals) const
+        {
+            formatter_t::with_message(
+                m_ostream,
+                [this](const formatter_t& formatter, view_t message)
+                {
+                    string_t& overflow = __overflow();
+                    if (__try_lock())
+                    {
+                        std::lock_guard<__stream_lock> lk{*m_mtx, std::adopt_lock};
+                        __count_chain(*m_mtx, sizeof...(Ts));
+                        __write_locked(m_ostream, overflow, message);
+                        m_ostream.setstate(formatter.rdstate() & (std::ios_base::failbit | std::ios_base::badbit));
+                        m_state->written.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    else if (!__park(overflow, message))
+                    {
+                        m_state->dropped.fetch_add(1, std::memory_order_relaxed);
+                    }
+                },
+                vals...
+            );
+        }
+
+    protected:
+        /**
+         * @brief Reference to the original output stream.
+         */
+        ostream_t& m_ostream;
+        /**
+         * @brief The mutex guarding the original output stream.
+         */
+        std::shared_ptr<__stream_lock> m_mtx;
+        /**
+         * @brief The state shared by the copies of the wrapper.
+         */
+        std::shared_ptr<shared_state> m_state;
+        /// @endcond
+
+    public:
+        /**
+         * @brief Construct a new try_postream object.
+         *
+         * @param ostream Reference to the original output stream.
+         * @param policy What to do with a message when the stream is locked.
+         * @param overflow_capacity The size of the overflow buffer of each thread.
+         * @param spins The number of times the lock is retried before giving up.
+         */
+        explicit try_postream(
+            ostream_t& ostream,
+            contention_policy policy      = contention_policy::park,
+            std::size_t overflow_capacity = 4096,
+            std::size_t spins             = 16
+        ):
+            m_ostream{ostream},
+            m_mtx{__stream_mutex(ostream)},
+            m_state{std::make_shared<shared_state>(ostream, m_mtx, policy, spins, overflow_capacity)}
+        {
+            // The fill character is initialized on first access, get it done before it's read concurrently
+            m_ostream.fill();
+        }
+
+        /**
+         * @brief Write the messages parked by the calling thread, waiting for the lock if needed.
+         *
+         * Also frees the overflow buffers of the exited threads, which have written their messages on exit.
+         */
+        void flush() const
+        {
+            m_state->overflows.__erase_closed_if([](const overflow_slot&) { return true; });
+            string_t& overflow = __overflow();
+            std::lock_guard<__stream_lock> lk{*m_mtx};
+            __write_locked(m_ostream, overflow, view_t{});
+            m_ostream.flush();
+        }
+
+        /**
+         * @brief Get the number of messages dropped because the stream was locked.
+         *
+         * @return std::size_t The number of dropped messages.
+         */
+        std::size_t dropped() const
+        {
+            return m_state->dropped.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Get the number of messages parked because the stream was locked, written later or still parked.
+         *
+         * @return std::size_t The number of parked messages.
+         */
+        std::size_t parked() const
+        {
+            return m_state->parked.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Get the number of messages written right away.
+         *
+         * @return std::size_t The number of written messages.
+         */
+        std::size_t written() const
+        {
+            return m_state->written.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Writes a value after the chain of \<\<s is completed.
+         *
+         * @tparam T The written value type.
+         * @param val The value to write.
+         * @return __postream_temp<try_postream, T> Temporary object to continue the chain of \<\<s.
+         */
+        template<typename T>
+        __postream_temp<try_postream, T> operator<<(T&& val)
+        {
+            return {*this, std::forward_as_tuple(std::forward<T>(val))};
+        }
+    };
+
+    /**
+     * @brief Sampling of a sampled_postream admitting every Nth chain.
+     */
+    struct sample_every
+    {
+        std::uint64_t n; ///< Every how many chains one is admitted, the first one included.
+    };
+
+    /**
+     * @brief Sampling of a sampled_postream admitting chains at a limited rate with a token bucket.
+     */
+    struct rate_limit
+    {
+        double per_second;   ///< The number of chains admitted per second on average, must be positive.
+        std::uint64_t burst; ///< The number of chains admitted at once after a quiet period.
+    };
+
+    /// @cond SHOW_INTERNAL
+    /**
+     * @brief Sampling state of a call site.
+     *
+     * @tparam sampling_t The sampling type.
+     */
+    template<typename sampling_t>
+    class __sampler;
+
+    /**
+     * @brief Sampling state admitting every Nth chain.
+     */
+    template<>
+    class __sampler<sample_every>
+    {
+    public:
+        /**
+         * @brief Construct a new __sampler object.
+         *
+         * @param sampling The sampling settings.
+         */
+        explicit __sampler(sample_every sampling): m_n{sampling.n == 0 ? 1 : sampling.n}
+        {}
+
+        /**
+         * @brief Decide whether a chain is admitted.
+         *
+         * @param suppressed Set to the number of chains suppressed before this one.
+         * @return bool Whether the chain is admitted.
+         */
+        bool admit(std::uint64_t& suppressed) noexcept
+        {
+            const std::uint64_t count = m_count.fetch_add(1, std::memory_order_relaxed);
+            suppressed                = __suppressed(count);
+            return count % m_n == 0;
+        }
+
+        /**
+         * @brief Get the number of chains suppressed so far.
+         *
+         * @return std::uint64_t The number of chains.
+         */
+        std::uint64_t suppressed() const noexcept
+        {
+            return __suppressed(m_count.load(std::memory_order_relaxed));
+        }
+
+    private:
+        /**
+         * @brief Get the number of chains suppressed among a number of chains decided on.
+         *
+         * @param count The number of chains decided on.
+         * @return std::uint64_t The number of chains suppressed, all but the first of every n.
+         */
+        std::uint64_t __suppressed(std::uint64_t count) const noexcept
+        {
+            return count - count / m_n - (count % m_n != 0 ? 1 : 0);
+        }
+
+        /**
+         * @brief Every how many chains one is admitted.
+         */
+        std::uint64_t m_n;
+        /**
+         * @brief The number of chains decided on.
+         */
+        std::atomic<std::uint64_t> m_count{0};
+    };
+
+    /**
+     * @brief Sampling state admitting chains at a limited rate.
+     *
+     * The token bucket is kept as a single theoretical arrival time, the time the bucket would be full again
+     * at, which is advanced by one interval per admitted chain and may run up to `burst` intervals ahead.
+     */
+    template<>
+    class __sampler<rate_limit>
+    {
+    private:
+        using clock_type = std::chrono::steady_clock;
+        using rep        = clock_type::rep;
+
+    public:
+        /**
+         * @brief Construct a new __sampler object.
+         *
+         * @param sampling The sampling settings.
+         */
+        explicit __sampler(rate_limit sampling):
+            m_interval{__interval(sampling.per_second)},
+            m_tolerance{m_interval * static_cast<rep>(std::max<std::uint64_t>(sampling.burst, 1))}
+        {}
+
+        /**
+         * @brief Decide whether a chain is admitted.
+         *
+         * @param suppressed Set to the number of chains suppressed before this one, if this one is suppressed.
+         * @return bool Whether the chain is admitted.
+         */
+        bool admit(std::uint64_t& suppressed) noexcept
+        {
+            const rep now = clock_type::now().time_since_epoch().count();
+            rep tat       = m_tat.load(std::memory_order_relaxed);
+            while (true)
+            {
+                const rep next = std::max(tat, now) + m_interval;
+                if (next - now > m_tolerance)
+                {
+                    suppressed = m_suppressed.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                if (m_tat.compare_exchange_weak(tat, next, std::memory_order_relaxed))
+                {
+                    return true;
+                }
+            }
+        }
+
+        /**
+         * @brief Get the number of chains suppressed so far.
+         *
+         * @return std::uint64_t The number of chains.
+         */
+        std::uint64_t suppressed() const noexcept
+        {
+            return m_suppressed.load(std::memory_order_relaxed);
+        }
+
+    private:
+        /**
+         * @brief Get the time between two admitted chains.
+         *
+         * @param per_second The number of chains admitted per second on average, must be positive.
+         * @return rep The time between two admitted chains in clock ticks, at least one.
+         */
+        static rep __interval(double per_second)
+        {
+            const std::chrono::duration<double> interval{1 / per_second};
+            return std::max<rep>(std::chrono::duration_cast<clock_type::duration>(interval).count(), 1);
+        }
+
+        /**
+         * @brief The time between two admitted chains in clock ticks.
+         */
+        rep m_interval;
+        /**
+         * @brief How far the theoretical arrival time may run ahead of the current time in clock ticks.
+         */
+        rep m_tolerance;
+        /**
+         * @brief The theoretical arrival time in clock ticks, far in the past for a full bucket.
+         */
+        std::atomic<rep> m_tat{std::numeric_limits<rep>::min() / 2};
+        /**
+         * @brief The number of chains suppressed.
+         */
+        std::atomic<std::uint64_t> m_suppressed{0};
+    };
+
+    /// @endcond
+
+    /**
+     * @brief Adaptor for output stream wrappers sampling or rate limiting the chains of a call site.
+     *
+     * Whether a complete chain is written is decided with a single atomic operation, and a clock read for
+     * rate_limit, before any formatting or locking. An admitted chain is written with the adapted wrapper.
+     * The number of chains suppressed since the last summary, counted by the sampling state itself, is written
+     * as a line `<site>: <n> messages suppressed` at most once per summary period, and when the last copy of the
+     * adaptor is destroyed. It's written by the first admitted chain, or the first of every summary_stride
+     * suppressed chains, after the period has elapsed. A suppressed chain thus costs the single atomic operation,
+     * and once every summary_stride of them a clock read.
+     *
+     * An adaptor is meant to be a single call site, e.g. a static local object:
+     * `static eps::sampled_postream site{eps::pcout, eps::sample_every{1000}, "retry loop"};`.
+     * Copies of an adaptor share its sampling state.
+     *
+     * @tparam postream_t The adapted output stream wrapper type, such as postream or buffered_postream.
+     * @tparam sampling_t The sampling type, sample_every or rate_limit.
+     */
+    template<typename postream_t, typename sampling_t>
+    class sampled_postream
+    {
+    private:
+        /// @cond SHOW_INTERNAL
+        template<typename, typename...>
+        friend class __postream_temp;
+
+        using clock_type = std::chrono::steady_clock;
+
+        /**
+         * @brief Every how many suppressed chains one checks whether a summary line is due.
+         */
+        static constexpr std::uint64_t summary_stride = 64;
+
+        /**
+         * @brief State shared by the copies of an adaptor.
+         */
+        struct shared_state
+        {
+            postream_t postream;                       ///< The adapted wrapper.
+            __sampler<sampling_t> sampler;             ///< The sampling state.
+            const char* site;                          ///< The name of the call site in the summary lines.
+            clock_type::duration summary_period;       ///< The minimum time between two summary lines.
+            std::atomic<std::uint64_t> summarized{0};  ///< The number of chains suppressed as of the last summary.
+            std::atomic<clock_type::rep> next_summary; ///< The time the next summary line is due at.
+
+            /**
+             * @brief Construct a new shared_state object.
+             *
+             * @param postream The adapted wrapper.
+             * @param sampling The sampling settings.
+             * @param site The name of the call site in the summary lines.
+             * @param summary_period The minimum time between two summary lines.
+             */
+            shared_state(
+                postream_t postream, sampling_t sampling, const char* site, clock_type::duration summary_period
+            ):
+                postream{std::move(postream)},
+                sampler{sampling},
+                site{site},
+                summary_period{summary_period},
+                next_summary{(clock_type::now() + summary_period).time_since_epoch().count()}
+            {}
+
+            /**
+             * @brief Destroy the shared_state object writing the last summary line.
+             */
+            ~shared_state()
+            {
+                __summarize(sampler.suppressed());
+            }
+
+            /**
+             * @brief Write a summary line if any chains were suppressed since the last summary.
+             *
+             * @param total The number of chains suppressed so far.
+             */
+            void __summarize(std::uint64_t total)
+            {
+                std::uint64_t last = summarized.load(std::memory_order_relaxed);
+                while (last < total && !summarized.compare_exchange_weak(last, total, std::memory_order_relaxed));
+                if (last < total)
+                {
+                    const std::uint64_t suppressed = total - last;
+                    postream << site << ": " << suppressed << (suppressed == 1 ? " message" : " messages")
+                             << " suppressed" << '\n';
+                }
+            }
+        };
+
+        /**
+         * @brief Write a summary line if one is due.
+         */
+        void __summary() const
+        {
+            const std::uint64_t total = m_state->sampler.suppressed();
+            if (total == m_state->summarized.load(std::memory_order_relaxed))
+            {
+                return;
+            }
+
+            const clock_type::rep now = clock_type::now().time_since_epoch().count();
+            clock_type::rep due       = m_state->next_summary.load(std::memory_order_relaxed);
+            // Only the thread advancing the due time writes the summary line
+            if (now >= due && m_state->next_summary.compare_exchange_strong(
+                                  due, now + m_state->summary_period.count(), std::memory_order_relaxed
+                              ))
+            {
+                m_state->__summarize(total);
+            }
+        }
+
+        /**
+         * @brief Write the operands of a complete chain with the adapted wrapper if the chain is admitted.
+         *
+         * @tparam Ts The written value types.
+         * @param vals The values to write.
+         */
+        template<typename... Ts>
+        void __write(Ts&... vals) const
+        {
+            std::uint64_t suppressed = 0;
+            if (!m_state->sampler.admit(suppressed))
+            {
+                // The summary line still comes once the period has elapsed, even if nothing is admitted by then
+                if ((suppressed + 1) % summary_stride == 0)
+                {
+                    __summary();
+                }
+                return;
+            }
+
+            __summary();
+            (m_state->postream << ... << vals);
+        }
+
+    protected:
+        /**
+         * @brief The state shared by the copies of the adaptor.
+         */
+        std::shared_ptr<shared_state> m_state;
+        /// @endcond
+
+    public:
+        /**
+         * @brief Construct a new sampled_postream object.
+         *
+         * @param postream The adapted output stream wrapper.
+         * @param sampling The sampling settings.
+         * @param site The name of the call site in the summary lines, must outlive the adaptor.
+         * @param summary_period The minimum time between two summary lines.
+         */
+        sampled_postream(
+            postream_t postream,
+            sampling_t sampling,
+            const char* site                    = "eps::sampled_postream",
+            clock_type::duration summary_period = std::chrono::seconds{1}
+        ):
+            m_state{std::make_shared<shared_state>(std::move(postream), sampling, site, summary_period)}
+        {}
+
+        /**
+         * @brief Writes a value after the chain of \<\<s is completed, if the chain is admitted.
+         *
+         * @tparam T The written value type.
+         * @param val The value to write.
+         * @return __postream_temp<sampled_postream, T> Temporary object to continue the chain of \<\<s.
+         */
+        template<typename T>
+        __postream_temp<sampled_postream, T> operator<<(T&& val)
+        {
+            return {*this, std::forward_as_tuple(std::forward<T>(val))};
+        }
+    };
+
+    /// @cond SHOW_INTERNAL
+    /**
+     * @brief Type codes of the operands in the records written by binary_postream.
+     */
+    enum class __binary_type : std::uint8_t
+    {
+        boolean,                    ///< `bool`.
+        character,                  ///< `char`.
+        signed_character,           ///< `signed char`.
+        unsigned_character,         ///< `unsigned char`.
+        short_integer,              ///< `short`.
+        unsigned_short_integer,     ///< `unsigned short`.
+        integer,                    ///< `int`.
+        unsigned_integer,           ///< `unsigned int`.
+        long_integer,               ///< `long`.
+        unsigned_long_integer,      ///< `unsigned long`.
+        long_long_integer,          ///< `long long`.
+        unsigned_long_long_integer, ///< `unsigned long long`.
+        single_float,               ///< `float`.
+        double_float,               ///< `double`.
+        long_double_float,          ///< `long double`.
+        string                      ///< A narrow string, stored as its 32-bit length followed by its characters.
+    };
+
+    /**
+     * @brief Get the type code of an operand type of binary_postream, checking the type is supported.
+     *
+     * @tparam T The operand type.
+     * @return __binary_type The type code.
+     */
+    template<typename T>
+    constexpr __binary_type __binary_type_of()
+    {
+        using U = std::decay_t<T>;
+        if constexpr (std::is_same_v<U, bool>)
+        {
+            return __binary_type::boolean;
+        }
+        else if constexpr (std::is_same_v<U, char>)
+        {
+            return __binary_type::character;
+        }
+        else if constexpr (std::is_same_v<U, signed char>)
+        {
+            return __binary_type::signed_character;
+        }
+        else if constexpr (std::is_same_v<U, unsigned char>)
+        {
+            return __binary_type::unsigned_character;
+        }
+        else if constexpr (std::is_same_v<U, short>)
+        {
+            return __binary_type::short_integer;
+        }
+        else if constexpr (std::is_same_v<U, unsigned short>)
+        {
+            return __binary_type::unsigned_short_integer;
+        }
+        else if constexpr (std::is_same_v<U, int>)
+        {
+            return __binary_type::integer;
+        }
+        else if constexpr (std::is_same_v<U, unsigned int>)
+        {
+            return __binary_type::unsigned_integer;
+        }
+        else if constexpr (std::is_same_v<U, long>)
+        {
+            return __binary_type::long_integer;
+        }
+        else if constexpr (std::is_same_v<U, unsigned long>)
+        {
+            return __binary_type::unsigned_long_integer;
+        }
+        else if constexpr (std::is_same_v<U, long long>)
+        {
+            return __binary_type::long_long_integer;
+        }
+        else if constexpr (std::is_same_v<U, unsigned long long>)
+        {
+            return __binary_type::unsigned_long_long_integer;
+        }
+        else if constexpr (std::is_same_v<U, float>)
+        {
+            return __binary_type::single_float;
+        }
+        else if constexpr (std::is_same_v<U, double>)
+        {
+            return __binary_type::double_float;
+        }
+        else if constexpr (std::is_same_v<U, long double>)
+        {
+            return __binary_type::long_double_float;
+        }
+        else
+        {
+            static_assert(
+                std::is_same_v<U, const char*> || std::is_same_v<U, char*> || std::is_same_v<U, std::string> ||
+                    std::is_same_v<U, std::string_view>,
+                "binary_postream operands must be fundamental arithmetic types or narrow strings"
+            );
+            return __binary_type::string;
+        }
+    }
+
+    /**
+     * @brief Append the raw value of an operand of binary_postream to a record.
+     *
+     * A null `const char*` is appended as an empty string.
+     *
+     * @tparam T The operand type.
+     * @param record The record.
+     * @param val The operand.
+     * @return bool Whether the operand is appended, false for a string too long for its 32-bit length.
+     */
+    template<typename T>
+    bool __binary_append(std::string& record, const T& val)
+    {
+        if constexpr (__binary_type_of<T>() == __binary_type::string)
+        {
+            std::string_view str;
+            if constexpr (std::is_pointer_v<T>)
+            {
+                if (val != nullptr)
+                {
+                    str = val;
+                }
+            }
+            else
+            {
+                str = val;
+            }
+            if (str.size() > std::numeric_limits<std::uint32_t>::max())
+            {
+                return false;
+            }
+            const std::uint32_t size = static_cast<std::uint32_t>(str.size());
+            record.append(reinterpret_cast<const char*>(&size), sizeof(size));
+            record.append(str.data(), size);
+        }
+        else
+        {
+            record.append(reinterpret_cast<const char*>(&val), sizeof(val));
+        }
+        return true;
+    }
+
+    /**
+     * @brief Read a raw value of a record of binary_postream.
+     *
+     * Only the bytes of valid values are copied into a `bool` or an enum, as other bytes would make it hold an
+     * invalid value.
+     *
+     * @tparam T The value type, an arithmetic type or an enum with a fixed underlying type.
+     * @param pos The position of the value in the record, advanced past it.
+     * @param end The end of the record.
+     * @return T The value.
+     * @throws std::runtime_error If the record ends before the value or a `bool` is neither 0 nor 1.
+     */
+    template<typename T>
+    T __binary_read(const char*& pos, const char* end)
+    {
+        if constexpr (std::is_same_v<T, bool>)
+        {
+            const unsigned char byte = __binary_read<unsigned char>(pos, end);
+            if (byte > 1)
+            {
+                throw std::runtime_error{"Malformed binary log record"};
+            }
+            return byte == 1;
+        }
+        else if constexpr (std::is_enum_v<T>)
+        {
+            // Any value of the underlying type is a valid value of an enum with a fixed underlying type
+            return static_cast<T>(__binary_read<std::underlying_type_t<T>>(pos, end));
+        }
+        else
+        {
+            static_assert(std::is_arithmetic_v<T>, "Only arithmetic values and enums are read from binary logs");
+            if (static_cast<std::size_t>(end - pos) < sizeof(T))
+            {
+                throw std::runtime_error{"Malformed binary log record"};
+            }
+            T val;
+            std::memcpy(&val, pos, sizeof(T));
+            pos += sizeof(T);
+            return val;
+        }
+    }
+
+    /**
+     * @brief Write an operand of a record of binary_postream into a stream as text.
+     *
+     * @tparam ostream_t The output stream type.
+     * @param type The type code of the operand.
+     * @param pos The position of the operand in the record, advanced past it.
+     * @param end The end of the record.
+     * @param ostream The stream to write the operand into.
+     * @throws std::runtime_error If the type code is unknown or the record ends before the operand.
+     */
+    template<typename ostream_t>
+    void __binary_put(__binary_type type, const char*& pos, const char* end, ostream_t& ostream)
+    {
+        switch (type)
+        {
+        case __binary_type::boolean:
+            ostream << __binary_read<bool>(pos, end);
+            break;
+        case __binary_type::character:
+            ostream << __binary_read<char>(pos, end);
+            break;
+        case __binary_type::signed_character:
+            ostream << __binary_read<signed char>(pos, end);
+            break;
+        case __binary_type::unsigned_character:
+            ostream << __binary_read<unsigned char>(pos, end);
+            break;
+        case __binary_type::short_integer:
+            ostream << __binary_read<short>(pos, end);
+            break;
+        case __binary_type::unsigned_short_integer:
+            ostream << __binary_read<unsigned short>(pos, end);
+            break;
+        case __binary_type::integer:
+            ostream << __binary_read<int>(pos, end);
+            break;
+        case __binary_type::unsigned_integer:
+            ostream << __binary_read<unsigned int>(pos, end);
+            break;
+        case __binary_type::long_integer:
+            ostream << __binary_read<long>(pos, end);
+            break;
+        case __binary_type::unsigned_long_integer:
+            ostream << __binary_read<unsigned long>(pos, end);
+            break;
+        case __binary_type::long_long_integer:
+            ostream << __binary_read<long long>(pos, end);
+            break;
+        case __binary_type::unsigned_long_long_integer:
+            ostream << __binary_read<unsigned long long>(pos, end);
+            break;
+        case __binary_type::single_float:
+            ostream << __binary_read<float>(pos, end);
+            break;
+        case __binary_type::double_float:
+            ostream << __binary_read<double>(pos, end);
+            break;
+        case __binary_type::long_double_float:
+            ostream << __binary_read<long double>(pos, end);
+            break;
+        case __binary_type::string:
+        {
+            const std::uint32_t size = __binary_read<std::uint32_t>(pos, end);
+            if (static_cast<std::size_t>(end - pos) < size)
+            {
+                throw std::runtime_error{"Malformed binary log record"};
+            }
+            ostream << std::string_view{pos, size};
+            pos += size;
+            break;
+        }
+        default:
+            throw std::runtime_error{"Malformed binary log record"};
+        }
+    }
+
+    /// @endcond
+
+    /**
+     * @brief Thread-safe wrapper type for output streams writing binary records instead of text.
+     *
+     * A complete chain of \<\<s is captured as a record holding the raw values of the operands, which is
+     * written to the stream with a single `sputn` under the mutex of the stream. Nothing is formatted on the
+     * writing thread, the text is produced later by decode_binary_log(), on a background thread or offline.
+     *
+     * The operand types are checked at compile time: fundamental arithmetic types and narrow strings, i.e.
+     * `const char*`, `std::string` and `std::string_view`, are supported. Every record starts with its size and
+     * the schema of the chain, the type codes of its operands, which is a compile-time constant of the chain's
+     * operand types, so logs are self-describing. Values are stored in the native representation, logs are
+     * meant to be decoded on the same platform.
+     *
+     * Record layout: `uint32 size | uint8 operand count | uint8 type code... | values...`, the size counting
+     * the bytes after it. A null `const char*` is recorded as an empty string. A chain whose record doesn't fit
+     * this layout, such as one with a string of 4 GiB or more, is rejected rather than clamped: nothing is
+     * written and failbit is set on the stream.
+     *
+     * @tparam ostream_t The output stream type, derived from `std::ostream` and opened in binary mode.
+     */
+    template<typename ostream_t>
+    class binary_postream: pstream_base
+    {
+        static_assert(std::is_same_v<typename ostream_t::char_type, char>, "Binary logs are narrow streams");
+
+    private:
+        /// @cond SHOW_INTERNAL
+        template<typename, typename...>
+        friend class __postream_temp;
+
+        /**
+         * @brief Capture the operands of a complete chain into a record and write it atomically.
+         *
+         * @tparam Ts The written value types.
+         * @param vals The values to write.
+         */
+        template<typename... Ts>
+        void __write(Ts&... vals) const
+        {
+            static_assert(sizeof...(Ts) <= 255, "Too many operands in a binary_postream chain");
+            static constexpr __binary_type s_schema[] = {__binary_type_of<Ts>()...};
+
+            static thread_local std::string t_record;
+            t_record.assign(sizeof(std::uint32_t), '\0');
+            t_record.push_back(static_cast<char>(sizeof...(Ts)));
+            t_record.append(reinterpret_cast<const char*>(s_schema), sizeof(s_schema));
+            const bool fits = (__binary_append(t_record, vals) && ...) &&
+                              t_record.size() - sizeof(std::uint32_t) <= std::numeric_limits<std::uint32_t>::max();
+            const std::uint32_t size = static_cast<std::uint32_t>(t_record.size() - sizeof(std::uint32_t));
+            std::memcpy(t_record.data(), &size, sizeof(size));
+
+            std::lock_guard<__stream_lock> lk{*m_mtx};
+            if (!fits)
+            {
+                m_ostream.setstate(std::ios_base::failbit);
+                return;
+            }
+            __count_chain(*m_mtx, sizeof...(Ts));
+            std::ostream::sentry sentry{m_ostream};
+            if (!sentry)
+            {
+                return;
+            }
+
+            const std::streamsize record_size = static_cast<std::streamsize>(t_record.size());
+            if (m_ostream.rdbuf()->sputn(t_record.data(), record_size) != record_size)
+            {
+                m_ostream.setstate(std::ios_base::badbit);
+            }
+        }
+
+    protected:
+        /**
+         * @brief Reference to the original output stream.
+         */
+        ostream_t& m_ostream;
+        /**
+         * @brief The mutex guarding the original output stream.
+         */
+        std::shared_ptr<__stream_lock> m_mtx;
+        /// @endcond
+
+    public:
+        /**
+         * @brief Construct a new binary_postream object.
+         *
+         * @param ostream Reference to the original output stream.
+         */
+        explicit binary_postream(ostream_t& ostream): m_ostream{ostream}, m_mtx{__stream_mutex(ostream)}
+        {}
+
+        /**
+         * @brief Writes a value after the chain of \<\<s is completed.
+         *
+         * @tparam T The written value type.
+         * @param val The value to write.
+         * @return __postream_temp<binary_postream, T> Temporary object to continue the chain of \<\<s.
+         */
+        template<typename T>
+        __postream_temp<binary_postream, T> operator<<(T&& val)
+        {
+            return {*this, std::forward_as_tuple(std::forward<T>(val))};
+        }
+    };
+
+    /**
+     * @brief Decode the records written by binary_postream into text.
+     *
+     * Every operand is written into the output stream the way postream would have written it, so the text is
+     * exactly what a postream around a stream with the formatting settings of the output stream would have
+     * produced. Decoding stops at the end of the log or at a record cut short, such as the last one of a log
+     * whose writer has crashed, all the complete records before it are decoded.
+     *
+     * @tparam ostream_t The output stream type.
+     * @param istream The binary log, opened in binary mode.
+     * @param ostream The stream to write the text into.
+     * @return std::size_t The number of decoded records.
+     * @throws std::runtime_error If a record is malformed.
+     */
+    template<typename ostream_t>
+    std::size_t decode_binary_log(std::istream& istream, ostream_t& ostream)
+    {
+        std::size_t records = 0;
+        std::string record;
+        while (true)
+        {
+            std::uint32_t size = 0;
+            if (!istream.read(reinterpret_cast<char*>(&size), sizeof(size)))
+            {
+                break;
+            }
+            record.resize(size);
+            if (!istream.read(record.data(), size))
+            {
+                break;
+            }
+
+            const char* pos = record.data();
+            const char* end = record.data() + record.size();
+            if (size == 0 || static_cast<std::size_t>(end - pos - 1) < static_cast<unsigned char>(*pos))
+            {
+                throw std::runtime_error{"Malformed binary log record"};
+            }
+            const char* const schema     = pos + 1;
+            const char* const schema_end = schema + static_cast<unsigned char>(*pos);
+            pos                          = schema_end;
+            for (const char* type = schema; type != schema_end;)
+            {
+                __binary_put(__binary_read<__binary_type>(type, schema_end), pos, end, ostream);
+            }
+            ++records;
+        }
+        return records;
+    }
+
+    /**
+     * @brief Wrapper type for thread-safe message sinks.
+     *
+     * A complete chain of \<\<s is formatted into a reusable per-thread buffer with the default formatting
+     * settings of streams and handed to the sink as a single message with `sink.write_message(data, size)`.
+     * No lock is taken, the sink itself must accept messages from several threads at once and keep each of
+     * them whole.
+     *
+     * @tparam sink_t The sink type, providing `char_type`, `traits_type` and `write_message()`.
+     */
+    template<typename sink_t>
+    class sink_postream
+    {
+    private:
+        /// @cond SHOW_INTERNAL
+        template<typename, typename...>
+        friend class __postream_temp;
+
+        using formatter_t = __message_formatter<typename sink_t::char_type, typename sink_t::traits_type>;
+        using view_t      = std::basic_string_view<typename sink_t::char_type, typename sink_t::traits_type>;
+
+        /**
+         * @brief Default formatting settings of streams.
+         */
+        struct default_format: std::basic_ios<typename sink_t::char_type, typename sink_t::traits_type>
+        {
+            default_format(): std::basic_ios<typename sink_t::char_type, typename sink_t::traits_type>{nullptr}
+            {
+                // The fill character is initialized on first access, get it done before it's read concurrently
+                this->fill();
+            }
+        };
+
+        /**
+         * @brief Format the operands of a complete chain and hand the message to the sink.
+         *
+         * @tparam Ts The written value types.
+         * @param vals The values to write.
+         */
+        template<typename... Ts>
+        void __write(Ts&... vals) const
+        {
+            static const default_format s_format;
+
+            formatter_t::with_message(
+                s_format,
+                [this](const formatter_t&, view_t message) { m_sink.write_message(message.data(), message.size()); },
+                vals...
+            );
+        }
+
+    protected:
+        /**
+         * @brief Reference to the original sink.
+         */
+        sink_t& m_sink;
+        /// @endcond
+
+    public:
+        /**
+         * @brief Construct a new sink_postream object.
+         *
+         * @param sink Reference to the original sink.
+         */
+        explicit sink_postream(sink_t& sink): m_sink{sink}
+        {}
+
+        /**
+         * @brief Writes a value after the chain of \<\<s is completed.
+         *
+         * @tparam T The written value type.
+         * @param val The value to write.
+         * @return __postream_temp<sink_postream, T> Temporary object to continue the chain of \<\<s.
+         */
+        template<typename T>
+        __postream_temp<sink_postream, T> operator<<(T&& val)
+        {
+            return {*this, std::forward_as_tuple(std::forward<T>(val))};
+        }
+    };
+
+    /**
+     * @brief Thread-safe wrapper type for output streams coalescing concurrent messages into batches.
+     *
+     * A complete chain of \<\<s is formatted on the calling thread like buffered_postream does, with the same
+     * restrictions on the formatting settings of the stream, and appended to a pending batch. If no thread
+     * is writing to the stream, the calling thread takes the writer role and writes the pending batch with
+     * a single `sputn` followed by a flush under the mutex of the stream, then writes the messages other
+     * threads appended meanwhile as a second batch (group commit). The threads appending during that last
+     * batch wait for the role, and one of them takes it over, so no thread writes for the others for long.
+     * Under contention, many messages thus reach the stream with one write instead of one write each, while
+     * every message stays whole and the messages of each thread keep their order.
+     *
+     * Copies of a batched_postream share the pending batch.
+     *
+     * @tparam ostream_t The output stream type, derived from `std::basic_ostream`.
+     */
+    template<typename ostream_t>
+    class batched_postream: pstream_base
+    {
+    private:
+        /// @cond SHOW_INTERNAL
+        template<typename, typename...>
+        friend class __postream_temp;
+
+        using formatter_t = __message_formatter<typename ostream_t::char_type, typename ostream_t::traits_type>;
+        using string_t    = std::basic_string<typename ostream_t::char_type, typename ostream_t::traits_type>;
+        using view_t      = std::basic_string_view<typename ostream_t::char_type, typename ostream_t::traits_type>;
+
+        /**
+         * @brief The state shared by the copies of a batched_postream.
+         */
+        struct batch_state
+        {
+            std::mutex mtx;              ///< Guards the other members.
+            std::condition_variable cv;  ///< Notified when the pending batch is taken by the writer.
+            string_t pending;            ///< The messages waiting for the writer.
+            string_t writing;            ///< The batch being written, owned by the writer.
+            bool writer_active = false;  ///< Whether a thread has the writer role.
+            bool handoff       = false;  ///< Whether the writer is writing its last batch before giving the role up.
+            std::size_t max_pending;     ///< The size of the pending batch producers wait to go below.
+        };
+
+        /**
+         * @brief The number of batches a writer writes before handing the writer role over.
+         */
+        static constexpr std::size_t writer_batches = 2;
+
+        /**
+         * @brief Format the operands of a complete chain and append the message to the pending batch.
+         *
+         * @tparam Ts The written value types.
+         * @param vals The values to write.
+         */
+        template<typename... Ts>
+        void __write(Ts&... vals) const
+        {
+            __count_chain(*m_mtx, sizeof...(Ts));
+            formatter_t::with_message(
+                m_ostream, [this](const formatter_t&, view_t message) { __commit(message); }, vals...
+            );
+        }
+
+        /**
+         * @brief Append a formatted message to the pending batch, writing the batches if no one else does.
+         *
+         * @param message The message.
+         */
+        void __commit(view_t message) const
+        {
+            batch_state& state = *m_state;
+
+            std::unique_lock<std::mutex> lk{state.mtx};
+            state.cv.wait(lk, [&state]() { return state.pending.size() < state.max_pending; });
+            state.pending.append(message);
+            if (state.writer_active)
+            {
+                if (!state.handoff)
+                {
+                    return;
+                }
+                // The writer leaves the messages appended during its last batch to one of their threads
+                state.cv.wait(lk, [&state]() { return !state.writer_active || !state.handoff; });
+                if (state.writer_active)
+                {
+                    return;
+                }
+            }
+
+            state.writer_active = true;
+
+            // Give the writer role back even if writing throws, or later messages would pile up with no writer
+            struct writer_release
+            {
+                batch_state& state;
+                std::unique_lock<std::mutex>& lk;
+
+                ~writer_release()
+                {
+                    if (!lk.owns_lock())
+                    {
+                        lk.lock();
+                    }
+                    state.writing.clear();
+                    state.writer_active = false;
+                    state.handoff       = false;
+                    state.cv.notify_all();
+                }
+            } release{state, lk};
+
+            for (std::size_t batch = 1; !state.handoff && !state.pending.empty(); ++batch)
+            {
+                state.handoff = batch == writer_batches;
+                state.writing.swap(state.pending);
+                lk.unlock();
+                state.cv.notify_all();
+
+                {
+                    std::lock_guard<__stream_lock> stream_lk{*m_mtx};
+                    typename ostream_t::sentry sentry{m_ostream};
+                    if (sentry)
+                    {
+                        // Like the output functions of the stream, a throwing stream buffer sets badbit
+                        const std::streamsize size = static_cast<std::streamsize>(state.writing.size());
+                        bool written               = false;
+                        try
+                        {
+                            written = m_ostream.rdbuf()->sputn(state.writing.data(), size) == size;
+                        }
+                        catch (...)
+                        {
+                        }
+                        if (!written)
+                        {
+                            m_ostream.setstate(std::ios_base::badbit);
+                        }
+                        m_ostream.flush();
+                    }
+                }
+                state.writing.clear();
+
+                lk.lock();
+            }
+        }
+
+    protected:
+        /**
+         * @brief Reference to the original output stream.
+         */
+        ostream_t& m_ostream;
+        /**
+         * @brief The mutex guarding the original output stream.
+         */
+        std::shared_ptr<__stream_lock> m_mtx;
+        /**
+         * @brief The state shared by the copies of the wrapper.
+         */
+        std::shared_ptr<batch_state> m_state;
+        /// @endcond
+
+    public:
+        /**
+         * @brief Construct a new batched_postream object.
+         *
+         * @param ostream Reference to the original output stream.
+         * @param max_pending The size of the pending batch, in characters, above which producers wait
+         * for the writer to take it, at least 1.
+         */
+        explicit batched_postream(ostream_t& ostream, std::size_t max_pending = 1 << 20):
+            m_ostream{ostream}, m_mtx{__stream_mutex(ostream)}, m_state{std::make_shared<batch_state>()}
+        {
+            m_state->max_pending = std::max<std::size_t>(max_pending, 1);
+            // The fill character is initialized on first access, get it done before it's read concurrently
+            m_ostream.fill();
+        }
+
+        /**
+         * @brief Writes a value after the chain of \<\<s is completed.
+         *
+         * @tparam T The written value type.
+         * @param val The value to write.
+         * @return __postream_temp<batched_postream, T> Temporary object to continue the chain of \<\<s.
+         */
+        template<typename T>
+        __postream_temp<batched_postream, T> operator<<(T&& val)
+        {
+            return {*this, std::forward_as_tuple(std::forward<T>(val))};
+        }
+    };
+
+    /**
+     * @brief What an async_postream does with a message when its queue is full.
+     */
+    enum class overflow_policy
+    {
+        block,       ///< Wait until the queue has room for the message.
+        drop_newest, ///< Drop the message.
+        drop_oldest  ///< Drop the oldest queued message to make room for the message.
+    };
+
+    /// @cond SHOW_INTERNAL
+    /**
+     * @brief Bounded lock-free multi-producer multi-consumer queue of messages.
+     *
+     * Every slot carries a sequence number telling whether it's ready to be pushed to or popped from
+     * for the current lap over the ring. Messages are strings kept in the slots and swapped in and out,
+     * so the queue stops allocating once its slots have grown to fit the messages passed through it.
+     *
+     * @tparam string_t The message type.
+     */
+    template<typename string_t>
+    class __message_ring
+    {
+    public:
+        /**
+         * @brief Construct a new __message_ring object.
+         *
+         * @param capacity The minimum number of messages the queue holds, rounded up to a power of two.
+         */
+        explicit __message_ring(std::size_t capacity)
+        {
+            std::size_t size = 2;
+            while (size < capacity)
+            {
+                size *= 2;
+            }
+            m_mask  = size - 1;
+            m_slots = std::make_unique<slot[]>(size);
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                m_slots[i].seq.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        /**
+         * @brief Push a message unless the queue is full.
+         *
+         * @param message The message.
+         * @return bool If the message was pushed.
+         */
+        template<typename view_t>
+        bool try_push(view_t message)
+        {
+            std::size_t pos = m_push_pos.load(std::memory_order_relaxed);
+            while (true)
+            {
+                slot& s                 = m_slots[pos & m_mask];
+                const std::size_t seq   = s.seq.load(std::memory_order_acquire);
+                const std::ptrdiff_t df = static_cast<std::ptrdiff_t>(seq - pos);
+                if (df == 0)
+                {
+                    if (m_push_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        s.message.assign(message.data(), message.size());
+                        s.seq.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (df < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    pos = m_push_pos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        /**
+         * @brief Pop the oldest message unless the queue is empty.
+         *
+         * @param message Receives the message, its previous contents are left in the queue's slot for reuse.
+         * @return bool If a message was popped.
+         */
+        bool try_pop(string_t& message)
+        {
+            std::size_t pos = m_pop_pos.load(std::memory_order_relaxed);
+            while (true)
+            {
+                slot& s                 = m_slots[pos & m_mask];
+                const std::size_t seq   = s.seq.load(std::memory_order_acquire);
+                const std::ptrdiff_t df = static_cast<std::ptrdiff_t>(seq - (pos + 1));
+                if (df == 0)
+                {
+                    if (m_pop_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        message.swap(s.message);
+                        s.seq.store(pos + m_mask + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (df < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    pos = m_pop_pos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        /**
+         * @brief Get the number of messages the queue holds.
+         *
+         * @return std::size_t The number of slots.
+         */
+        std::size_t capacity() const
+        {
+            return m_mask + 1;
+        }
+
+        /**
+         * @brief Get the number of pushes started so far.
+         *
+         * @return std::size_t The push position.
+         */
+        std::size_t push_pos() const
+        {
+            return m_push_pos.load();
+        }
+
+        /**
+         * @brief Get the number of pops started so far.
+         *
+         * @return std::size_t The pop position.
+         */
+        std::size_t pop_pos() const
+        {
+            return m_pop_pos.load();
+        }
+
+    private:
+        /**
+         * @brief A queue slot.
+         */
+        struct slot
+        {
+            std::atomic<std::size_t> seq; ///< The push position the slot is ready for, plus one once pushed to.
+            string_t message;             ///< The message.
+        };
+
+        std::unique_ptr<slot[]> m_slots;                    ///< The slots.
+        std::size_t m_mask;                                 ///< The number of slots minus one.
+        alignas(64) std::atomic<std::size_t> m_push_pos{0}; ///< The position of the next push.
+        alignas(64) std::atomic<std::size_t> m_pop_pos{0};  ///< The position of the next pop.
+    };
+
+    /// @endcond
+
+    /**
+     * @brief Wrapper type for output streams writing messages from a background thread.
+     *
+     * A complete chain of \<\<s is formatted on the calling thread like buffered_postream does, with the same
+     * restrictions on the formatting settings of the stream, and pushed as one message onto a bounded lock-free
+     * queue. A dedicated thread pops the messages and writes each of them with a single `sputn` under the mutex
+     * of the stream, so messages stay atomic and ordered per producing thread, and producers never wait for
+     * the stream itself.
+     *
+     * What happens to a message when the queue is full is decided by the overflow_policy.
+     * The wrapper drains the queue before being destroyed.
+     *
+     * @tparam ostream_t The output stream type, derived from `std::basic_ostream`.
+     */
+    template<typename ostream_t>
+    class async_postream: pstream_base
+    {
+    private:
+        /// @cond SHOW_INTERNAL
+        template<typename, typename...>
+        friend class __postream_temp;
+
+        using formatter_t = __message_formatter<typename ostream_t::char_type, typename ostream_t::traits_type>;
+        using string_t    = std::basic_string<typename ostream_t::char_type, typename ostream_t::traits_type>;
+        using view_t      = std::basic_string_view<typename ostream_t::char_type, typename ostream_t::traits_type>;
+
+        /**
+         * @brief The largest number of messages the consumer writes per acquisition of the stream's mutex.
+         */
+        static constexpr std::size_t s_batch_size = 64;
+
+        /**
+         * @brief Format the operands of a complete chain and queue the message.
+         *
+         * @tparam Ts The written value types.
+         * @param vals The values to write.
+         */
+        template<typename... Ts>
+        void __write(Ts&... vals) const
+        {
+            __count_chain(*m_mtx, sizeof...(Ts));
+            formatter_t::with_message(
+                m_ostream, [this](const formatter_t&, view_t message) { __push(message); }, vals...
+            );
+        }
+
+        /**
+         * @brief Queue a formatted message according to the overflow policy.
+         *
+         * @param message The message.
+         */
+        void __push(view_t message) const
+        {
+            while (!m_ring.try_push(message))
+            {
+                switch (m_policy)
+                {
+                case overflow_policy::block:
+                    __wait_for_room();
+                    break;
+                case overflow_policy::drop_newest:
+                    m_dropped.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                case overflow_policy::drop_oldest:
+                {
+                    static thread_local string_t t_discarded;
+                    if (m_ring.try_pop(t_discarded))
+                    {
+                        m_dropped.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    break;
+                }
+                }
+            }
+
+            __wake();
+        }
+
+        /**
+         * @brief Wait until the consumer thread has popped messages from the full queue.
+         */
+        void __wait_for_room() const
+        {
+            __wake();
+            std::unique_lock<std::mutex> lk{m_wait_mtx};
+            // Pairs with the fence of the consumer, one of the two sees what the other has done
+            m_blocked.fetch_add(1);
+            m_room_cv.wait(lk, [this]() { return m_ring.push_pos() - m_ring.pop_pos() < m_ring.capacity(); });
+            m_blocked.fetch_sub(1);
+        }
+
+        /**
+         * @brief Wake the consumer thread if it's waiting for messages.
+         */
+        void __wake() const
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (m_sleeping.load(std::memory_order_relaxed))
+            {
+                std::lock_guard<std::mutex> lk{m_wait_mtx};
+                m_wait_cv.notify_one();
+            }
+        }
+
+        /**
+         * @brief Write the queued messages until the wrapper is destroyed and the queue is drained.
+         */
+        void __consume()
+        {
+            string_t message;
+            bool unflushed = false;
+            while (true)
+            {
+                m_busy.store(true);
+                const bool popped = m_ring.try_pop(message);
+                if (popped)
+                {
+                    std::lock_guard<__stream_lock> lk{*m_mtx};
+                    std::size_t count = 0;
+                    do
+                    {
+                        __write_message(message);
+                    } while (++count < s_batch_size && m_ring.try_pop(message));
+                    unflushed = true;
+                }
+                if (popped)
+                {
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    if (m_blocked.load(std::memory_order_relaxed) != 0)
+                    {
+                        std::lock_guard<std::mutex> lk{m_wait_mtx};
+                        m_room_cv.notify_all();
+                    }
+                }
+                else if (unflushed)
+                {
+                    // The queue is drained, let the stream catch up
+                    std::lock_guard<__stream_lock> lk{*m_mtx};
+                    m_ostream.flush();
+                    unflushed = false;
+                }
+                m_busy.store(false);
+                m_rounds.fetch_add(1);
+
+                if (m_flushers.load() != 0)
+                {
+                    std::lock_guard<std::mutex> lk{m_wait_mtx};
+                    m_flush_cv.notify_all();
+                }
+
+                if (popped)
+                {
+                    continue;
+                }
+                if (m_stop.load())
+                {
+                    if (m_ring.pop_pos() == m_ring.push_pos())
+                    {
+                        return;
+                    }
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lk{m_wait_mtx};
+                m_sleeping.store(true);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (m_ring.pop_pos() == m_ring.push_pos() && !m_stop.load() && m_flushers.load() == 0)
+                {
+                    // Every push, flush() and the destructor wake the consumer, it needs no timeout
+                    m_wait_cv.wait(lk);
+                }
+                m_sleeping.store(false);
+            }
+        }
+
+        /**
+         * @brief Write a message to the stream, the stream's mutex must be held.
+         *
+         * @param message The message.
+         */
+        void __write_message(const string_t& message)
+        {
+            typename ostream_t::sentry sentry{m_ostream};
+            if (!sentry)
+            {
+                return;
+            }
+
+            const std::streamsize size = static_cast<std::streamsize>(message.size());
+            if (m_ostream.rdbuf()->sputn(message.data(), size) != size)
+            {
+                m_ostream.setstate(std::ios_base::badbit);
+            }
+        }
+
+    protected:
+        /**
+         * @brief Reference to the original output stream.
+         */
+        ostream_t& m_ostream;
+        /**
+         * @brief The mutex guarding the original output stream.
+         */
+        std::shared_ptr<__stream_lock> m_mtx;
+        /**
+         * @brief What to do with a message when the queue is full.
+         */
+        overflow_policy m_policy;
+        /**
+         * @brief The queue of formatted messages.
+         */
+        mutable __message_ring<string_t> m_ring;
+        /**
+         * @brief The number of messages dropped because the queue was full.
+         */
+        mutable std::atomic<std::size_t> m_dropped{0};
+        /**
+         * @brief Whether the consumer thread is, or is about to be, waiting for messages.
+         */
+        mutable std::atomic<bool> m_sleeping{false};
+        /**
+         * @brief The number of producers waiting for room in the queue.
+         */
+        mutable std::atomic<std::size_t> m_blocked{0};
+        /**
+         * @brief Whether the consumer thread may be holding popped messages it hasn't written yet.
+         */
+        std::atomic<bool> m_busy{false};
+        /**
+         * @brief The number of rounds of popping and writing messages the consumer thread has completed.
+         */
+        std::atomic<std::size_t> m_rounds{0};
+        /**
+         * @brief Whether the wrapper is being destroyed.
+         */
+        std::atomic<bool> m_stop{false};
+        /**
+         * @brief The number of threads waiting in flush().
+         */
+        std::atomic<std::size_t> m_flushers{0};
+        /**
+         * @brief The mutex the consumer thread and flush() wait with.
+         */
+        mutable std::mutex m_wait_mtx;
+        /**
+         * @brief Notified when messages are queued.
+         */
+        mutable std::condition_variable m_wait_cv;
+        /**
+         * @brief Notified when the consumer thread has popped messages while producers wait for room.
+         */
+        mutable std::condition_variable m_room_cv;
+        /**
+         * @brief Notified when the consumer thread has written a batch of messages.
+         */
+        std::condition_variable m_flush_cv;
+        /**
+         * @brief The consumer thread.
+         */
+        std::thread m_consumer;
+        /// @endcond
+
+    public:
+        using char_type   = typename ostream_t::char_type;
+        using traits_type = typename ostream_t::traits_type;
+
+        /**
+         * @brief Construct a new async_postream object.
+         *
+         * @param ostream Reference to the original output stream.
+         * @param capacity The minimum number of messages the queue holds.
+         * @param policy What to do with a message when the queue is full.
+         */
+        explicit async_postream(
+            ostream_t& ostream, std::size_t capacity = 1024, overflow_policy policy = overflow_policy::block
+        ):
+            m_ostream{ostream}, m_mtx{__stream_mutex(ostream)}, m_policy{policy}, m_ring{capacity}
+        {
+            // The fill character is initialized on first access, get it done before it's read concurrently
+            m_ostream.fill();
+            m_consumer = std::thread{&async_postream::__consume, this};
+        }
+
+        async_postream(const async_postream&)            = delete;
+        async_postream& operator=(const async_postream&) = delete;
+
+        /**
+         * @brief Destroy the async_postream object after writing all the queued messages.
+         */
+        ~async_postream()
+        {
+            m_stop.store(true);
+            {
+                std::lock_guard<std::mutex> lk{m_wait_mtx};
+                m_wait_cv.notify_one();
+            }
+            m_consumer.join();
+        }
+
+        /**
+         * @brief Wait until every message queued before the call is written, then flush the stream.
+         */
+        void flush()
+        {
+            const std::size_t target = m_ring.push_pos();
+
+            m_flushers.fetch_add(1);
+            {
+                std::unique_lock<std::mutex> lk{m_wait_mtx};
+                m_wait_cv.notify_one();
+                while (m_ring.pop_pos() < target)
+                {
+                    m_flush_cv.wait_for(lk, std::chrono::milliseconds{1});
+                }
+                // The last messages may still be held by the consumer, wait for the round it popped them in
+                const std::size_t rounds = m_rounds.load();
+                while (m_busy.load() && m_rounds.load() == rounds)
+                {
+                    m_flush_cv.wait_for(lk, std::chrono::milliseconds{1});
+                }
+            }
+            m_flushers.fetch_sub(1);
+
+            std::lock_guard<__stream_lock> lk{*m_mtx};
+            m_ostream.flush();
+        }
+
+        /**
+         * @brief Get the number of messages dropped because the queue was full.
+         *
+         * @return std::size_t The number of dropped messages.
+         */
+        std::size_t dropped() const
+        {
+            return m_dropped.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Get the number of queued messages the consumer thread hasn't taken yet.
+         *
+         * @return std::size_t The number of queued messages.
+         */
+        std::size_t lag() const
+        {
+            const std::size_t pop_pos = m_ring.pop_pos();
+            return m_ring.push_pos() - pop_pos;
+        }
+
+        /**
+         * @brief Queue an already formatted message as a whole, so the wrapper can serve as a sink.
+         *
+         * @param data The characters of the message.
+         * @param size The number of characters.
+         */
+        void write_message(const char_type* data, std::size_t size) const
+        {
+            __push(view_t{data, size});
+        }
+
+        /**
+         * @brief Writes a value after the chain of \<\<s is completed.
+         *
+         * @tparam T The written value type.
+         * @param val The value to write.
+         * @return __postream_temp<async_postream, T> Temporary object to continue the chain of \<\<s.
+         */
+        template<typename T>
+        __postream_temp<async_postream, T> operator<<(T&& val)
+        {
+            return {*this, std::forward_as_tuple(std::forward<T>(val))};
+        }
+    };
+
+    /**
+     * @brief Message sink delivering every message to several output streams, each with a queue of its own.
+     *
+     * Meant to be used with sink_postream, so a chain is formatted once, then the message is pushed onto the
+     * queue of every destination, which is written by a background thread of its own like async_postream
+     * does. A slow destination only fills up its own queue: with the default overflow_policy::drop_newest the
+     * messages it can't take are dropped and counted, while the other destinations keep up.
+     *
+     * Destinations are added before the sink is written to, and each of them is drained when the sink is
+     * destroyed.
+     *
+     * @tparam char_t The character type.
+     * @tparam traits_t The character traits type.
+     */
+    template<typename char_t = char, typename traits_t = std::char_traits<char_t>>
+    class fanout_sink
+    {
+    public:
+        using char_type    = char_t;
+        using traits_type  = traits_t;
+        using ostream_type = std::basic_ostream<char_t, traits_t>;
+
+        /**
+         * @brief Add a destination.
+         *
+         * @param ostream Reference to the output stream of the destination.
+         * @param capacity The minimum number of messages the queue of the destination holds.
+         * @param policy What to do with a message when the queue of the destination is full.
+         * @return std::size_t The index of the destination.
+         */
+        std::size_t add(
+            ostream_type& ostream, std::size_t capacity = 1024, overflow_policy policy = overflow_policy::drop_newest
+        )
+        {
+            m_destinations.push_back(std::make_unique<async_postream<ostream_type>>(ostream, capacity, policy));
+            return m_destinations.size() - 1;
+        }
+
+        /**
+         * @brief Get the number of destinations.
+         *
+         * @return std::size_t The number of destinations.
+         */
+        std::size_t size() const
+        {
+            return m_destinations.size();
+        }
+
+        /**
+         * @brief Get the number of messages queued for a destination and not taken by its thread yet.
+         *
+         * @param i The index of the destination.
+         * @return std::size_t The number of queued messages.
          */
-        class __pistream_temp: pstream_base
+        std::size_t lag(std::size_t i) const
         {
-        public:
-            /**
-             * @brief Construct a new pistream temp object.
-             *
-             * @param istream Reference to the original input stream.
-             */
-            __pistream_temp(istream_t& istream): m_istream{istream}
-            {}
+            return m_destinations[i]->lag();
+        }
 
-            /**
-             * @brief Move constructor.
-             *
-             * @param other The other __pistream_temp object.
-             */
-            __pistream_temp(__pistream_temp&& other): m_istream{other.m_istream}, m_actions{std::move(other.m_actions)}
-            {
-                while (!other.m_actions.empty())
-                {
-                    other.m_actions.pop();
-                }
-            }
+        /**
+         * @brief Get the number of messages dropped for a destination because its queue was full.
+         *
+         * @param i The index of the destination.
+         * @return std::size_t The number of dropped messages.
+         */
+        std::size_t dropped(std::size_t i) const
+        {
+            return m_destinations[i]->dropped();
+        }
 
-            /**
-             * @brief Destroy the __pistream_temp object performing the accumulated I/O operations atomically.
-             */
-            ~__pistream_temp()
-            {
-                std::lock_guard<std::mutex> lk{g_mtx};
-                while (!m_actions.empty())
-                {
-                    m_actions.front()();
-                    m_actions.pop();
-                }
-            }
+        /**
+         * @brief Wait until every message queued before the call is written to a destination, then flush it.
+         *
+         * @param i The index of the destination.
+         */
+        void flush(std::size_t i)
+        {
+            m_destinations[i]->flush();
+        }
 
-            /**
-             * @brief Add a new I/O operation to the queue.
-             *
-             * @tparam T The read value type.
-             * @param val Stores the value read after performing the action.
-             * @return __pistream_temp Moved xvalue of self.
-             */
-            template<typename T>
-            __pistream_temp operator>>(T& val)
+        /**
+         * @brief Wait until every message queued before the call is written to every destination, then flush them.
+         */
+        void flush()
+        {
+            for (const std::unique_ptr<async_postream<ostream_type>>& destination : m_destinations)
             {
-                m_actions.emplace([&istream = this->m_istream, &val]() mutable { istream >> val; });
-
-                return std::move(*this);
+                destination->flush();
             }
+        }
 
-        private:
-            /**
-             * @brief Reference to the original input stream.
-             */
-            istream_t& m_istream;
-            /**
-             * @brief Queue of the I/O operations performed upon the object destruction.
-             */
-            std::queue<std::function<void()>> m_actions;
-        };
-
-    protected:
-        istream_t& m_istream;
-        /// @endcond
-
-    public:
         /**
-         * @brief Construct a new pistream object.
+         * @brief Queue a message for every destination.
          *
-         * @param istream Reference to the original input stream.
+         * @param data The characters of the message.
+         * @param size The number of characters.
          */
-        explicit pistream(istream_t& istream): m_istream{istream}
-        {}
+        void write_message(const char_type* data, std::size_t size) const
+        {
+            for (const std::unique_ptr<async_postream<ostream_type>>& destination : m_destinations)
+            {
+                destination->write_message(data, size);
+            }
+        }
 
+    private:
         /**
-         * @brief Reads a value after the chain of \>\>s is completed.
-         *
-         * @tparam T The read value type.
-         * @param val Reference to the value read.
-         * @return __pistream_temp Temporary object to continue the chain of \>\>s.
+         * @brief The destinations.
          */
-        template<typename T>
-        __pistream_temp operator>>(T& val)
-        {
-            return __pistream_temp{m_istream} >> val;
-        };
+        std::vector<std::unique_ptr<async_postream<ostream_type>>> m_destinations;
     };
 
     /**
-     * @brief Thread-safe wrapper type for output streams.
+     * @brief Wrapper type for output streams giving every writing thread a shard of its own.
      *
-     * @tparam ostream_t The output stream type.
+     * A complete chain of \<\<s is formatted on the calling thread like buffered_postream does, with the same
+     * restrictions on the formatting settings of the stream, and appended with a monotonic timestamp to the shard
+     * of the calling thread. Writing threads never share any data, the only lock a writer takes is the one of its
+     * own shard, which is otherwise only taken by the merger once per round.
+     *
+     * A background thread merges the shards every `interval`: it takes the current time as the cut, collects
+     * the shards, and writes the messages stamped before the cut ordered by their timestamps as one batch under
+     * the mutex of the stream. A message written after another one has completed, on any thread, is therefore
+     * written after it. Messages stay whole and are delayed by up to about one interval.
+     * The wrapper writes all the messages before being destroyed.
+     *
+     * @tparam ostream_t The output stream type, derived from `std::basic_ostream`.
      */
     template<typename ostream_t>
-    class postream: pstream_base
+    class sharded_postream: pstream_base
     {
     private:
         /// @cond SHOW_INTERNAL
+        template<typename, typename...>
+        friend class __postream_temp;
+
+        using formatter_t = __message_formatter<typename ostream_t::char_type, typename ostream_t::traits_type>;
+        using string_t    = std::basic_string<typename ostream_t::char_type, typename ostream_t::traits_type>;
+        using view_t      = std::basic_string_view<typename ostream_t::char_type, typename ostream_t::traits_type>;
+        using clock_type  = std::chrono::steady_clock;
+        using record_t    = std::pair<clock_type::time_point, std::size_t>;
+
         /**
-         * @brief Accumulates I/O operations to perform atomically.
+         * @brief Messages written by a single thread.
+         *
+         * The shard of an exited thread is freed by the merger once all its messages are written.
          */
-        class __postream_temp
+        struct shard: __thread_slot
         {
-        public:
-            /**
-             * @brief Construct a new __postream_temp object.
-             *
-             * @param ostream Reference to the original output stream.
-             */
-            __postream_temp(ostream_t& ostream): m_ostream{ostream}
-            {}
+            std::mutex mtx;                      ///< Guards the messages, taken by the owner thread and the merger.
+            string_t data;                       ///< The messages written since the last merge round.
+            std::vector<record_t> records;       ///< The timestamps and sizes of the messages.
+            string_t taken;                      ///< The messages taken by the merger, owned by the merger.
+            std::vector<record_t> taken_records; ///< The timestamps and sizes of the taken messages.
+            std::size_t next   = 0;              ///< The next taken message to write.
+            std::size_t offset = 0;              ///< The position of the next taken message to write.
+            bool retired       = false;          ///< Whether the thread had exited before the messages were taken.
+        };
 
-            /**
-             * @brief Move constructor.
-             *
-             * @param other The other __postream_temp object.
-             */
-            __postream_temp(__postream_temp&& other): m_ostream{other.m_ostream}, m_actions{std::move(other.m_actions)}
+        /**
+         * @brief Get the shard of the calling thread, creating it on first use.
+         *
+         * @return shard& The shard.
+         */
+        shard& __shard() const
+        {
+            return m_shards.__get();
+        }
+
+        /**
+         * @brief Format the operands of a complete chain and append the message to the shard of the thread.
+         *
+         * @tparam Ts The written value types.
+         * @param vals The values to write.
+         */
+        template<typename... Ts>
+        void __write(Ts&... vals) const
+        {
+            __count_chain(*m_mtx, sizeof...(Ts));
+            shard& s = __shard();
+            formatter_t::with_message(
+                m_ostream,
+                [&s](const formatter_t&, view_t message)
+                {
+                    std::lock_guard<std::mutex> lk{s.mtx};
+                    s.data.append(message);
+                    s.records.emplace_back(clock_type::now(), message.size());
+                },
+                vals...
+            );
+        }
+
+        /**
+         * @brief Write the messages stamped before the cut in the order of their timestamps.
+         *
+         * A message appended after the cut is taken has a later timestamp, as it's stamped under the lock of
+         * its shard the merger takes after the cut.
+         *
+         * @param cut The cut.
+         */
+        void __merge(clock_type::time_point cut)
+        {
+            m_merged.clear();
+            m_shards.__for_each([this](shard& s) { m_merged.push_back(&s); });
+
+            for (shard* s : m_merged)
             {
-                while (!other.m_actions.empty())
+                // Nothing is added to the shard of an exited thread after the messages taken below
+                s->retired = s->closed();
+
+                // Forget what was written, the rest was stamped after the previous cut
+                s->taken.erase(0, s->offset);
+                s->taken_records.erase(s->taken_records.begin(), s->taken_records.begin() + s->next);
+                s->next   = 0;
+                s->offset = 0;
+
+                std::lock_guard<std::mutex> lk{s->mtx};
+                if (s->taken_records.empty())
                 {
-                    other.m_actions.pop();
+                    s->taken.swap(s->data);
+                    s->taken_records.swap(s->records);
                 }
+                else
+                {
+                    s->taken.append(s->data);
+                    s->taken_records.insert(s->taken_records.end(), s->records.begin(), s->records.end());
+                }
+                s->data.clear();
+                s->records.clear();
             }
 
-            /**
-             * @brief Destroy the __postream_temp object performing the accumulated I/O operations atomically.
-             */
-            ~__postream_temp()
+            m_batch.clear();
+            while (true)
             {
-                std::lock_guard<std::mutex> lk{g_mtx};
-                while (!m_actions.empty())
+                // The shards are few, and every one of them is already ordered
+                shard* first = nullptr;
+                for (shard* s : m_merged)
                 {
-                    m_actions.front()();
-                    m_actions.pop();
+                    if (s->next < s->taken_records.size() && s->taken_records[s->next].first < cut &&
+                        (first == nullptr || s->taken_records[s->next].first < first->taken_records[first->next].first))
+                    {
+                        first = s;
+                    }
+                }
+                if (first == nullptr)
+                {
+                    break;
                 }
-            }
 
-            /**
-             * @brief Add a new I/O operation to the queue.
-             *
-             * @tparam T The written value type.
-             * @param val The value to write.
-             * @return __postream_temp Moved xvalue of self.
-             */
-            template<typename T>
-            __postream_temp operator<<(T& val)
+                const std::size_t size = first->taken_records[first->next++].second;
+                m_batch.append(first->taken, first->offset, size);
+                first->offset += size;
+            }
+            m_shards.__erase_closed_if([](const shard& s) { return s.retired && s.next == s.taken_records.size(); });
+            if (m_batch.empty())
             {
-                m_actions.emplace([&ostream = this->m_ostream, &val]() mutable { ostream << val; });
+                return;
+            }
 
-                return std::move(*this);
+            std::lock_guard<__stream_lock> lk{*m_mtx};
+            typename ostream_t::sentry sentry{m_ostream};
+            if (sentry)
+            {
+                const std::streamsize size = static_cast<std::streamsize>(m_batch.size());
+                if (m_ostream.rdbuf()->sputn(m_batch.data(), size) != size)
+                {
+                    m_ostream.setstate(std::ios_base::badbit);
+                }
+                m_ostream.flush();
             }
+        }
 
-        private:
-            /**
-             * @brief Reference to the original output stream.
-             */
-            ostream_t& m_ostream;
-            /**
-             * @brief Queue of the I/O operations performed upon the object destruction.
-             */
-            std::queue<std::function<void()>> m_actions;
-        };
+        /**
+         * @brief Merge the shards every interval or on request until the wrapper is destroyed.
+         */
+        void __merge_loop()
+        {
+            std::unique_lock<std::mutex> lk{m_wait_mtx};
+            while (true)
+            {
+                const bool stop               = m_stop;
+                const std::uint64_t requested = m_requested;
+                lk.unlock();
+                __merge(stop ? clock_type::time_point::max() : clock_type::now());
+                lk.lock();
+
+                m_completed = requested;
+                m_done_cv.notify_all();
+                if (stop)
+                {
+                    return;
+                }
+                m_wait_cv.wait_for(lk, m_interval, [this]() { return m_stop || m_requested != m_completed; });
+            }
+        }
 
     protected:
         /**
          * @brief Reference to the original output stream.
          */
         ostream_t& m_ostream;
+        /**
+         * @brief The mutex guarding the original output stream.
+         */
+        std::shared_ptr<__stream_lock> m_mtx;
+        /**
+         * @brief How often the shards are merged.
+         */
+        std::chrono::milliseconds m_interval;
+        /**
+         * @brief The shards of the writing threads.
+         */
+        mutable __thread_slots<shard> m_shards;
+        /**
+         * @brief The shards merged in the current round, owned by the merger.
+         */
+        std::vector<shard*> m_merged;
+        /**
+         * @brief The batch being written, owned by the merger.
+         */
+        string_t m_batch;
+        /**
+         * @brief Guards the merge requests.
+         */
+        std::mutex m_wait_mtx;
+        /**
+         * @brief Notified when a merge round is requested.
+         */
+        std::condition_variable m_wait_cv;
+        /**
+         * @brief Notified when a merge round is completed.
+         */
+        std::condition_variable m_done_cv;
+        /**
+         * @brief The number of requested merge rounds.
+         */
+        std::uint64_t m_requested = 0;
+        /**
+         * @brief The number of requested merge rounds that are completed.
+         */
+        std::uint64_t m_completed = 0;
+        /**
+         * @brief Whether the wrapper is being destroyed.
+         */
+        bool m_stop = false;
+        /**
+         * @brief The merger thread.
+         */
+        std::thread m_merger;
         /// @endcond
 
     public:
         /**
-         * @brief Construct a new postream object.
+         * @brief Construct a new sharded_postream object.
          *
          * @param ostream Reference to the original output stream.
+         * @param interval How often the shards are merged.
          */
-        explicit postream(ostream_t& ostream): m_ostream{ostream}
-        {}
+        explicit sharded_postream(
+            ostream_t& ostream, std::chrono::milliseconds interval = std::chrono::milliseconds{10}
+        ):
+            m_ostream{ostream}, m_mtx{__stream_mutex(ostream)}, m_interval{interval}
+        {
+            // The fill character is initialized on first access, get it done before it's read concurrently
+            m_ostream.fill();
+            m_merger = std::thread{&sharded_postream::__merge_loop, this};
+        }
+
+        sharded_postream(const sharded_postream&)            = delete;
+        sharded_postream& operator=(const sharded_postream&) = delete;
+
+        /**
+         * @brief Destroy the sharded_postream object after writing all the messages.
+         */
+        ~sharded_postream()
+        {
+            {
+                std::lock_guard<std::mutex> lk{m_wait_mtx};
+                m_stop = true;
+                m_wait_cv.notify_one();
+            }
+            m_merger.join();
+        }
+
+        /**
+         * @brief Wait until every message written before the call is written to the stream, then flush it.
+         */
+        void flush()
+        {
+            std::unique_lock<std::mutex> lk{m_wait_mtx};
+            const std::uint64_t target = ++m_requested;
+            m_wait_cv.notify_one();
+            m_done_cv.wait(lk, [this, target]() { return m_completed >= target; });
+        }
 
         /**
          * @brief Writes a value after the chain of \<\<s is completed.
          *
          * @tparam T The written value type.
          * @param val The value to write.
-         * @return __postream_temp Temporary object to continue the chain of \<\<s.
+         * @return __postream_temp<sharded_postream, T> Temporary object to continue the chain of \<\<s.
          */
         template<typename T>
-        __postream_temp operator<<(T& val)
+        __postream_temp<sharded_postream, T> operator<<(T&& val)
         {
-            return __postream_temp{m_ostream} << val;
+            return {*this, std::forward_as_tuple(std::forward<T>(val))};
         }
     };
 
@@ -243,25 +4118,65 @@ namespace eps
      *
      * @tparam istream_t Input stream interface type.
      * @tparam ostream_t Output stream interface type.
+     * @tparam lock_t The lock policy, e.g. std::mutex, ttas_lock, ticket_lock or mcs_lock.
      */
-    template<typename istream_t, typename ostream_t>
+    template<typename istream_t, typename ostream_t, typename lock_t = std::mutex>
     class pstream: private pstream_base
     {
     private:
         /// @cond SHOW_INTERNAL
+        using stream_lock_t = __basic_stream_lock<lock_t>; ///< The lock guarding the stream.
+
+        /**
+         * @brief A read operation of a __pstream_temp chain.
+         *
+         * @tparam T The read value type.
+         */
+        template<typename T>
+        struct __read
+        {
+            T&& val; ///< Reference to the value read.
+        };
+
+        /**
+         * @brief A write operation of a __pstream_temp chain.
+         *
+         * @tparam T The written value type.
+         */
+        template<typename T>
+        struct __write
+        {
+            T&& val; ///< Reference to the value written.
+        };
+
         /**
          * @brief Accumulates I/O operations to perform atomically.
+         *
+         * The operations of the chain are encoded in the type and keep their operands by reference,
+         * so building a chain never allocates. Operands must outlive the full-expression the chain is built in.
+         *
+         * @tparam Ops The operation types, __read<T> or __write<T>.
          */
-        class __pstream_temp: private pstream_base
+        template<typename... Ops>
+        class __pstream_temp
         {
+            template<typename...>
+            friend class __pstream_temp;
+
         public:
             /**
              * @brief Construct a new __pstream_temp object
              *
              * @param istream Reference to the original input stream.
              * @param ostream Reference to the original output stream.
+             * @param imtx The lock guarding the original input stream.
+             * @param omtx The lock guarding the original output stream.
+             * @param ops The operations to perform.
              */
-            __pstream_temp(istream_t& istream, ostream_t& ostream): m_istream{istream}, m_ostream{ostream}
+            __pstream_temp(
+                istream_t& istream, ostream_t& ostream, stream_lock_t& imtx, stream_lock_t& omtx, std::tuple<Ops...> ops
+            ):
+                m_istream{istream}, m_ostream{ostream}, m_imtx{imtx}, m_omtx{omtx}, m_ops{std::move(ops)}
             {}
 
             /**
@@ -270,58 +4185,107 @@ namespace eps
              * @param other The other __pstream_temp object.
              */
             __pstream_temp(__pstream_temp&& other):
-                m_istream{other.m_istream}, m_ostream{other.m_ostream}, m_actions{std::move(other.m_actions)}
-            {
-                while (!other.m_actions.empty())
-                {
-                    other.m_actions.pop();
-                }
-            }
+                m_istream{other.m_istream},
+                m_ostream{other.m_ostream},
+                m_imtx{other.m_imtx},
+                m_omtx{other.m_omtx},
+                m_ops{std::move(other.m_ops)},
+                m_active{std::exchange(other.m_active, false)}
+            {}
 
             /**
              * @brief Destroy the __pstream_temp object performing the accumulated I/O operations atomically.
              */
             ~__pstream_temp()
             {
-                std::lock_guard<std::mutex> lk{g_mtx};
-                while (!m_actions.empty())
+                if (!m_active)
+                {
+                    return;
+                }
+
+                auto run = [this]() { std::apply([this](auto&... ops) { (perform(ops), ...); }, m_ops); };
+
+                if (&m_imtx == &m_omtx)
+                {
+                    std::lock_guard<stream_lock_t> lk{m_imtx};
+                    run();
+                    __count_chain(m_imtx, sizeof...(Ops));
+                }
+                else
                 {
-                    m_actions.front()();
-                    m_actions.pop();
+                    // Locks both streams without risking a deadlock with a chain locking them in the other order
+                    std::scoped_lock lk{m_imtx, m_omtx};
+                    run();
+                    __count_chain(m_imtx, sizeof...(Ops));
+                    __count_chain(m_omtx, sizeof...(Ops));
                 }
             }
 
             /**
-             * @brief Add a new I/O operation to the queue.
+             * @brief Add a new I/O operation to the chain.
              *
              * @tparam T The read value type.
              * @param val Reference to the value read.
-             * @return __postream_temp Moved xvalue of self.
+             * @return __pstream_temp<Ops..., __read<T>> The chain extended with the new operation.
              */
             template<typename T>
-            __pstream_temp operator>>(T& val)
+            __pstream_temp<Ops..., __read<T>> operator>>(T&& val)
             {
-                m_actions.emplace([&istream = this->m_istream, &val]() mutable { istream >> val; });
-
-                return std::move(*this);
+                m_active = false;
+                return {
+                    m_istream,
+                    m_ostream,
+                    m_imtx,
+                    m_omtx,
+                    std::tuple_cat(std::move(m_ops), std::tuple<__read<T>>{__read<T>{std::forward<T>(val)}})
+                };
             }
 
             /**
-             * @brief Add a new I/O operation to the queue.
+             * @brief Add a new I/O operation to the chain.
              *
              * @tparam T The written value type.
              * @param val The value to write.
-             * @return __postream_temp Moved xvalue of self.
+             * @return __pstream_temp<Ops..., __write<T>> The chain extended with the new operation.
              */
             template<typename T>
-            __pstream_temp operator<<(T& val)
+            __pstream_temp<Ops..., __write<T>> operator<<(T&& val)
             {
-                m_actions.emplace([&ostream = this->m_ostream, &val]() mutable { ostream << val; });
-
-                return std::move(*this);
+                m_active = false;
+                return {
+                    m_istream,
+                    m_ostream,
+                    m_imtx,
+                    m_omtx,
+                    std::tuple_cat(std::move(m_ops), std::tuple<__write<T>>{__write<T>{std::forward<T>(val)}})
+                };
             }
 
         private:
+            /**
+             * @brief Perform a read operation.
+             *
+             * @tparam T The read value type.
+             * @param op The operation.
+             */
+            template<typename T>
+            void perform(__read<T>& op)
+            {
+                m_istream >> op.val;
+            }
+
+            /**
+             * @brief Perform a write operation.
+             *
+             * @tparam T The written value type.
+             * @param op The operation.
+             */
+            template<typename T>
+            void perform(__write<T>& op)
+            {
+                m_ostream << op.val;
+            }
+
             /**
              * @brief Reference to the original input stream.
              */
@@ -331,9 +4295,21 @@ namespace eps
              */
             ostream_t& m_ostream;
             /**
-             * @brief Queue of the I/O operations performed upon the object destruction.
+             * @brief The lock guarding the original input stream.
+             */
+            stream_lock_t& m_imtx;
+            /**
+             * @brief The lock guarding the original output stream.
              */
-            std::queue<std::function<void()>> m_actions;
+            stream_lock_t& m_omtx;
+            /**
+             * @brief The operations performed upon the object destruction.
+             */
+            std::tuple<Ops...> m_ops;
+            /**
+             * @brief Whether the chain ends with this object, i.e. it wasn't extended or moved from.
+             */
+            bool m_active = true;
         };
 
     protected:
@@ -345,6 +4321,14 @@ namespace eps
          * @brief Reference to the original output stream.
          */
         ostream_t& m_ostream;
+        /**
+         * @brief The lock guarding the original input stream.
+         */
+        std::shared_ptr<stream_lock_t> m_imtx;
+        /**
+         * @brief The lock guarding the original output stream.
+         */
+        std::shared_ptr<stream_lock_t> m_omtx;
         ///@endcond
 
     public:
@@ -354,27 +4338,31 @@ namespace eps
          * @param istream Reference to the original input stream.
          * @param ostream Reference to the original output stream.
          */
-        explicit pstream(istream_t& istream, ostream_t& ostream): m_istream{istream}, m_ostream{ostream}
+        explicit pstream(istream_t& istream, ostream_t& ostream):
+            m_istream{istream},
+            m_ostream{ostream},
+            m_imtx{__stream_mutex<lock_t>(istream)},
+            m_omtx{__stream_mutex<lock_t>(ostream)}
         {}
 
         /**
-         * @brief Cast to pistream<istream_t>.
+         * @brief Cast to pistream<istream_t, lock_t>.
          *
-         * @return pistream<istream_t>
+         * @return pistream<istream_t, lock_t>
          */
-        operator pistream<istream_t>()
+        operator pistream<istream_t, lock_t>()
         {
-            return pistream{m_istream};
+            return pistream<istream_t, lock_t>{m_istream};
         }
 
         /**
-         * @brief Cast to postream<ostream_t>.
+         * @brief Cast to postream<ostream_t, lock_t>.
          *
-         * @return postream<ostream_t>
+         * @return postream<ostream_t, lock_t>
          */
-        operator postream<ostream_t>()
+        operator postream<ostream_t, lock_t>()
         {
-            return postream{m_ostream};
+            return postream<ostream_t, lock_t>{m_ostream};
         }
 
         /**
@@ -382,12 +4370,12 @@ namespace eps
          *
          * @tparam T The read value type.
          * @param val Reference to the value read.
-         * @return __pistream_temp Temporary object to continue the chain of \<\<s and \>\>s.
+         * @return __pstream_temp<__read<T>> Temporary object to continue the chain of \<\<s and \>\>s.
          */
         template<typename T>
-        __pstream_temp operator>>(T& val)
+        __pstream_temp<__read<T>> operator>>(T&& val)
         {
-            return __pstream_temp{m_istream, m_ostream} >> val;
+            return {m_istream, m_ostream, *m_imtx, *m_omtx, std::tuple<__read<T>>{__read<T>{std::forward<T>(val)}}};
         }
 
         /**
@@ -395,12 +4383,12 @@ namespace eps
          *
          * @tparam T The written value type.
          * @param val The value to write.
-         * @return __pstream_temp Temporary object to continue the chain of \<\<s and \>\>s.
+         * @return __pstream_temp<__write<T>> Temporary object to continue the chain of \<\<s and \>\>s.
          */
         template<typename T>
-        __pstream_temp operator<<(T& val)
+        __pstream_temp<__write<T>> operator<<(T&& val)
         {
-            return __pstream_temp{m_istream, m_ostream} << val;
+            return {m_istream, m_ostream, *m_imtx, *m_omtx, std::tuple<__write<T>>{__write<T>{std::forward<T>(val)}}};
         }
     };
 
@@ -0,0 +1,538 @@
+/**
+ * @file pstream_coro20.hpp
+ * @author ElectronPie (tima001f@gmail.com)
+ * @brief Coroutine-awaitable forms of the thread-safe stream wrappers of pstream17.hpp.
+ *
+ * @copyright Copyright (c) 2025 ElectronPie
+ */
+
+#ifndef EPICS_PSTREAM_CORO20_HPP
+#define EPICS_PSTREAM_CORO20_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "pstream17.hpp"
+
+/**
+ * @brief Namespace for EPICS library.
+ */
+namespace eps
+{
+    /// @cond SHOW_INTERNAL
+    /**
+     * @brief I/O operations waiting to be performed by the blocking worker.
+     */
+    class __co_job
+    {
+        friend class __co_workers;
+
+    public:
+        /**
+         * @brief Perform the operations, blocking the worker as long as needed.
+         */
+        virtual void __run() = 0;
+
+    protected:
+        ~__co_job() = default;
+
+    private:
+        /**
+         * @brief The next job in the queue of its worker.
+         */
+        __co_job* m_next = nullptr;
+    };
+
+    /**
+     * @brief Threads performing the I/O operations of suspended coroutines, one per stream lock.
+     *
+     * The jobs of a stream are run in order by the worker of its lock, so a job blocking on its stream, e.g. a
+     * read waiting for input, only holds up the jobs of the same stream, which would wait for its lock anyway.
+     * A worker is started for the first job of its stream and exits once it has been idle for a while.
+     * The jobs are kept in intrusive queues, so submitting one never allocates while the worker is running.
+     */
+    class __co_workers
+    {
+    public:
+        /**
+         * @brief Get the workers.
+         *
+         * @return __co_workers& The workers.
+         */
+        static __co_workers& __instance()
+        {
+            static __co_workers s_workers;
+            return s_workers;
+        }
+
+        /**
+         * @brief Queue a job for the worker of a stream lock, starting the worker if needed.
+         *
+         * @param key The stream lock.
+         * @param job The job, must stay alive until it's run.
+         */
+        void __submit(const void* key, __co_job& job)
+        {
+            std::vector<std::thread> retired;
+            {
+                std::lock_guard<std::mutex> lk{m_mtx};
+                retired.swap(m_retired);
+
+                const auto [it, inserted] = m_workers.try_emplace(key);
+                worker& w                 = it->second;
+                job.m_next                = nullptr;
+                if (w.tail == nullptr)
+                {
+                    w.head = &job;
+                }
+                else
+                {
+                    w.tail->m_next = &job;
+                }
+                w.tail = &job;
+
+                if (inserted)
+                {
+                    w.thread = std::thread{&__co_workers::__loop, this, key, &w};
+                }
+                else
+                {
+                    w.cv.notify_one();
+                }
+            }
+            // The retired workers have left the loop already
+            for (std::thread& t : retired)
+            {
+                t.join();
+            }
+        }
+
+    private:
+        /**
+         * @brief The worker of a stream lock.
+         */
+        struct worker
+        {
+            std::condition_variable cv; ///< Notified when a job is queued or the workers are being destroyed.
+            __co_job* head = nullptr;   ///< The first queued job.
+            __co_job* tail = nullptr;   ///< The last queued job.
+            std::thread thread;         ///< The worker thread.
+        };
+
+        __co_workers() = default;
+
+        ~__co_workers()
+        {
+            std::unique_lock<std::mutex> lk{m_mtx};
+            m_stop = true;
+            for (auto& [key, w] : m_workers)
+            {
+                w.cv.notify_one();
+            }
+            m_retired_cv.wait(lk, [this]() { return m_workers.empty(); });
+            lk.unlock();
+
+            for (std::thread& t : m_retired)
+            {
+                t.join();
+            }
+        }
+
+        /**
+         * @brief Run the queued jobs of a stream lock until the worker has been idle for a while.
+         *
+         * @param key The stream lock.
+         * @param w The worker.
+         */
+        void __loop(const void* key, worker* w)
+        {
+            std::unique_lock<std::mutex> lk{m_mtx};
+            while (true)
+            {
+                w->cv.wait_for(
+                    lk, std::chrono::milliseconds{100}, [this, w]() { return m_stop || w->head != nullptr; }
+                );
+                if (w->head == nullptr)
+                {
+                    // Joined by the next submission or the destructor
+                    m_retired.push_back(std::move(w->thread));
+                    m_workers.erase(key);
+                    m_retired_cv.notify_all();
+                    return;
+                }
+
+                __co_job* job = std::exchange(w->head, w->head->m_next);
+                if (w->head == nullptr)
+                {
+                    w->tail = nullptr;
+                }
+                lk.unlock();
+                job->__run();
+                lk.lock();
+            }
+        }
+
+        std::mutex m_mtx;                                  ///< Guards the workers and their queues.
+        std::condition_variable m_retired_cv;              ///< Notified when a worker retires.
+        std::unordered_map<const void*, worker> m_workers; ///< The running workers keyed by their stream locks.
+        std::vector<std::thread> m_retired;                ///< The workers that have exited and aren't joined yet.
+        bool m_stop = false;                               ///< Whether the workers are being destroyed.
+    };
+
+    /**
+     * @brief Accumulates I/O operations to perform atomically once the chain is awaited.
+     *
+     * Awaiting the chain performs the operations right away if the stream's mutex is free and the wrapper
+     * allows it. Otherwise the coroutine is suspended, the operations are performed by the worker thread of
+     * the stream which may block, and the coroutine is resumed through the executor of the wrapper.
+     *
+     * @tparam wrapper_t The awaitable wrapper type.
+     * @tparam Ts The value types, forwarding-reference style (`T&` for lvalues, `T` for rvalues).
+     */
+    template<typename wrapper_t, typename... Ts>
+    class [[nodiscard]] __co_pstream_temp: private __co_job
+    {
+        template<typename, typename...>
+        friend class __co_pstream_temp;
+
+    public:
+        /**
+         * @brief Construct a new __co_pstream_temp object.
+         *
+         * @param wrapper Reference to the awaitable wrapper.
+         * @param vals References to the values.
+         */
+        __co_pstream_temp(wrapper_t& wrapper, std::tuple<Ts&&...> vals): m_wrapper{wrapper}, m_vals{std::move(vals)}
+        {}
+
+        /**
+         * @brief Add a new write operation to the chain.
+         *
+         * @tparam T The written value type.
+         * @param val The value to write.
+         * @return __co_pstream_temp<wrapper_t, Ts..., T> The chain extended with the new operation.
+         */
+        template<typename T>
+        __co_pstream_temp<wrapper_t, Ts..., T> operator<<(T&& val) &&
+            requires wrapper_t::__output
+        {
+            return {m_wrapper, std::tuple_cat(std::move(m_vals), std::forward_as_tuple(std::forward<T>(val)))};
+        }
+
+        /**
+         * @brief Add a new read operation to the chain.
+         *
+         * @tparam T The read value type.
+         * @param val Stores the value read.
+         * @return __co_pstream_temp<wrapper_t, Ts..., T> The chain extended with the new operation.
+         */
+        template<typename T>
+        __co_pstream_temp<wrapper_t, Ts..., T> operator>>(T&& val) &&
+            requires(!wrapper_t::__output)
+        {
+            return {m_wrapper, std::tuple_cat(std::move(m_vals), std::forward_as_tuple(std::forward<T>(val)))};
+        }
+
+        /**
+         * @brief Perform the operations right away if it's possible without blocking.
+         *
+         * @return bool Whether the operations are performed.
+         */
+        bool await_ready()
+        {
+            return m_wrapper.__try_perform(m_vals);
+        }
+
+        /**
+         * @brief Hand the operations over to the worker.
+         *
+         * @param handle The suspended coroutine.
+         */
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            m_handle = handle;
+            __co_workers::__instance().__submit(m_wrapper.m_mtx.get(), *this);
+        }
+
+        /**
+         * @brief Rethrow the exception thrown by the operations on the worker, if any.
+         */
+        void await_resume()
+        {
+            if (m_error)
+            {
+                std::rethrow_exception(m_error);
+            }
+        }
+
+    private:
+        void __run() override
+        {
+            try
+            {
+                m_wrapper.__perform(m_vals);
+            }
+            catch (...)
+            {
+                m_error = std::current_exception();
+            }
+            m_wrapper.m_executor.post(m_handle);
+        }
+
+        /**
+         * @brief Reference to the awaitable wrapper.
+         */
+        wrapper_t& m_wrapper;
+        /**
+         * @brief References to the values.
+         */
+        std::tuple<Ts&&...> m_vals;
+        /**
+         * @brief The suspended coroutine.
+         */
+        std::coroutine_handle<> m_handle;
+        /**
+         * @brief The exception thrown by the operations on the worker.
+         */
+        std::exception_ptr m_error;
+    };
+
+    /// @endcond
+
+    /**
+     * @brief Awaitable wrapper type for output streams.
+     *
+     * `co_await (eps::async(pcout, executor) << a << b);` writes the values atomically like postream does.
+     * If the stream is locked by another chain, the coroutine is suspended instead of its thread, the values
+     * are written by the worker thread of the stream, and the coroutine is resumed with `executor.post(handle)`.
+     * The chain must be parenthesized, as `co_await` binds tighter than \<\<.
+     *
+     * @tparam ostream_t The output stream type.
+     * @tparam executor_t The executor type, providing `post()` accepting a `std::coroutine_handle<>`.
+     */
+    template<typename ostream_t, typename executor_t>
+    class co_postream: postream<ostream_t>
+    {
+    private:
+        /// @cond SHOW_INTERNAL
+        template<typename, typename...>
+        friend class __co_pstream_temp;
+
+        /**
+         * @brief Whether the wrapper writes.
+         */
+        static constexpr bool __output = true;
+
+        /**
+         * @brief Write the values if the stream isn't locked.
+         *
+         * @tparam tuple_t The tuple type of references to the written values.
+         * @param vals The values to write.
+         * @return bool Whether the values are written.
+         */
+        template<typename tuple_t>
+        bool __try_perform(tuple_t& vals)
+        {
+            if (!this->m_mtx->try_lock())
+            {
+                return false;
+            }
+            std::lock_guard<__stream_lock> lk{*this->m_mtx, std::adopt_lock};
+            __write(vals);
+            return true;
+        }
+
+        /**
+         * @brief Write the values, waiting for the stream's mutex.
+         *
+         * @tparam tuple_t The tuple type of references to the written values.
+         * @param vals The values to write.
+         */
+        template<typename tuple_t>
+        void __perform(tuple_t& vals)
+        {
+            std::lock_guard<__stream_lock> lk{*this->m_mtx};
+            __write(vals);
+        }
+
+        /**
+         * @brief Write the values with the stream's mutex held.
+         *
+         * @tparam tuple_t The tuple type of references to the written values.
+         * @param vals The values to write.
+         */
+        template<typename tuple_t>
+        void __write(tuple_t& vals)
+        {
+            std::apply([this](auto&... vals) { ((this->m_ostream << vals), ...); }, vals);
+            __count_chain(*this->m_mtx, std::tuple_size_v<tuple_t>);
+        }
+
+    protected:
+        /**
+         * @brief The executor resuming the suspended coroutines.
+         */
+        executor_t& m_executor;
+        /// @endcond
+
+    public:
+        /**
+         * @brief Construct a new co_postream object.
+         *
+         * @param wrapper The wrapper around the original output stream.
+         * @param executor The executor resuming the suspended coroutines.
+         */
+        co_postream(const postream<ostream_t>& wrapper, executor_t& executor):
+            postream<ostream_t>{wrapper}, m_executor{executor}
+        {}
+
+        /**
+         * @brief Writes a value once the chain of \<\<s is awaited.
+         *
+         * @tparam T The written value type.
+         * @param val The value to write.
+         * @return __co_pstream_temp<co_postream, T> Awaitable object to continue the chain of \<\<s.
+         */
+        template<typename T>
+        __co_pstream_temp<co_postream, T> operator<<(T&& val)
+        {
+            return {*this, std::forward_as_tuple(std::forward<T>(val))};
+        }
+    };
+
+    /**
+     * @brief Awaitable wrapper type for input streams.
+     *
+     * `co_await (eps::async(pcin, executor) >> a >> b);` reads the values atomically like pistream does.
+     * As reading may block on the input itself, even past characters already buffered, the coroutine is always
+     * suspended, the values are read by the worker thread of the stream, and the coroutine is resumed with
+     * `executor.post(handle)`. A read waiting for input only holds up the chains of the same stream.
+     * The chain must be parenthesized, as `co_await` binds tighter than \>\>.
+     *
+     * @tparam istream_t The input stream type.
+     * @tparam executor_t The executor type, providing `post()` accepting a `std::coroutine_handle<>`.
+     */
+    template<typename istream_t, typename executor_t>
+    class co_pistream: pistream<istream_t>
+    {
+    private:
+        /// @cond SHOW_INTERNAL
+        template<typename, typename...>
+        friend class __co_pstream_temp;
+
+        /**
+         * @brief Whether the wrapper writes.
+         */
+        static constexpr bool __output = false;
+
+        /**
+         * @brief Leave the values to the worker of the stream, as a chain may read past the buffered characters
+         * and block on the input.
+         *
+         * @tparam tuple_t The tuple type of references to the read values.
+         * @return bool Whether the values are read, never.
+         */
+        template<typename tuple_t>
+        bool __try_perform(tuple_t&)
+        {
+            return false;
+        }
+
+        /**
+         * @brief Read the values, waiting for the stream's mutex.
+         *
+         * @tparam tuple_t The tuple type of references to the read values.
+         * @param vals Store the values read.
+         */
+        template<typename tuple_t>
+        void __perform(tuple_t& vals)
+        {
+            std::lock_guard<__stream_lock> lk{*this->m_mtx};
+            __read(vals);
+        }
+
+        /**
+         * @brief Read the values with the stream's mutex held.
+         *
+         * @tparam tuple_t The tuple type of references to the read values.
+         * @param vals Store the values read.
+         */
+        template<typename tuple_t>
+        void __read(tuple_t& vals)
+        {
+            std::apply([this](auto&... vals) { ((this->m_istream >> vals), ...); }, vals);
+            __count_chain(*this->m_mtx, std::tuple_size_v<tuple_t>);
+        }
+
+    protected:
+        /**
+         * @brief The executor resuming the suspended coroutines.
+         */
+        executor_t& m_executor;
+        /// @endcond
+
+    public:
+        /**
+         * @brief Construct a new co_pistream object.
+         *
+         * @param wrapper The wrapper around the original input stream.
+         * @param executor The executor resuming the suspended coroutines.
+         */
+        co_pistream(const pistream<istream_t>& wrapper, executor_t& executor):
+            pistream<istream_t>{wrapper}, m_executor{executor}
+        {}
+
+        /**
+         * @brief Reads a value once the chain of \>\>s is awaited.
+         *
+         * @tparam T The read value type.
+         * @param val Stores the value read.
+         * @return __co_pstream_temp<co_pistream, T> Awaitable object to continue the chain of \>\>s.
+         */
+        template<typename T>
+        __co_pstream_temp<co_pistream, T> operator>>(T&& val)
+        {
+            return {*this, std::forward_as_tuple(std::forward<T>(val))};
+        }
+    };
+
+    /**
+     * @brief Make an awaitable wrapper around the stream of an output stream wrapper.
+     *
+     * @tparam ostream_t The output stream type.
+     * @tparam executor_t The executor type, providing `post()` accepting a `std::coroutine_handle<>`.
+     * @param wrapper The wrapper around the original output stream.
+     * @param executor The executor resuming the suspended coroutines, must outlive the awaited chains.
+     * @return co_postream<ostream_t, executor_t> The awaitable wrapper.
+     */
+    template<typename ostream_t, typename executor_t>
+    co_postream<ostream_t, executor_t> async(const postream<ostream_t>& wrapper, executor_t& executor)
+    {
+        return {wrapper, executor};
+    }
+
+    /**
+     * @brief Make an awaitable wrapper around the stream of an input stream wrapper.
+     *
+     * @tparam istream_t The input stream type.
+     * @tparam executor_t The executor type, providing `post()` accepting a `std::coroutine_handle<>`.
+     * @param wrapper The wrapper around the original input stream.
+     * @param executor The executor resuming the suspended coroutines, must outlive the awaited chains.
+     * @return co_pistream<istream_t, executor_t> The awaitable wrapper.
+     */
+    template<typename istream_t, typename executor_t>
+    co_pistream<istream_t, executor_t> async(const pistream<istream_t>& wrapper, executor_t& executor)
+    {
+        return {wrapper, executor};
+    }
+} // namespace eps
+
+#endif // EPICS_PSTREAM_CORO20_HPP
@@ -0,0 +1,674 @@
+/**
+ * @file pstream_lz17.hpp
+ * @author ElectronPie (tima001f@gmail.com)
+ * @brief Streaming LZ compression stage for the thread-safe stream wrappers of pstream17.hpp.
+ *
+ * @copyright Copyright (c) 2025 ElectronPie
+ */
+
+#ifndef EPICS_PSTREAM_LZ17_HPP
+#define EPICS_PSTREAM_LZ17_HPP
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pstream17.hpp"
+
+/**
+ * @brief Namespace for EPICS library.
+ */
+namespace eps
+{
+    /// @cond SHOW_INTERNAL
+    /**
+     * @brief Magic string at the start of a compressed stream, 8 characters without the null terminator.
+     */
+    inline constexpr const char* __lz_magic = "EPSLZ01\n";
+    /**
+     * @brief The size of a block header: the raw size, the payload size and the checksum of the payload.
+     */
+    inline constexpr std::size_t __lz_header_size = 12;
+    /**
+     * @brief The largest block size, larger sizes in a block header are taken for a corrupted block.
+     */
+    inline constexpr std::size_t __lz_max_block = std::size_t{1} << 24;
+    /**
+     * @brief The shortest match, shorter repetitions are copied as literals.
+     */
+    inline constexpr std::size_t __lz_min_match = 4;
+    /**
+     * @brief The farthest a match may be from the position it's copied to, offsets take two bytes.
+     */
+    inline constexpr std::size_t __lz_max_offset = 65535;
+    /**
+     * @brief The number of bits of the match finder's hash.
+     */
+    inline constexpr unsigned int __lz_hash_bits = 12;
+
+    /**
+     * @brief Read a little-endian 32-bit value.
+     *
+     * @param p The bytes.
+     * @return std::uint32_t The value.
+     */
+    inline std::uint32_t __lz_load32(const char* p)
+    {
+        const auto* u = reinterpret_cast<const unsigned char*>(p);
+        return std::uint32_t{u[0]} | std::uint32_t{u[1]} << 8 | std::uint32_t{u[2]} << 16 | std::uint32_t{u[3]} << 24;
+    }
+
+    /**
+     * @brief Append a little-endian 32-bit value.
+     *
+     * @param out Where to append the value.
+     * @param val The value.
+     */
+    inline void __lz_store32(std::string& out, std::uint32_t val)
+    {
+        const char bytes[4] = {
+            static_cast<char>(val & 0xff), static_cast<char>(val >> 8 & 0xff), static_cast<char>(val >> 16 & 0xff),
+            static_cast<char>(val >> 24 & 0xff)
+        };
+        out.append(bytes, 4);
+    }
+
+    /**
+     * @brief Compute the FNV-1a checksum of a block payload.
+     *
+     * @param data The payload.
+     * @param size The size of the payload.
+     * @return std::uint32_t The checksum.
+     */
+    inline std::uint32_t __lz_checksum(const char* data, std::size_t size)
+    {
+        std::uint32_t hash = 2166136261u;
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            hash = (hash ^ static_cast<unsigned char>(data[i])) * 16777619u;
+        }
+        return hash;
+    }
+
+    /**
+     * @brief Append a length in the extension bytes following a token nibble of 15.
+     *
+     * @param out Where to append the length.
+     * @param len The length minus 15.
+     */
+    inline void __lz_put_length(std::string& out, std::size_t len)
+    {
+        for (; len >= 255; len -= 255)
+        {
+            out.push_back(static_cast<char>(255));
+        }
+        out.push_back(static_cast<char>(len));
+    }
+
+    /**
+     * @brief Append a sequence: literals, then a match unless it's the last sequence of the block.
+     *
+     * A sequence starts with a token holding the number of literals in its high nibble and the match length
+     * minus 4 in its low nibble, a nibble of 15 being continued with extension bytes. The literals follow,
+     * then the match offset in two little-endian bytes and the extension of the match length.
+     *
+     * @param out Where to append the sequence.
+     * @param literals The literals.
+     * @param literals_size The number of literals.
+     * @param offset The distance of the match, or zero for the last sequence.
+     * @param match_size The length of the match.
+     */
+    inline void __lz_put_sequence(
+        std::string& out, const char* literals, std::size_t literals_size, std::size_t offset, std::size_t match_size
+    )
+    {
+        const std::size_t match_code    = offset == 0 ? 0 : match_size - __lz_min_match;
+        const std::size_t literals_code = std::min<std::size_t>(literals_size, 15);
+        out.push_back(static_cast<char>(literals_code << 4 | std::min<std::size_t>(match_code, 15)));
+        if (literals_size >= 15)
+        {
+            __lz_put_length(out, literals_size - 15);
+        }
+        out.append(literals, literals_size);
+        if (offset == 0)
+        {
+            return;
+        }
+
+        out.push_back(static_cast<char>(offset & 0xff));
+        out.push_back(static_cast<char>(offset >> 8));
+        if (match_code >= 15)
+        {
+            __lz_put_length(out, match_code - 15);
+        }
+    }
+
+    /**
+     * @brief Compress a block with a greedy LZ77 match finder.
+     *
+     * Blocks are compressed independently, so every complete block of a stream can be decompressed by itself.
+     *
+     * @param data The block.
+     * @param size The size of the block.
+     * @param out Receives the compressed block.
+     */
+    inline void __lz_compress(const char* data, std::size_t size, std::string& out)
+    {
+        // Positions plus one, zero marks an empty entry
+        std::array<std::uint32_t, std::size_t{1} << __lz_hash_bits> table{};
+
+        out.clear();
+        std::size_t anchor = 0;
+        std::size_t pos    = 0;
+        while (pos + __lz_min_match <= size)
+        {
+            std::uint32_t word;
+            std::memcpy(&word, data + pos, sizeof(word));
+            const std::uint32_t hash      = (word * 2654435761u) >> (32 - __lz_hash_bits);
+            const std::size_t candidate   = table[hash];
+            table[hash]                   = static_cast<std::uint32_t>(pos + 1);
+            const std::size_t match_start = candidate - 1;
+            if (candidate == 0 || pos - match_start > __lz_max_offset ||
+                std::memcmp(data + match_start, data + pos, __lz_min_match) != 0)
+            {
+                // Incompressible data is skipped over faster the longer it goes on
+                pos += 1 + ((pos - anchor) >> 6);
+                continue;
+            }
+
+            std::size_t match_size = __lz_min_match;
+            while (pos + match_size < size && data[match_start + match_size] == data[pos + match_size])
+            {
+                ++match_size;
+            }
+            __lz_put_sequence(out, data + anchor, pos - anchor, pos - match_start, match_size);
+            pos += match_size;
+            anchor = pos;
+        }
+        __lz_put_sequence(out, data + anchor, size - anchor, 0, 0);
+    }
+
+    /**
+     * @brief Read a length continued in extension bytes.
+     *
+     * @param pos The position of the extension bytes, advanced past them.
+     * @param end The end of the compressed block.
+     * @param len The length read so far, increased by the extension.
+     * @return bool Whether the extension was complete.
+     */
+    inline bool __lz_get_length(const char*& pos, const char* end, std::size_t& len)
+    {
+        while (pos != end)
+        {
+            const unsigned char byte = static_cast<unsigned char>(*pos++);
+            len += byte;
+            if (byte != 255)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Decompress a block.
+     *
+     * @param data The compressed block.
+     * @param size The size of the compressed block.
+     * @param out Receives the block, must be sized to the raw size of the block.
+     * @return bool Whether the block was well-formed and decompressed to exactly the raw size.
+     */
+    inline bool __lz_decompress(const char* data, std::size_t size, std::string& out)
+    {
+        const char* pos = data;
+        const char* end = data + size;
+        std::size_t len = 0;
+        while (pos != end)
+        {
+            const unsigned int token  = static_cast<unsigned char>(*pos++);
+            std::size_t literals_size = token >> 4;
+            if (literals_size == 15 && !__lz_get_length(pos, end, literals_size))
+            {
+                return false;
+            }
+            if (static_cast<std::size_t>(end - pos) < literals_size || out.size() - len < literals_size)
+            {
+                return false;
+            }
+            std::memcpy(out.data() + len, pos, literals_size);
+            pos += literals_size;
+            len += literals_size;
+            if (pos == end)
+            {
+                break;
+            }
+
+            if (end - pos < 2)
+            {
+                return false;
+            }
+            const std::size_t offset =
+                static_cast<unsigned char>(pos[0]) | static_cast<std::size_t>(static_cast<unsigned char>(pos[1])) << 8;
+            pos += 2;
+            std::size_t match_size = token & 0xf;
+            if (match_size == 15 && !__lz_get_length(pos, end, match_size))
+            {
+                return false;
+            }
+            match_size += __lz_min_match;
+            if (offset == 0 || offset > len || out.size() - len < match_size)
+            {
+                return false;
+            }
+            // Byte by byte, as a match may overlap the characters it produces
+            for (std::size_t i = 0; i < match_size; ++i, ++len)
+            {
+                out[len] = out[len - offset];
+            }
+        }
+        return len == out.size();
+    }
+
+    /// @endcond
+
+    /**
+     * @brief Stream buffer compressing the written characters in blocks on a background thread.
+     *
+     * The characters are collected into blocks of a fixed size. A full block is handed to a dedicated thread,
+     * which compresses it with a self-contained LZ codec and writes it to the underlying stream, so writing
+     * threads only copy characters. Blocks are compressed independently and written whole, each with a header
+     * holding its sizes and a checksum, so a stream cut short, e.g. by a crash in the middle of a block, keeps
+     * every complete block before the cut readable by lz_istreambuf.
+     *
+     * At most `max_pending` blocks wait for the background thread, a writer filling another one waits for it.
+     * Syncing the buffer, e.g. flushing a stream using it, writes the partial block and waits until every
+     * block has been written, then flushes the underlying stream. The buffer syncs before being destroyed.
+     *
+     * The stream buffer isn't thread-safe by itself, it's meant to be written through the wrappers of
+     * pstream17.hpp, and the underlying stream is used by the background thread only:
+     * @code
+     * std::ofstream file{"trace.lz", std::ios_base::binary};
+     * eps::lz_ostream lz{file};
+     * eps::postream trace{lz};
+     * trace << "answer: " << 42 << '\n';
+     * @endcode
+     */
+    class lz_ostreambuf: public std::streambuf
+    {
+    public:
+        /**
+         * @brief Construct a new lz_ostreambuf object.
+         *
+         * @param sink Reference to the underlying stream, opened in binary mode.
+         * @param block_size The number of characters compressed as a block.
+         * @param max_pending The largest number of full blocks waiting for the background thread.
+         */
+        explicit lz_ostreambuf(std::ostream& sink, std::size_t block_size = 65536, std::size_t max_pending = 4):
+            m_sink{sink},
+            m_block_size{std::clamp<std::size_t>(block_size, 256, __lz_max_block)},
+            m_max_pending{std::max<std::size_t>(max_pending, 1)}
+        {
+            m_block.resize(m_block_size);
+            setp(m_block.data(), m_block.data() + m_block_size);
+            m_sink.write(__lz_magic, 8);
+            m_worker = std::thread{&lz_ostreambuf::__compress, this};
+        }
+
+        lz_ostreambuf(const lz_ostreambuf&)            = delete;
+        lz_ostreambuf& operator=(const lz_ostreambuf&) = delete;
+
+        /**
+         * @brief Destroy the lz_ostreambuf object after writing every block.
+         */
+        ~lz_ostreambuf() override
+        {
+            sync();
+            {
+                std::lock_guard<std::mutex> lk{m_mtx};
+                m_stop = true;
+            }
+            m_cv.notify_all();
+            m_worker.join();
+        }
+
+        /**
+         * @brief Get the number of characters written to the buffer.
+         *
+         * @return std::uint64_t The number of raw characters.
+         */
+        std::uint64_t raw_size() const
+        {
+            std::lock_guard<std::mutex> lk{m_mtx};
+            return m_raw_size + static_cast<std::uint64_t>(pptr() - pbase());
+        }
+
+        /**
+         * @brief Get the number of bytes written to the underlying stream, headers included.
+         *
+         * @return std::uint64_t The number of compressed bytes.
+         */
+        std::uint64_t compressed_size() const
+        {
+            std::lock_guard<std::mutex> lk{m_mtx};
+            return m_compressed_size;
+        }
+
+    protected:
+        int_type overflow(int_type ch) override
+        {
+            if (traits_type::eq_int_type(ch, traits_type::eof()))
+            {
+                return traits_type::not_eof(ch);
+            }
+            if (!__submit())
+            {
+                return traits_type::eof();
+            }
+
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+            return ch;
+        }
+
+        std::streamsize xsputn(const char* s, std::streamsize n) override
+        {
+            std::streamsize written = 0;
+            while (written < n)
+            {
+                if (pptr() == epptr() && !__submit())
+                {
+                    break;
+                }
+                const std::streamsize room = std::min<std::streamsize>(epptr() - pptr(), n - written);
+                traits_type::copy(pptr(), s + written, static_cast<std::size_t>(room));
+                pbump(static_cast<int>(room));
+                written += room;
+            }
+            return written;
+        }
+
+        int sync() override
+        {
+            if (!__submit())
+            {
+                return -1;
+            }
+
+            std::unique_lock<std::mutex> lk{m_mtx};
+            m_cv.wait(lk, [this]() { return m_written == m_submitted; });
+            if (!m_sink.flush())
+            {
+                m_failed = true;
+            }
+            return m_failed ? -1 : 0;
+        }
+
+    private:
+        /**
+         * @brief Hand the current block to the background thread and start a new one.
+         *
+         * @return bool Whether the underlying stream is still good.
+         */
+        bool __submit()
+        {
+            const std::size_t size = static_cast<std::size_t>(pptr() - pbase());
+            std::unique_lock<std::mutex> lk{m_mtx};
+            if (size == 0 || m_failed)
+            {
+                return !m_failed;
+            }
+
+            m_cv.wait(lk, [this]() { return m_queue.size() < m_max_pending; });
+            m_block.resize(size);
+            m_queue.push_back(std::move(m_block));
+            ++m_submitted;
+            m_raw_size += size;
+            if (m_free.empty())
+            {
+                m_block = std::string{};
+            }
+            else
+            {
+                m_block = std::move(m_free.back());
+                m_free.pop_back();
+            }
+            lk.unlock();
+            m_cv.notify_all();
+
+            m_block.resize(m_block_size);
+            setp(m_block.data(), m_block.data() + m_block_size);
+            return true;
+        }
+
+        /**
+         * @brief Compress and write the submitted blocks until the buffer is destroyed.
+         */
+        void __compress()
+        {
+            std::string block;
+            std::string payload;
+            std::string frame;
+            std::unique_lock<std::mutex> lk{m_mtx};
+            while (true)
+            {
+                m_cv.wait(lk, [this]() { return m_stop || !m_queue.empty(); });
+                if (m_queue.empty())
+                {
+                    return;
+                }
+                block = std::move(m_queue.front());
+                m_queue.pop_front();
+                lk.unlock();
+
+                __lz_compress(block.data(), block.size(), payload);
+                // A payload as large as the block means the block is stored as it is
+                const std::string& stored = payload.size() < block.size() ? payload : block;
+                frame.clear();
+                __lz_store32(frame, static_cast<std::uint32_t>(block.size()));
+                __lz_store32(frame, static_cast<std::uint32_t>(stored.size()));
+                __lz_store32(frame, __lz_checksum(stored.data(), stored.size()));
+                frame.append(stored);
+                const bool good = !m_sink.write(frame.data(), static_cast<std::streamsize>(frame.size())).fail();
+
+                lk.lock();
+                m_failed = m_failed || !good;
+                m_compressed_size += frame.size();
+                ++m_written;
+                m_free.push_back(std::move(block));
+                m_cv.notify_all();
+            }
+        }
+
+        std::ostream& m_sink;                    ///< The underlying stream.
+        std::size_t m_block_size;                ///< The number of characters compressed as a block.
+        std::size_t m_max_pending;               ///< The largest number of blocks waiting for the background thread.
+        std::string m_block;                     ///< The block being filled.
+        mutable std::mutex m_mtx;                ///< Guards the members below.
+        std::condition_variable m_cv;            ///< Notified when blocks are submitted or written.
+        std::deque<std::string> m_queue;         ///< The blocks waiting for the background thread.
+        std::vector<std::string> m_free;         ///< Written blocks kept for reuse.
+        std::size_t m_submitted         = 0;     ///< The number of submitted blocks.
+        std::size_t m_written           = 0;     ///< The number of written blocks.
+        std::uint64_t m_raw_size        = 0;     ///< The number of characters in the submitted blocks.
+        std::uint64_t m_compressed_size = 0;     ///< The number of bytes written to the underlying stream.
+        bool m_failed                   = false; ///< Whether writing to the underlying stream has failed.
+        bool m_stop                     = false; ///< Whether the buffer is being destroyed.
+        std::thread m_worker;                    ///< The background thread.
+    };
+
+    /**
+     * @brief Output stream compressing the written characters with an lz_ostreambuf.
+     */
+    class lz_ostream: public std::ostream
+    {
+    public:
+        /**
+         * @brief Construct a new lz_ostream object.
+         *
+         * @param sink Reference to the underlying stream, opened in binary mode.
+         * @param block_size The number of characters compressed as a block.
+         * @param max_pending The largest number of full blocks waiting for the background thread.
+         */
+        explicit lz_ostream(std::ostream& sink, std::size_t block_size = 65536, std::size_t max_pending = 4):
+            std::ostream{nullptr}, m_buf{sink, block_size, max_pending}
+        {
+            rdbuf(&m_buf);
+        }
+
+        /**
+         * @brief Get the stream buffer.
+         *
+         * @return lz_ostreambuf& The stream buffer.
+         */
+        lz_ostreambuf& buffer()
+        {
+            return m_buf;
+        }
+
+    private:
+        lz_ostreambuf m_buf; ///< The stream buffer.
+    };
+
+    /**
+     * @brief Stream buffer decompressing a stream written by lz_ostreambuf.
+     *
+     * Blocks are read and decompressed one at a time as the characters are consumed. The end of the
+     * stream is reached at the end of the underlying stream, or at the first block cut short or damaged,
+     * as left by a writer that crashed in the middle of it.
+     *
+     * @code
+     * std::ifstream file{"trace.lz", std::ios_base::binary};
+     * eps::lz_istream lz{file};
+     * eps::pistream trace{lz};
+     * @endcode
+     */
+    class lz_istreambuf: public std::streambuf
+    {
+    public:
+        /**
+         * @brief Construct a new lz_istreambuf object.
+         *
+         * @param source Reference to the underlying stream, opened in binary mode.
+         */
+        explicit lz_istreambuf(std::istream& source): m_source{source}
+        {}
+
+        lz_istreambuf(const lz_istreambuf&)            = delete;
+        lz_istreambuf& operator=(const lz_istreambuf&) = delete;
+
+    protected:
+        /**
+         * @throws std::runtime_error If the underlying stream isn't a compressed stream, which sets the badbit
+         * of the stream reading from the buffer.
+         */
+        int_type underflow() override
+        {
+            if (gptr() == egptr() && !__next_block())
+            {
+                return traits_type::eof();
+            }
+            return traits_type::to_int_type(*gptr());
+        }
+
+    private:
+        /**
+         * @brief Read and decompress the next block.
+         *
+         * @return bool Whether a non-empty block was read.
+         */
+        bool __next_block()
+        {
+            if (!m_started)
+            {
+                m_started = true;
+                char magic[8];
+                if (!m_source.read(magic, 8) || std::memcmp(magic, __lz_magic, 8) != 0)
+                {
+                    m_done = true;
+                    throw std::runtime_error{"Not a compressed stream"};
+                }
+            }
+
+            while (!m_done)
+            {
+                char header[__lz_header_size];
+                if (!m_source.read(header, __lz_header_size))
+                {
+                    break;
+                }
+                const std::size_t raw_size     = __lz_load32(header);
+                const std::size_t payload_size = __lz_load32(header + 4);
+                if (raw_size > __lz_max_block || payload_size > raw_size)
+                {
+                    break;
+                }
+                m_payload.resize(payload_size);
+                if (!m_source.read(m_payload.data(), static_cast<std::streamsize>(payload_size)) ||
+                    __lz_checksum(m_payload.data(), payload_size) != __lz_load32(header + 8))
+                {
+                    break;
+                }
+
+                if (payload_size == raw_size)
+                {
+                    m_block.swap(m_payload);
+                }
+                else
+                {
+                    m_block.resize(raw_size);
+                    if (!__lz_decompress(m_payload.data(), payload_size, m_block))
+                    {
+                        break;
+                    }
+                }
+                if (!m_block.empty())
+                {
+                    setg(m_block.data(), m_block.data(), m_block.data() + m_block.size());
+                    return true;
+                }
+            }
+            m_done = true;
+            return false;
+        }
+
+        std::istream& m_source; ///< The underlying stream.
+        std::string m_payload;  ///< The payload of the last block read.
+        std::string m_block;    ///< The decompressed block being read.
+        bool m_started = false; ///< Whether the magic string has been read.
+        bool m_done    = false; ///< Whether the end of the compressed stream has been reached.
+    };
+
+    /**
+     * @brief Input stream decompressing a stream written by lz_ostream with an lz_istreambuf.
+     */
+    class lz_istream: public std::istream
+    {
+    public:
+        /**
+         * @brief Construct a new lz_istream object.
+         *
+         * @param source Reference to the underlying stream, opened in binary mode.
+         */
+        explicit lz_istream(std::istream& source): std::istream{nullptr}, m_buf{source}
+        {
+            rdbuf(&m_buf);
+        }
+
+    private:
+        lz_istreambuf m_buf; ///< The stream buffer.
+    };
+} // namespace eps
+
+#endif // EPICS_PSTREAM_LZ17_HPP
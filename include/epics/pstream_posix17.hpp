@@ -0,0 +1,1584 @@
+/**
+ * @file pstream_posix17.hpp
+ * @author ElectronPie (tima001f@gmail.com)
+ * @brief POSIX sinks and sources for the thread-safe stream wrappers of pstream17.hpp.
+ *
+ * @copyright Copyright (c) 2025 ElectronPie
+ */
+
+#ifndef EPICS_PSTREAM_POSIX17_HPP
+#define EPICS_PSTREAM_POSIX17_HPP
+
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include "pstream17.hpp"
+
+/**
+ * @brief Namespace for EPICS library.
+ */
+namespace eps
+{
+    /// @cond SHOW_INTERNAL
+    /**
+     * @brief Write characters to a file descriptor, retrying on interruptions and partial writes.
+     *
+     * @param fd The file descriptor.
+     * @param s The characters.
+     * @param n The number of characters.
+     * @return bool Whether all the characters have been written.
+     */
+    inline bool __write_all(int fd, const char* s, std::size_t n)
+    {
+        while (n != 0)
+        {
+            const ssize_t written = ::write(fd, s, n);
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return false;
+            }
+            s += written;
+            n -= static_cast<std::size_t>(written);
+        }
+        return true;
+    }
+    /// @endcond
+
+    /**
+     * @brief How an fd_sink decides when to write its buffer out.
+     */
+    enum class fd_buffering
+    {
+        full, ///< Write the buffer out when it's full.
+        line  ///< Write the buffer out when it's full or a newline has been put into it.
+    };
+
+    /**
+     * @brief Output sink writing straight to a POSIX file descriptor.
+     *
+     * The sink keeps a buffer of its own and formats arithmetic values with `std::to_chars`, producing the
+     * same text as a default-formatted `std::ostream` would. Characters and strings are copied as they are.
+     * Only values of other types are formatted by a `std::ostream` writing into the sink's buffer.
+     * Manipulators are applied to that stream, and while its formatting differs from the defaults
+     * (e.g. after `std::hex` or `std::setprecision`) all the values are formatted by it.
+     *
+     * The sink is not thread-safe by itself, it's meant to be wrapped into a postream:
+     * @code
+     * eps::fd_sink sink{STDOUT_FILENO};
+     * eps::postream pout{sink};
+     * pout << "answer: " << 42 << '\n';
+     * @endcode
+     */
+    class fd_sink
+    {
+    public:
+        using char_type   = char;                   ///< The character type.
+        using traits_type = std::char_traits<char>; ///< The character traits type.
+
+        /**
+         * @brief Construct a new fd_sink object.
+         *
+         * The sink doesn't take ownership of the file descriptor.
+         * The sink is line buffered if the descriptor refers to a terminal and fully buffered otherwise.
+         *
+         * @param fd The file descriptor to write to.
+         * @param capacity The size of the buffer.
+         */
+        explicit fd_sink(int fd, std::size_t capacity = 8192):
+            fd_sink{fd, capacity, ::isatty(fd) ? fd_buffering::line : fd_buffering::full}
+        {}
+
+        /**
+         * @brief Construct a new fd_sink object.
+         *
+         * The sink doesn't take ownership of the file descriptor.
+         *
+         * @param fd The file descriptor to write to.
+         * @param capacity The size of the buffer.
+         * @param buffering When to write the buffer out.
+         */
+        fd_sink(int fd, std::size_t capacity, fd_buffering buffering):
+            m_fd{fd},
+            m_buffering{buffering},
+            m_capacity{capacity < 64 ? 64 : capacity},
+            m_buffer{std::make_unique<char[]>(m_capacity)},
+            m_fallback_buf{*this},
+            m_fallback{&m_fallback_buf}
+        {}
+
+        fd_sink(const fd_sink&)            = delete;
+        fd_sink& operator=(const fd_sink&) = delete;
+
+        /**
+         * @brief Destroy the fd_sink object writing out the buffer.
+         */
+        ~fd_sink()
+        {
+            flush();
+        }
+
+        /**
+         * @brief Write the buffer out to the file descriptor.
+         *
+         * @return fd_sink& Reference to self.
+         */
+        fd_sink& flush()
+        {
+            write_fd(m_buffer.get(), m_size);
+            m_size = 0;
+            return *this;
+        }
+
+        /**
+         * @brief Get the file descriptor the sink writes to.
+         *
+         * @return int The file descriptor.
+         */
+        int fd() const
+        {
+            return m_fd;
+        }
+
+        /**
+         * @brief Check whether all the writes to the file descriptor have succeeded so far.
+         *
+         * @return bool If no write has failed.
+         */
+        bool good() const
+        {
+            return !m_failed;
+        }
+
+        /**
+         * @brief Put characters into the sink.
+         *
+         * @param s The characters.
+         * @param n The number of characters.
+         * @return fd_sink& Reference to self.
+         */
+        fd_sink& write(const char* s, std::size_t n)
+        {
+            if (n > m_capacity - m_size)
+            {
+                flush();
+                if (n >= m_capacity)
+                {
+                    write_fd(s, n);
+                    return *this;
+                }
+            }
+
+            std::memcpy(m_buffer.get() + m_size, s, n);
+            m_size += n;
+            if (m_buffering == fd_buffering::line && std::memchr(s, '\n', n) != nullptr)
+            {
+                flush();
+            }
+            return *this;
+        }
+
+        /**
+         * @brief Put a string into the sink.
+         *
+         * @param s The string.
+         * @return fd_sink& Reference to self.
+         */
+        fd_sink& operator<<(std::string_view s)
+        {
+            if (m_fallback.width() != 0)
+            {
+                m_fallback << s;
+                return *this;
+            }
+            return write(s.data(), s.size());
+        }
+
+        /**
+         * @brief Put a string into the sink.
+         *
+         * @param s The string.
+         * @return fd_sink& Reference to self.
+         */
+        fd_sink& operator<<(const std::string& s)
+        {
+            return *this << std::string_view{s};
+        }
+
+        /**
+         * @brief Put a null-terminated string into the sink.
+         *
+         * @param s The string.
+         * @return fd_sink& Reference to self.
+         */
+        fd_sink& operator<<(const char* s)
+        {
+            return *this << std::string_view{s};
+        }
+
+        /**
+         * @brief Put a character into the sink.
+         *
+         * @param c The character.
+         * @return fd_sink& Reference to self.
+         */
+        fd_sink& operator<<(char c)
+        {
+            if (m_fallback.width() != 0)
+            {
+                m_fallback << c;
+                return *this;
+            }
+            return write(&c, 1);
+        }
+
+        /**
+         * @brief Put a character into the sink.
+         *
+         * @param c The character.
+         * @return fd_sink& Reference to self.
+         */
+        fd_sink& operator<<(signed char c)
+        {
+            return *this << static_cast<char>(c);
+        }
+
+        /**
+         * @brief Put a character into the sink.
+         *
+         * @param c The character.
+         * @return fd_sink& Reference to self.
+         */
+        fd_sink& operator<<(unsigned char c)
+        {
+            return *this << static_cast<char>(c);
+        }
+
+        /**
+         * @brief Apply a manipulator, e.g. `std::hex`, to the formatting of the sink.
+         *
+         * @param manip The manipulator.
+         * @return fd_sink& Reference to self.
+         */
+        fd_sink& operator<<(std::ios_base& (*manip)(std::ios_base&))
+        {
+            m_fallback << manip;
+            return *this;
+        }
+
+        /**
+         * @brief Apply a stream manipulator, e.g. `std::endl`, to the sink.
+         *
+         * Flushing manipulators write the buffer out to the file descriptor.
+         *
+         * @param manip The manipulator.
+         * @return fd_sink& Reference to self.
+         */
+        fd_sink& operator<<(std::ostream& (*manip)(std::ostream&))
+        {
+            m_fallback << manip;
+            return *this;
+        }
+
+        /**
+         * @brief Put the text representation of a value into the sink.
+         *
+         * Arithmetic values are formatted with `std::to_chars` unless manipulators have changed the formatting,
+         * values of other types by a `std::ostream`.
+         *
+         * @tparam T The value type.
+         * @param val The value.
+         * @return fd_sink& Reference to self.
+         */
+        template<typename T>
+        fd_sink& operator<<(const T& val)
+        {
+            if (!default_formatting())
+            {
+                m_fallback << val;
+                return *this;
+            }
+
+            if constexpr (std::is_same_v<T, bool>)
+            {
+                return *this << (val ? '1' : '0');
+            }
+            else if constexpr (std::is_integral_v<T>)
+            {
+                char buf[24];
+                return write(buf, static_cast<std::size_t>(std::to_chars(buf, buf + sizeof(buf), val).ptr - buf));
+            }
+            else if constexpr (std::is_floating_point_v<T>)
+            {
+                // Same as the default formatting of streams, i.e. %g with a precision of 6
+                char buf[32];
+                const std::to_chars_result res =
+                    std::to_chars(buf, buf + sizeof(buf), val, std::chars_format::general, 6);
+                return write(buf, static_cast<std::size_t>(res.ptr - buf));
+            }
+            else
+            {
+                m_fallback << val;
+                return *this;
+            }
+        }
+
+    private:
+        /**
+         * @brief Stream buffer putting the characters formatted by the fallback stream into the sink.
+         */
+        class fallback_streambuf: public std::streambuf
+        {
+        public:
+            /**
+             * @brief Construct a new fallback_streambuf object.
+             *
+             * @param sink The sink to put the characters into.
+             */
+            explicit fallback_streambuf(fd_sink& sink): m_sink{sink}
+            {}
+
+        protected:
+            int_type overflow(int_type ch) override
+            {
+                if (!traits_type::eq_int_type(ch, traits_type::eof()))
+                {
+                    const char c = traits_type::to_char_type(ch);
+                    m_sink.write(&c, 1);
+                }
+                return traits_type::not_eof(ch);
+            }
+
+            std::streamsize xsputn(const char* s, std::streamsize n) override
+            {
+                m_sink.write(s, static_cast<std::size_t>(n));
+                return n;
+            }
+
+            int sync() override
+            {
+                m_sink.flush();
+                return 0;
+            }
+
+        private:
+            fd_sink& m_sink; ///< The sink to put the characters into.
+        };
+
+        /**
+         * @brief Check whether the fallback stream still formats values like a default-constructed stream.
+         *
+         * @return bool If the values can be formatted with `std::to_chars`.
+         */
+        bool default_formatting() const
+        {
+            return m_fallback.flags() == (std::ios_base::skipws | std::ios_base::dec) &&
+                   m_fallback.precision() == 6 && m_fallback.width() == 0;
+        }
+
+        /**
+         * @brief Write characters to the file descriptor, retrying on interruptions and partial writes.
+         *
+         * @param s The characters.
+         * @param n The number of characters.
+         */
+        void write_fd(const char* s, std::size_t n)
+        {
+            if (!__write_all(m_fd, s, n))
+            {
+                m_failed = true;
+            }
+        }
+
+        int m_fd;                          ///< The file descriptor to write to.
+        fd_buffering m_buffering;          ///< When to write the buffer out.
+        bool m_failed = false;             ///< Whether a write has failed.
+        std::size_t m_capacity;            ///< The size of the buffer.
+        std::size_t m_size = 0;            ///< The number of buffered characters.
+        std::unique_ptr<char[]> m_buffer;  ///< The buffer.
+        fallback_streambuf m_fallback_buf; ///< The stream buffer of the fallback stream.
+        std::ostream m_fallback;           ///< Formats values of the types the sink doesn't know.
+    };
+
+    /// @cond SHOW_INTERNAL
+    /**
+     * @brief Header at the start of a ring file.
+     *
+     * The data area following the header holds records of a commit word, a length word and the message, padded
+     * to 8 bytes. A writer claims the room of a record by advancing `head`, stores the length, copies the message
+     * in and commits the record by storing the complement of the record's position as its commit word. A record
+     * whose writer has crashed or has been lapped has no matching commit word and is skipped by the reader.
+     */
+    struct alignas(64) __mmap_ring_header
+    {
+        static_assert(
+            std::atomic<std::uint64_t>::is_always_lock_free, "The head of a ring file must be shared between processes"
+        );
+
+        char magic[8];                   ///< Identifies the file format, always "EPSRING2".
+        std::uint64_t capacity;          ///< The size of the data area following the header, a multiple of 8.
+        std::atomic<std::uint64_t> head; ///< The bytes ever claimed by the writers, the data area wraps around.
+
+        /**
+         * @brief The magic string of ring files.
+         *
+         * @return const char* 8 characters without the null terminator.
+         */
+        static const char* __magic()
+        {
+            return "EPSRING2";
+        }
+
+        /**
+         * @brief Get a word of the data area.
+         *
+         * @param data The data area.
+         * @param pos The position of the word, a multiple of 8.
+         * @return std::atomic<std::uint64_t>& The word.
+         */
+        static std::atomic<std::uint64_t>& __word(char* data, std::size_t pos)
+        {
+            return *reinterpret_cast<std::atomic<std::uint64_t>*>(data + pos);
+        }
+
+        /**
+         * @brief Get a word of the data area.
+         *
+         * @param data The data area.
+         * @param pos The position of the word, a multiple of 8.
+         * @return const std::atomic<std::uint64_t>& The word.
+         */
+        static const std::atomic<std::uint64_t>& __word(const char* data, std::size_t pos)
+        {
+            return *reinterpret_cast<const std::atomic<std::uint64_t>*>(data + pos);
+        }
+
+        /**
+         * @brief Get the size of the record of a message.
+         *
+         * @param n The size of the message.
+         * @return std::uint64_t The size of the record, the two words and the message padded to 8 bytes.
+         */
+        static std::uint64_t __record_size(std::uint64_t n)
+        {
+            return 16 + ((n + 7) & ~std::uint64_t{7});
+        }
+
+        /**
+         * @brief Get the commit word of a record.
+         *
+         * The high bytes of the complement are 0xff, which don't occur in text, so the characters of a message
+         * are hardly ever taken for a commit word.
+         *
+         * @param pos The position of the record, counting from the start of the ring.
+         * @return std::uint64_t The commit word.
+         */
+        static std::uint64_t __commit_word(std::uint64_t pos)
+        {
+            return ~pos;
+        }
+    };
+
+    /**
+     * @brief Throw the system error stored in errno.
+     *
+     * @param what What has failed.
+     */
+    [[noreturn]] inline void __throw_errno(const char* what)
+    {
+        throw std::system_error{errno, std::generic_category(), what};
+    }
+    /// @endcond
+
+    /**
+     * @brief Message sink writing into a memory-mapped file used as a ring buffer.
+     *
+     * Writers reserve room for a message with a single atomic increment of the head stored in the file,
+     * copy the message into the mapping and commit it, so the sink is thread-safe without any lock and the
+     * writes don't make any system calls. When the file is full, the oldest messages get overwritten.
+     * The contents survive a crash of the writing process and can be read with read_mmap_ring(), which skips
+     * the messages that haven't been committed.
+     *
+     * The sink is meant to be wrapped into a sink_postream:
+     * @code
+     * eps::mmap_ring_sink sink{"app.ring", 1 << 20};
+     * eps::sink_postream pout{sink};
+     * pout << "answer: " << 42 << '\n';
+     * @endcode
+     */
+    class mmap_ring_sink
+    {
+    public:
+        using char_type   = char;                   ///< The character type.
+        using traits_type = std::char_traits<char>; ///< The character traits type.
+
+        /**
+         * @brief Construct a new mmap_ring_sink object.
+         *
+         * An existing ring file of the same capacity is appended to, any other file is recreated.
+         *
+         * @param path The path of the ring file.
+         * @param capacity The size of the data area of the file, rounded up to a multiple of 8 and at least 64.
+         * @throws std::system_error If the file couldn't be created or mapped.
+         */
+        mmap_ring_sink(const std::string& path, std::size_t capacity):
+            m_capacity{capacity < 64 ? 64 : (capacity + 7) & ~std::size_t{7}}
+        {
+            m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+            if (m_fd < 0)
+            {
+                __throw_errno("open");
+            }
+
+            const std::size_t size = sizeof(__mmap_ring_header) + m_capacity;
+            struct stat st;
+            if (::fstat(m_fd, &st) != 0)
+            {
+                __close_and_throw("fstat");
+            }
+            const bool reuse = static_cast<std::size_t>(st.st_size) == size;
+            if (!reuse && (::ftruncate(m_fd, 0) != 0 || ::ftruncate(m_fd, static_cast<off_t>(size)) != 0))
+            {
+                __close_and_throw("ftruncate");
+            }
+
+            void* map = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+            if (map == MAP_FAILED)
+            {
+                __close_and_throw("mmap");
+            }
+            m_header = static_cast<__mmap_ring_header*>(map);
+            m_data   = static_cast<char*>(map) + sizeof(__mmap_ring_header);
+
+            if (!reuse || std::memcmp(m_header->magic, __mmap_ring_header::__magic(), 8) != 0 ||
+                m_header->capacity != m_capacity)
+            {
+                // The file has just been zeroed or isn't a ring of this capacity, start it over
+                m_header = new (map) __mmap_ring_header{};
+                std::memcpy(m_header->magic, __mmap_ring_header::__magic(), 8);
+                m_header->capacity = m_capacity;
+            }
+        }
+
+        mmap_ring_sink(const mmap_ring_sink&)            = delete;
+        mmap_ring_sink& operator=(const mmap_ring_sink&) = delete;
+
+        /**
+         * @brief Destroy the mmap_ring_sink object unmapping the file.
+         *
+         * The contents reach the file eventually even without sync().
+         */
+        ~mmap_ring_sink()
+        {
+            ::munmap(m_header, sizeof(__mmap_ring_header) + m_capacity);
+            ::close(m_fd);
+        }
+
+        /**
+         * @brief Write a message into the ring.
+         *
+         * A message longer than the capacity less the 16 bytes of the record words is cut to its last characters.
+         *
+         * @param s The characters of the message.
+         * @param n The number of characters.
+         */
+        void write_message(const char* s, std::size_t n)
+        {
+            if (n > m_capacity - 16)
+            {
+                s += n - (m_capacity - 16);
+                n = m_capacity - 16;
+            }
+
+            const std::uint64_t pos = m_header->head.fetch_add(__mmap_ring_header::__record_size(n));
+            const std::size_t at    = static_cast<std::size_t>(pos % m_capacity);
+            const std::size_t start = (at + 16) % m_capacity;
+            const std::size_t first = n < m_capacity - start ? n : m_capacity - start;
+            __mmap_ring_header::__word(m_data, (at + 8) % m_capacity).store(n, std::memory_order_relaxed);
+            std::memcpy(m_data + start, s, first);
+            std::memcpy(m_data, s + first, n - first);
+            __mmap_ring_header::__word(m_data, at).store(
+                __mmap_ring_header::__commit_word(pos), std::memory_order_release
+            );
+        }
+
+        /**
+         * @brief Wait until the contents of the ring are written to the file.
+         *
+         * @throws std::system_error If the contents couldn't be written.
+         */
+        void sync()
+        {
+            if (::msync(m_header, sizeof(__mmap_ring_header) + m_capacity, MS_SYNC) != 0)
+            {
+                __throw_errno("msync");
+            }
+        }
+
+        /**
+         * @brief Get the size of the data area of the ring.
+         *
+         * @return std::size_t The capacity.
+         */
+        std::size_t capacity() const
+        {
+            return m_capacity;
+        }
+
+        /**
+         * @brief Get the number of bytes ever claimed in the ring file, including by other sinks.
+         *
+         * Every message takes 16 bytes more than its characters, padded to 8 bytes.
+         *
+         * @return std::uint64_t The number of bytes.
+         */
+        std::uint64_t written() const
+        {
+            return m_header->head.load();
+        }
+
+    private:
+        /**
+         * @brief Close the file and throw the system error stored in errno.
+         *
+         * @param what What has failed.
+         */
+        [[noreturn]] void __close_and_throw(const char* what)
+        {
+            const int error = errno;
+            ::close(m_fd);
+            errno = error;
+            __throw_errno(what);
+        }
+
+        std::size_t m_capacity;                 ///< The size of the data area.
+        int m_fd                     = -1;      ///< The descriptor of the ring file.
+        __mmap_ring_header* m_header = nullptr; ///< The header of the mapping.
+        char* m_data                 = nullptr; ///< The data area of the mapping.
+    };
+
+    /**
+     * @brief Read the contents of a ring file written by mmap_ring_sink.
+     *
+     * The messages are returned oldest first. Messages that haven't been committed, because they are still being
+     * written or their writer has crashed, and messages overwritten while being read are skipped.
+     *
+     * @param path The path of the ring file.
+     * @return std::string The contents of the ring.
+     * @throws std::system_error If the file couldn't be opened or mapped.
+     * @throws std::runtime_error If the file isn't a ring file.
+     */
+    inline std::string read_mmap_ring(const std::string& path)
+    {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            __throw_errno("open");
+        }
+        struct stat st;
+        const int stat_res = ::fstat(fd, &st);
+        const int error    = errno;
+        if (stat_res != 0 || static_cast<std::size_t>(st.st_size) < sizeof(__mmap_ring_header))
+        {
+            ::close(fd);
+            if (stat_res != 0)
+            {
+                errno = error;
+                __throw_errno("fstat");
+            }
+            throw std::runtime_error{"Not a ring file: " + path};
+        }
+
+        const std::size_t size = static_cast<std::size_t>(st.st_size);
+        void* map              = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED)
+        {
+            const int map_error = errno;
+            ::close(fd);
+            errno = map_error;
+            __throw_errno("mmap");
+        }
+        ::close(fd);
+
+        const auto* header = static_cast<const __mmap_ring_header*>(map);
+        const char* data   = static_cast<const char*>(map) + sizeof(__mmap_ring_header);
+        if (std::memcmp(header->magic, __mmap_ring_header::__magic(), 8) != 0 ||
+            header->capacity != size - sizeof(__mmap_ring_header))
+        {
+            ::munmap(map, size);
+            throw std::runtime_error{"Not a ring file: " + path};
+        }
+
+        const std::uint64_t head = header->head.load(std::memory_order_acquire);
+        const std::size_t cap    = static_cast<std::size_t>(header->capacity);
+        std::string res;
+        if (cap < 64 || cap % 8 != 0)
+        {
+            ::munmap(map, size);
+            return res;
+        }
+
+        // The oldest record that may still be whole starts at most one capacity behind the head
+        std::uint64_t pos = head > cap ? head - cap : 0;
+        while (pos + 16 <= head)
+        {
+            const std::size_t at = static_cast<std::size_t>(pos % cap);
+            if (__mmap_ring_header::__word(data, at).load(std::memory_order_acquire) !=
+                __mmap_ring_header::__commit_word(pos))
+            {
+                // Not a committed record, look for the next one word by word
+                pos += 8;
+                continue;
+            }
+            const std::uint64_t n =
+                __mmap_ring_header::__word(data, (at + 8) % cap).load(std::memory_order_relaxed);
+            const std::uint64_t record = __mmap_ring_header::__record_size(n);
+            if (n > cap - 16 || pos + record > head)
+            {
+                pos += 8;
+                continue;
+            }
+
+            const std::size_t old   = res.size();
+            const std::size_t start = (at + 16) % cap;
+            const std::size_t first = n < cap - start ? static_cast<std::size_t>(n) : cap - start;
+            res.append(data + start, first);
+            res.append(data, static_cast<std::size_t>(n) - first);
+            // Writers claim their room before writing into it, so a record lapped while it was copied shows in the head
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (header->head.load(std::memory_order_relaxed) > pos + cap)
+            {
+                res.resize(old);
+                pos += 8;
+                continue;
+            }
+            pos += record;
+        }
+        ::munmap(map, size);
+        return res;
+    }
+
+    /**
+     * @brief Message sink writing into a series of files, moving on to the next file once the current one has
+     * grown too large or too old.
+     *
+     * The files are named `<path>.<n>`, numbered on from the first number that isn't taken. A background thread
+     * opens the next file in advance, and fsyncs and closes the files rotated out, so writers never wait for the
+     * file system metadata operations. The files are switched between messages and every message is written
+     * with a single `write()`, so no message is split across two files. If the next file isn't open yet by the
+     * time the current one is due, the messages keep going to the current one until it is.
+     *
+     * The sink is thread-safe and meant to be wrapped into a sink_postream:
+     * @code
+     * eps::rotating_file_sink sink{"app.log", 64 << 20, std::chrono::hours{24}};
+     * eps::sink_postream pout{sink};
+     * pout << "answer: " << 42 << '\n';
+     * @endcode
+     */
+    class rotating_file_sink
+    {
+    public:
+        using char_type   = char;                      ///< The character type.
+        using traits_type = std::char_traits<char>;    ///< The character traits type.
+        using clock_type  = std::chrono::steady_clock; ///< The clock measuring the age of the files.
+
+        /**
+         * @brief Construct a new rotating_file_sink object opening the first file.
+         *
+         * @param path The path of the files without the number.
+         * @param max_bytes The size a file is rotated out at, 0 for no limit. A single message longer than
+         * that still goes into a file of its own.
+         * @param max_age The age a file is rotated out at if anything has been written into it, 0 for no limit.
+         * @throws std::system_error If the first file couldn't be created.
+         */
+        rotating_file_sink(
+            std::string path, std::uint64_t max_bytes, clock_type::duration max_age = clock_type::duration::zero()
+        ):
+            m_path{std::move(path)}, m_max_bytes{max_bytes}, m_max_age{max_age}
+        {
+            m_fd = __open_next(m_current_path);
+            if (m_fd < 0)
+            {
+                __throw_errno("open");
+            }
+            m_opened = clock_type::now();
+            m_thread = std::thread{[this]() { __run(); }};
+        }
+
+        rotating_file_sink(const rotating_file_sink&)            = delete;
+        rotating_file_sink& operator=(const rotating_file_sink&) = delete;
+
+        /**
+         * @brief Destroy the rotating_file_sink object fsyncing and closing the files.
+         *
+         * The next file opened in advance is removed, as nothing has been written into it.
+         */
+        ~rotating_file_sink()
+        {
+            {
+                std::lock_guard<std::mutex> lk{m_mtx};
+                m_stop = true;
+            }
+            m_cv.notify_one();
+            m_thread.join();
+            ::fsync(m_fd);
+            ::close(m_fd);
+        }
+
+        /**
+         * @brief Write a message into the current file, rotating it first if the message doesn't fit.
+         *
+         * @param s The characters of the message.
+         * @param n The number of characters.
+         */
+        void write_message(const char* s, std::size_t n)
+        {
+            std::lock_guard<std::mutex> lk{m_mtx};
+            if (m_max_bytes != 0 && m_size != 0 && m_size + n > m_max_bytes)
+            {
+                __rotate_locked();
+            }
+            if (!__write_all(m_fd, s, n))
+            {
+                m_failed = true;
+            }
+            m_size += n;
+        }
+
+        /**
+         * @brief Move on to the next file if anything has been written into the current one.
+         *
+         * @return bool Whether the file has been switched, false if the next file isn't open yet.
+         */
+        bool rotate()
+        {
+            std::lock_guard<std::mutex> lk{m_mtx};
+            return m_size != 0 && __rotate_locked();
+        }
+
+        /**
+         * @brief Wait until the contents of the current file are written to the disk.
+         *
+         * @throws std::system_error If the contents couldn't be written.
+         */
+        void sync()
+        {
+            std::lock_guard<std::mutex> lk{m_mtx};
+            if (::fsync(m_fd) != 0)
+            {
+                __throw_errno("fsync");
+            }
+        }
+
+        /**
+         * @brief Get the path of the file currently written into.
+         *
+         * @return std::string The path.
+         */
+        std::string current_path() const
+        {
+            std::lock_guard<std::mutex> lk{m_mtx};
+            return m_current_path;
+        }
+
+        /**
+         * @brief Get the number of times the file has been switched.
+         *
+         * @return std::uint64_t The number of rotations.
+         */
+        std::uint64_t rotations() const
+        {
+            std::lock_guard<std::mutex> lk{m_mtx};
+            return m_rotations;
+        }
+
+        /**
+         * @brief Check whether all the writes and the opening of the next files have succeeded so far.
+         *
+         * @return bool If nothing has failed.
+         */
+        bool good() const
+        {
+            std::lock_guard<std::mutex> lk{m_mtx};
+            return !m_failed;
+        }
+
+    private:
+        /**
+         * @brief Create the file with the first free number, going on from the number of the last one.
+         *
+         * @param path Set to the path of the file.
+         * @return int The descriptor of the file, -1 with errno set if it couldn't be created.
+         */
+        int __open_next(std::string& path)
+        {
+            for (;; ++m_next_number)
+            {
+                path = m_path + '.' + std::to_string(m_next_number);
+                // O_EXCL claims the number, existing files are never reused
+                const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_APPEND | O_CLOEXEC, 0644);
+                if (fd >= 0)
+                {
+                    ++m_next_number;
+                    return fd;
+                }
+                if (errno != EEXIST)
+                {
+                    return -1;
+                }
+            }
+        }
+
+        /**
+         * @brief Switch to the file opened in advance, leaving the current one to the background thread.
+         *
+         * The caller must hold the lock.
+         *
+         * @return bool Whether the file has been switched, false if the next file isn't open yet.
+         */
+        bool __rotate_locked()
+        {
+            if (m_next_fd < 0)
+            {
+                return false;
+            }
+            m_retired.push_back(m_fd);
+            m_fd           = std::exchange(m_next_fd, -1);
+            m_current_path = std::move(m_next_path);
+            m_size         = 0;
+            m_opened       = clock_type::now();
+            ++m_rotations;
+            m_cv.notify_one();
+            return true;
+        }
+
+        /**
+         * @brief Body of the background thread, opening the next files, rotating the files that are too old
+         * and closing the files rotated out.
+         */
+        void __run()
+        {
+            constexpr clock_type::duration retry_period = std::chrono::seconds{1};
+
+            clock_type::time_point retry_at{};
+            std::unique_lock<std::mutex> lk{m_mtx};
+            while (true)
+            {
+                while (!m_retired.empty())
+                {
+                    std::vector<int> retired = std::move(m_retired);
+                    m_retired.clear();
+                    lk.unlock();
+                    for (int fd : retired)
+                    {
+                        ::fsync(fd);
+                        ::close(fd);
+                    }
+                    lk.lock();
+                }
+                if (m_stop)
+                {
+                    break;
+                }
+
+                const clock_type::time_point now = clock_type::now();
+                if (m_next_fd < 0 && now >= retry_at)
+                {
+                    lk.unlock();
+                    std::string path;
+                    const int fd = __open_next(path);
+                    lk.lock();
+                    if (fd < 0)
+                    {
+                        m_failed = true;
+                        retry_at = now + retry_period;
+                    }
+                    else
+                    {
+                        m_next_fd   = fd;
+                        m_next_path = std::move(path);
+                    }
+                    continue;
+                }
+                if (m_max_age != clock_type::duration::zero() && m_next_fd >= 0 && now - m_opened >= m_max_age)
+                {
+                    if (m_size == 0)
+                    {
+                        // Nothing to rotate out, the file starts aging with its first message
+                        m_opened = now;
+                    }
+                    else
+                    {
+                        __rotate_locked();
+                    }
+                    continue;
+                }
+
+                if (m_next_fd < 0)
+                {
+                    m_cv.wait_until(lk, retry_at);
+                }
+                else if (m_max_age != clock_type::duration::zero())
+                {
+                    m_cv.wait_until(lk, m_opened + m_max_age);
+                }
+                else
+                {
+                    m_cv.wait(lk);
+                }
+            }
+
+            if (m_next_fd >= 0)
+            {
+                ::close(m_next_fd);
+                ::unlink(m_next_path.c_str());
+                m_next_fd = -1;
+            }
+        }
+
+        const std::string m_path;             ///< The path of the files without the number.
+        const std::uint64_t m_max_bytes;      ///< The size a file is rotated out at.
+        const clock_type::duration m_max_age; ///< The age a file is rotated out at.
+        std::uint64_t m_next_number = 0;      ///< The number to try for the next file, not guarded.
+        mutable std::mutex m_mtx;             ///< Guards the members below.
+        std::condition_variable m_cv;         ///< Wakes the background thread.
+        int m_fd = -1;                        ///< The descriptor of the current file.
+        std::string m_current_path;           ///< The path of the current file.
+        std::uint64_t m_size = 0;             ///< The number of characters written into the current file.
+        clock_type::time_point m_opened;      ///< When the current file has started aging.
+        int m_next_fd = -1;                   ///< The descriptor of the next file, -1 if it isn't open yet.
+        std::string m_next_path;              ///< The path of the next file.
+        std::vector<int> m_retired;           ///< The files rotated out, waiting to be closed.
+        std::uint64_t m_rotations = 0;        ///< The number of rotations.
+        bool m_failed             = false;    ///< Whether a write or the opening of a file has failed.
+        bool m_stop               = false;    ///< Whether the background thread should stop.
+        std::thread m_thread;                 ///< The background thread.
+    };
+
+    /// @cond SHOW_INTERNAL
+    /**
+     * @brief Header at the start of a shared-memory ring.
+     *
+     * The data area following the header holds records of an 8-byte length word and the message, padded to
+     * 8 bytes. A writer claims the room of a record by advancing `reserved`, copies the message in and commits
+     * the record by storing the length with the committed bit. The reader zeroes every record it has read, so
+     * the length word of a record not committed yet is always 0.
+     */
+    struct alignas(64) __shm_ring_header
+    {
+        static_assert(
+            std::atomic<std::uint64_t>::is_always_lock_free && std::atomic<std::uint32_t>::is_always_lock_free,
+            "The counters of a shared-memory ring must be shared between processes"
+        );
+
+        static constexpr std::uint64_t committed = std::uint64_t{1} << 63; ///< Marks a committed length word.
+
+        char magic[8];                                   ///< Identifies the format, always "EPSSHMR1".
+        std::uint64_t capacity;                          ///< The size of the data area, a multiple of 8.
+        alignas(64) std::atomic<std::uint64_t> reserved; ///< The bytes ever claimed by the writers.
+        std::atomic<std::uint64_t> dropped;              ///< The messages dropped by the writers.
+        alignas(64) std::atomic<std::uint64_t> consumed; ///< The bytes ever read and released by the reader.
+        std::atomic<std::uint32_t> wake_seq;             ///< The futex word the reader sleeps on.
+        std::atomic<std::uint32_t> reader_sleeping;      ///< Whether the reader is about to sleep.
+        alignas(64) std::atomic<std::uint32_t> writers;  ///< The number of writers attached now.
+        std::atomic<std::uint32_t> attached;             ///< The number of writers ever attached.
+
+        /**
+         * @brief The magic string of shared-memory rings.
+         *
+         * @return const char* 8 characters without the null terminator.
+         */
+        static const char* __magic()
+        {
+            return "EPSSHMR1";
+        }
+
+        /**
+         * @brief Get the length word of the record at a position of the data area.
+         *
+         * @param data The data area.
+         * @param pos The position of the record, a multiple of 8.
+         * @return std::atomic<std::uint64_t>& The length word.
+         */
+        static std::atomic<std::uint64_t>& __length(char* data, std::size_t pos)
+        {
+            return *reinterpret_cast<std::atomic<std::uint64_t>*>(data + pos);
+        }
+
+        /**
+         * @brief Get the size of the record of a message.
+         *
+         * @param n The size of the message.
+         * @return std::uint64_t The size of the record, the length word and the message padded to 8 bytes.
+         */
+        static std::uint64_t __record_size(std::uint64_t n)
+        {
+            return 8 + ((n + 7) & ~std::uint64_t{7});
+        }
+    };
+
+    /**
+     * @brief Sleep until the value of a futex word changes from the expected one, or spuriously.
+     *
+     * Sleeps for a millisecond where futexes aren't available.
+     *
+     * @param word The futex word, shared between processes.
+     * @param expected The value the word has to have to sleep at all.
+     */
+    inline void __futex_wait(std::atomic<std::uint32_t>& word, [[maybe_unused]] std::uint32_t expected)
+    {
+#ifdef __linux__
+        ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAIT, expected, nullptr, nullptr, 0);
+#else
+        static_cast<void>(word);
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+#endif
+    }
+
+    /**
+     * @brief Wake the processes sleeping on a futex word.
+     *
+     * @param word The futex word, shared between processes.
+     */
+    inline void __futex_wake([[maybe_unused]] std::atomic<std::uint32_t>& word)
+    {
+#ifdef __linux__
+        ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif
+    }
+
+    /**
+     * @brief Map a POSIX shared memory object.
+     *
+     * @param fd The descriptor of the object, closed by the function.
+     * @param size The size of the object.
+     * @return void* The mapping.
+     * @throws std::system_error If the object couldn't be mapped.
+     */
+    inline void* __map_shm(int fd, std::size_t size)
+    {
+        void* map       = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        const int error = errno;
+        ::close(fd);
+        if (map == MAP_FAILED)
+        {
+            errno = error;
+            __throw_errno("mmap");
+        }
+        return map;
+    }
+    /// @endcond
+
+    /**
+     * @brief Message sink writing into a POSIX shared-memory ring read by shm_ring_istream, possibly in another
+     * process.
+     *
+     * Any number of sinks in any number of processes can write into the same ring. A writer claims the room for
+     * a message with a single atomic operation and copies the message in, so the sink is thread-safe without any
+     * lock, messages are never interleaved, and no system call is made as long as the reader is awake. The
+     * reader is woken with a futex when it sleeps. A message that doesn't fit into the free room of the ring is
+     * dropped and counted, the writers never wait for the reader.
+     *
+     * The sink is meant to be wrapped into a sink_postream:
+     * @code
+     * eps::shm_ring_sink sink{"/app-logs"};
+     * eps::sink_postream pout{sink};
+     * pout << "answer: " << 42 << '\n';
+     * @endcode
+     */
+    class shm_ring_sink
+    {
+    public:
+        using char_type   = char;                   ///< The character type.
+        using traits_type = std::char_traits<char>; ///< The character traits type.
+
+        /**
+         * @brief Construct a new shm_ring_sink object attaching it to a ring created by a shm_ring_istreambuf.
+         *
+         * @param name The name of the shared memory object of the ring.
+         * @throws std::system_error If the ring couldn't be opened or mapped.
+         * @throws std::runtime_error If the shared memory object isn't a ring.
+         */
+        explicit shm_ring_sink(const std::string& name)
+        {
+            const int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+            if (fd < 0)
+            {
+                __throw_errno("shm_open");
+            }
+            struct stat st;
+            if (::fstat(fd, &st) != 0)
+            {
+                const int error = errno;
+                ::close(fd);
+                errno = error;
+                __throw_errno("fstat");
+            }
+            m_size = static_cast<std::size_t>(st.st_size);
+            if (m_size < sizeof(__shm_ring_header))
+            {
+                ::close(fd);
+                throw std::runtime_error{"Not a shared-memory ring: " + name};
+            }
+
+            void* map = __map_shm(fd, m_size);
+            m_header  = static_cast<__shm_ring_header*>(map);
+            m_data    = static_cast<char*>(map) + sizeof(__shm_ring_header);
+            if (std::memcmp(m_header->magic, __shm_ring_header::__magic(), 8) != 0 ||
+                m_header->capacity != m_size - sizeof(__shm_ring_header))
+            {
+                ::munmap(map, m_size);
+                throw std::runtime_error{"Not a shared-memory ring: " + name};
+            }
+            m_capacity = static_cast<std::size_t>(m_header->capacity);
+
+            // Count the writer before marking the ring attached: the reader loads writers and then attached, so
+            // in the other order it could see an attached ring with no writers and end the stream right away
+            m_header->writers.fetch_add(1);
+            m_header->attached.fetch_add(1);
+        }
+
+        shm_ring_sink(const shm_ring_sink&)            = delete;
+        shm_ring_sink& operator=(const shm_ring_sink&) = delete;
+
+        /**
+         * @brief Destroy the shm_ring_sink object detaching it from the ring.
+         *
+         * The reader reaches the end of the stream once all the writers have detached.
+         */
+        ~shm_ring_sink()
+        {
+            m_header->writers.fetch_sub(1);
+            __wake_reader();
+            ::munmap(m_header, m_size);
+        }
+
+        /**
+         * @brief Write a message into the ring, or drop it if it doesn't fit.
+         *
+         * @param s The characters of the message.
+         * @param n The number of characters.
+         */
+        void write_message(const char* s, std::size_t n)
+        {
+            const std::uint64_t size = __shm_ring_header::__record_size(n);
+            std::uint64_t pos        = m_header->reserved.load(std::memory_order_relaxed);
+            do
+            {
+                // Acquire the zeroing of the released records by the reader
+                if (pos + size > m_header->consumed.load(std::memory_order_acquire) + m_capacity)
+                {
+                    m_header->dropped.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+            } while (!m_header->reserved.compare_exchange_weak(
+                pos, pos + size, std::memory_order_relaxed, std::memory_order_relaxed
+            ));
+
+            const std::size_t at    = static_cast<std::size_t>(pos % m_capacity);
+            const std::size_t start = (at + 8) % m_capacity;
+            const std::size_t first = n < m_capacity - start ? n : m_capacity - start;
+            std::memcpy(m_data + start, s, first);
+            std::memcpy(m_data, s + first, n - first);
+            __shm_ring_header::__length(m_data, at).store(n | __shm_ring_header::committed, std::memory_order_release);
+            __wake_reader();
+        }
+
+        /**
+         * @brief Get the number of messages dropped by all the writers of the ring.
+         *
+         * @return std::uint64_t The number of messages.
+         */
+        std::uint64_t dropped() const
+        {
+            return m_header->dropped.load(std::memory_order_relaxed);
+        }
+
+    private:
+        /**
+         * @brief Wake the reader if it's sleeping.
+         */
+        void __wake_reader()
+        {
+            // Pairs with the fence of the reader, one of the two sees what the other has done
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (m_header->reader_sleeping.load(std::memory_order_relaxed) != 0)
+            {
+                m_header->wake_seq.fetch_add(1, std::memory_order_relaxed);
+                __futex_wake(m_header->wake_seq);
+            }
+        }
+
+        std::size_t m_size;                    ///< The size of the mapping.
+        std::size_t m_capacity;                ///< The size of the data area.
+        __shm_ring_header* m_header = nullptr; ///< The header of the mapping.
+        char* m_data                = nullptr; ///< The data area of the mapping.
+    };
+
+    /**
+     * @brief Stream buffer reading the messages written into a POSIX shared-memory ring by shm_ring_sinks.
+     *
+     * The stream buffer creates the ring and is its only reader. Reading spins for a while and then sleeps
+     * on a futex while the ring is empty. The end of the stream is reached once the ring is empty and all the
+     * writers that have ever attached to it have detached. A writer process killed in the middle of a message
+     * stalls the reader at that message.
+     */
+    class shm_ring_istreambuf: public std::streambuf
+    {
+    public:
+        /**
+         * @brief Construct a new shm_ring_istreambuf object creating the ring.
+         *
+         * An existing shared memory object of the same name is started over.
+         *
+         * @param name The name of the shared memory object of the ring, starting with a slash.
+         * @param capacity The size of the data area of the ring, rounded up to a multiple of 8. A message
+         * needs its size padded to 8 bytes plus 8 bytes of it.
+         * @throws std::system_error If the ring couldn't be created.
+         */
+        shm_ring_istreambuf(std::string name, std::size_t capacity):
+            m_name{std::move(name)}, m_capacity{capacity < 64 ? 64 : (capacity + 7) & ~std::size_t{7}}
+        {
+            const int fd = ::shm_open(m_name.c_str(), O_RDWR | O_CREAT, 0600);
+            if (fd < 0)
+            {
+                __throw_errno("shm_open");
+            }
+            m_size = sizeof(__shm_ring_header) + m_capacity;
+            if (::ftruncate(fd, 0) != 0 || ::ftruncate(fd, static_cast<off_t>(m_size)) != 0)
+            {
+                const int error = errno;
+                ::close(fd);
+                ::shm_unlink(m_name.c_str());
+                errno = error;
+                __throw_errno("ftruncate");
+            }
+
+            void* map = __map_shm(fd, m_size);
+            m_header  = new (map) __shm_ring_header{};
+            m_data    = static_cast<char*>(map) + sizeof(__shm_ring_header);
+
+            m_header->capacity = m_capacity;
+            std::memcpy(m_header->magic, __shm_ring_header::__magic(), 8);
+        }
+
+        shm_ring_istreambuf(const shm_ring_istreambuf&)            = delete;
+        shm_ring_istreambuf& operator=(const shm_ring_istreambuf&) = delete;
+
+        /**
+         * @brief Destroy the shm_ring_istreambuf object removing the ring.
+         *
+         * Writers still attached keep their mapping, but nobody reads it anymore.
+         */
+        ~shm_ring_istreambuf() override
+        {
+            ::munmap(m_header, m_size);
+            ::shm_unlink(m_name.c_str());
+        }
+
+        /**
+         * @brief Get the name of the shared memory object of the ring.
+         *
+         * @return const std::string& The name.
+         */
+        const std::string& name() const
+        {
+            return m_name;
+        }
+
+        /**
+         * @brief Get the number of messages dropped by the writers as the ring was full.
+         *
+         * @return std::uint64_t The number of messages.
+         */
+        std::uint64_t dropped() const
+        {
+            return m_header->dropped.load(std::memory_order_relaxed);
+        }
+
+    protected:
+        int_type underflow() override
+        {
+            if (gptr() < egptr())
+            {
+                return traits_type::to_int_type(*gptr());
+            }
+
+            unsigned int spins = 0;
+            while (!__pop())
+            {
+                if (__finished())
+                {
+                    return traits_type::eof();
+                }
+                if (spins < 128)
+                {
+                    __spin_wait(spins);
+                    continue;
+                }
+
+                const std::uint32_t seq = m_header->wake_seq.load(std::memory_order_acquire);
+                m_header->reader_sleeping.store(1, std::memory_order_relaxed);
+                // Pairs with the fence of the writers, one of the two sees what the other has done
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (!__ready() && !__finished())
+                {
+                    __futex_wait(m_header->wake_seq, seq);
+                }
+                m_header->reader_sleeping.store(0, std::memory_order_relaxed);
+            }
+            setg(m_message.data(), m_message.data(), m_message.data() + m_message.size());
+            return traits_type::to_int_type(*gptr());
+        }
+
+    private:
+        /**
+         * @brief Check whether the next record is committed.
+         *
+         * @return bool Whether the next message can be read.
+         */
+        bool __ready() const
+        {
+            const std::size_t at = static_cast<std::size_t>(m_tail % m_capacity);
+            return (__shm_ring_header::__length(m_data, at).load(std::memory_order_acquire) &
+                    __shm_ring_header::committed) != 0;
+        }
+
+        /**
+         * @brief Check whether the end of the stream has been reached.
+         *
+         * @return bool Whether the ring is empty and all the writers have detached.
+         */
+        bool __finished() const
+        {
+            return m_header->writers.load() == 0 && m_header->attached.load() != 0 &&
+                   m_header->reserved.load() == m_tail;
+        }
+
+        /**
+         * @brief Read the next non-empty message into the buffer and release its record, skipping empty ones.
+         *
+         * @return bool Whether a message has been read.
+         */
+        bool __pop()
+        {
+            for (;;)
+            {
+                const std::size_t at               = static_cast<std::size_t>(m_tail % m_capacity);
+                std::atomic<std::uint64_t>& length = __shm_ring_header::__length(m_data, at);
+                const std::uint64_t word           = length.load(std::memory_order_acquire);
+                if ((word & __shm_ring_header::committed) == 0)
+                {
+                    return false;
+                }
+
+                const std::size_t n     = static_cast<std::size_t>(word & ~__shm_ring_header::committed);
+                const std::size_t start = (at + 8) % m_capacity;
+                const std::size_t first = n < m_capacity - start ? n : m_capacity - start;
+                m_message.assign(m_data + start, first);
+                m_message.append(m_data, n - first);
+
+                // Zero the record, so the length words of the next records written over it read as uncommitted
+                const std::uint64_t size = __shm_ring_header::__record_size(n);
+                const std::size_t padded = static_cast<std::size_t>(size) - 8;
+                const std::size_t head   = padded < m_capacity - start ? padded : m_capacity - start;
+                length.store(0, std::memory_order_relaxed);
+                std::memset(m_data + start, 0, head);
+                std::memset(m_data, 0, padded - head);
+
+                m_tail += size;
+                m_header->consumed.store(m_tail, std::memory_order_release);
+                if (n != 0)
+                {
+                    return true;
+                }
+            }
+        }
+
+        std::string m_name;                    ///< The name of the shared memory object.
+        std::size_t m_capacity;                ///< The size of the data area.
+        std::size_t m_size;                    ///< The size of the mapping.
+        __shm_ring_header* m_header = nullptr; ///< The header of the mapping.
+        char* m_data                = nullptr; ///< The data area of the mapping.
+        std::uint64_t m_tail        = 0;       ///< The position of the next record.
+        std::string m_message;                 ///< The message being read.
+    };
+
+    /**
+     * @brief Input stream reading the messages written into a POSIX shared-memory ring by shm_ring_sinks.
+     *
+     * @code
+     * eps::shm_ring_istream collector{"/app-logs", 1 << 20};
+     * std::string line;
+     * while (std::getline(collector, line))
+     * {
+     *     // ...
+     * }
+     * @endcode
+     */
+    class shm_ring_istream: public std::istream
+    {
+    public:
+        /**
+         * @brief Construct a new shm_ring_istream object creating the ring.
+         *
+         * @param name The name of the shared memory object of the ring, starting with a slash.
+         * @param capacity The size of the data area of the ring.
+         * @throws std::system_error If the ring couldn't be created.
+         */
+        shm_ring_istream(std::string name, std::size_t capacity):
+            std::istream{nullptr}, m_buf{std::move(name), capacity}
+        {
+            rdbuf(&m_buf);
+        }
+
+        /**
+         * @brief Get the stream buffer.
+         *
+         * @return shm_ring_istreambuf& The stream buffer.
+         */
+        shm_ring_istreambuf& buffer()
+        {
+            return m_buf;
+        }
+
+    private:
+        shm_ring_istreambuf m_buf; ///< The stream buffer.
+    };
+} // namespace eps
+
+#endif // EPICS_PSTREAM_POSIX17_HPP
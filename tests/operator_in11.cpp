@@ -2,8 +2,17 @@
 #include "doctest/doctest.h"
 
 #include <array>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
 #include <list>
+#include <map>
+#include <set>
+#include <stdexcept>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "epics/operator_in11.hpp"
@@ -75,3 +84,632 @@ TEST_CASE("testing operator in")
         }
     }
 }
+
+struct lookup_counter
+{
+    std::vector<int> values;
+    mutable int finds  = 0;
+    mutable int counts = 0;
+};
+
+struct with_find: lookup_counter
+{
+    std::vector<int>::const_iterator begin() const
+    {
+        return values.begin();
+    }
+
+    std::vector<int>::const_iterator end() const
+    {
+        return values.end();
+    }
+
+    std::vector<int>::const_iterator find(int x) const
+    {
+        ++finds;
+        return std::find(values.begin(), values.end(), x);
+    }
+};
+
+struct with_count: lookup_counter
+{
+    std::vector<int>::const_iterator begin() const
+    {
+        return values.begin();
+    }
+
+    std::vector<int>::const_iterator end() const
+    {
+        return values.end();
+    }
+
+    std::size_t count(int x) const
+    {
+        ++counts;
+        return static_cast<std::size_t>(std::count(values.begin(), values.end(), x));
+    }
+};
+
+struct less_than_counter
+{
+    int* comparisons;
+
+    bool operator()(int lhs, int rhs) const
+    {
+        ++*comparisons;
+        return lhs < rhs;
+    }
+};
+
+#if EPS_IN_CXX14
+struct name_key
+{
+    const char* text;
+};
+
+struct name_less
+{
+    typedef void is_transparent;
+
+    bool operator()(const std::string& lhs, const std::string& rhs) const
+    {
+        return lhs < rhs;
+    }
+
+    bool operator()(const name_key& lhs, const std::string& rhs) const
+    {
+        return lhs.text < rhs;
+    }
+
+    bool operator()(const std::string& lhs, const name_key& rhs) const
+    {
+        return lhs < rhs.text;
+    }
+};
+#endif
+
+TEST_CASE("testing operator in with the container's own lookup")
+{
+    SUBCASE("testing on set and map")
+    {
+        std::set<std::string> s{"Old", "Macdonald", "had", "a", "farm"};
+        std::map<int, std::string> m{{1, "cow"}, {2, "pig"}};
+        CHECK(true == ("farm" in s));
+        CHECK(false == ("form" in s));
+        CHECK(true == (2 in m));
+        CHECK(false == (3 in m));
+    }
+
+    SUBCASE("testing on unordered set and map")
+    {
+        std::unordered_set<int> s{1, 2, 3};
+        std::unordered_multimap<std::string, int> m{{"cow", 1}, {"cow", 2}};
+        CHECK(true == (3 in s));
+        CHECK(false == (4 in s));
+        CHECK(true == (std::string{"cow"} in m));
+        CHECK(false == (std::string{"pig"} in m));
+    }
+
+    SUBCASE("testing on string")
+    {
+        std::string s{"EIEIO"};
+        CHECK(true == ("EIO" in s));
+        CHECK(false == ("OIE" in s));
+    }
+
+    SUBCASE("testing on user containers")
+    {
+        with_find f;
+        f.values = {1, 2, 3};
+        CHECK(true == (2 in f));
+        CHECK(false == (4 in f));
+        CHECK(f.finds == 2);
+
+        with_count c;
+        c.values = {1, 2, 3};
+        CHECK(true == (2 in c));
+        CHECK(false == (4 in c));
+        CHECK(c.counts == 2);
+    }
+
+    SUBCASE("testing values not converting to the key type exactly")
+    {
+        // Compared with the elements instead of converted to the key type
+        std::set<int> s{3};
+        CHECK(false == (3.5 in s));
+        CHECK(true == (3.0 in s));
+        CHECK(true == (3L in s));
+        std::unordered_set<int> u{3};
+        CHECK(false == (3.5 in u));
+        std::string a{"A"};
+        CHECK(false == (321 in a));
+        CHECK(true == ('A' in a));
+        CHECK(true == (std::string{"A"} in a));
+    }
+
+#if EPS_IN_CXX14
+    SUBCASE("testing transparent comparators")
+    {
+        std::set<std::string, name_less> names{"cow", "pig"};
+        CHECK(true == (name_key{"cow"} in names));
+        CHECK(false == (name_key{"hen"} in names));
+    }
+#endif
+}
+
+TEST_CASE("testing operator in on sorted ranges")
+{
+    std::vector<int> v(1000);
+    for (int i = 0; i < 1000; ++i)
+    {
+        v[static_cast<std::size_t>(i)] = 2 * i;
+    }
+    CHECK(true == (0 in eps::sorted(v)));
+    CHECK(true == (1998 in eps::sorted(v)));
+    CHECK(true == (500 in eps::sorted(v)));
+    CHECK(false == (501 in eps::sorted(v)));
+    CHECK(false == (-1 in eps::sorted(v)));
+
+    int comparisons = 0;
+    CHECK(true == (1000 in eps::sorted(v, less_than_counter{&comparisons})));
+    CHECK(comparisons <= 12);
+
+    const int descending[] = {9, 7, 5, 3};
+    CHECK(true == (7 in eps::sorted(descending, std::greater<int>{})));
+    CHECK(false == (6 in eps::sorted(descending, std::greater<int>{})));
+}
+
+enum class color : std::uint16_t
+{
+    red,
+    green,
+    blue
+};
+
+template<typename T>
+void check_contiguous_lookup()
+{
+    for (std::size_t n = 0; n < 300; n += n < 70 ? 1 : 37)
+    {
+        std::vector<T> v(n);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            v[i] = static_cast<T>(i % 100 + 1);
+        }
+        const T absent = static_cast<T>(0);
+        CHECK(false == (absent in v));
+        if (n != 0)
+        {
+            const T last = v[n - 1];
+            v[n - 1]     = static_cast<T>(101);
+            CHECK(true == (static_cast<T>(101) in v));
+            v[n - 1] = last;
+            CHECK(true == (v[n / 2] in v));
+        }
+    }
+}
+
+template<std::size_t W>
+void check_kernel(eps::__in_kernel kernel)
+{
+    // The elements start at every offset within a vector register, the value is looked up at every position
+    std::vector<char> buffer(64 + 300 * W);
+    for (std::size_t offset = 0; offset < 64; offset += 7)
+    {
+        for (std::size_t n = 0; n < 300; n += n < 140 ? 1 : 29)
+        {
+            char* const p = buffer.data() + offset;
+            std::memset(p, 0x5a, n * W);
+            CHECK(false == kernel(p, n, 0));
+            for (std::size_t i = 0; i < n; i += n < 20 ? 1 : 7)
+            {
+                std::memset(p + i * W, 0, W);
+                CHECK(true == kernel(p, n, 0));
+                CHECK(true == kernel(p, i + 1, 0));
+                CHECK(false == kernel(p, i, 0));
+                std::memset(p + i * W, 0x5a, W);
+            }
+            // Values differing in a single byte don't match
+            if (W > 1 && n != 0)
+            {
+                p[(n - 1) * W] = 0;
+                CHECK(false == kernel(p, n, 0));
+            }
+        }
+    }
+}
+
+TEST_CASE("testing operator in on contiguous ranges")
+{
+    SUBCASE("testing on vectors of every width")
+    {
+        check_contiguous_lookup<std::int8_t>();
+        check_contiguous_lookup<std::uint16_t>();
+        check_contiguous_lookup<int>();
+        check_contiguous_lookup<std::int64_t>();
+    }
+
+    SUBCASE("testing on arrays of enumerators")
+    {
+        std::array<color, 40> a;
+        a.fill(color::red);
+        color c[70];
+        std::fill(c, c + 70, color::green);
+        CHECK(true == (color::red in a));
+        CHECK(false == (color::blue in a));
+        CHECK(true == (color::green in c));
+        CHECK(false == (color::red in c));
+        c[69] = color::red;
+        CHECK(true == (color::red in c));
+    }
+
+    SUBCASE("testing the kernels")
+    {
+        check_kernel<1>(&eps::__in_find_scalar<1>);
+        check_kernel<8>(&eps::__in_find_scalar<8>);
+#if EPS_IN_X86_KERNELS
+        check_kernel<1>(&eps::__in_find_sse2<1>);
+        check_kernel<2>(&eps::__in_find_sse2<2>);
+        check_kernel<4>(&eps::__in_find_sse2<4>);
+        check_kernel<8>(&eps::__in_find_sse2<8>);
+        if (__builtin_cpu_supports("avx2"))
+        {
+            check_kernel<1>(&eps::__in_find_avx2<1>);
+            check_kernel<2>(&eps::__in_find_avx2<2>);
+            check_kernel<4>(&eps::__in_find_avx2<4>);
+            check_kernel<8>(&eps::__in_find_avx2<8>);
+        }
+        if (__builtin_cpu_supports("avx512bw"))
+        {
+            check_kernel<1>(&eps::__in_find_avx512<1>);
+            check_kernel<2>(&eps::__in_find_avx512<2>);
+            check_kernel<4>(&eps::__in_find_avx512<4>);
+            check_kernel<8>(&eps::__in_find_avx512<8>);
+        }
+#endif
+    }
+}
+
+template<typename T, T... Vs>
+eps::__in_strategy strategy_of(eps::value_set<T, Vs...>)
+{
+    return eps::__in_constant_strategy<eps::__in_key(Vs)...>::value;
+}
+
+template<typename T, T... Vs>
+void check_value_set(eps::value_set<T, Vs...> set, long long from, long long to)
+{
+    const T values[] = {Vs...};
+    for (long long x = from; x <= to; ++x)
+    {
+        bool expected = false;
+        for (T v : values)
+        {
+            expected = expected || static_cast<long long>(v) == x;
+        }
+        CHECK(expected == (x in set));
+    }
+}
+
+typedef eps::value_set<int, 3, 17, 42, 99> small_set;
+typedef eps::value_set<int, 3, 17, 42, 60> dense_set;
+typedef eps::value_set<
+    long long, -1000000007, -65536, -999, -1, 0, 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59, 61, 67,
+    71, 73, 79, 83, 89, 97, 101, 127, 255, 256, 1000, 4096, 65535, 100000, 2147483647, 4294967296, 1000000000000>
+    large_set;
+
+static_assert(42 in small_set{}, "Constant sets are usable in constant expressions");
+static_assert(!(43 in small_set{}), "Constant sets are usable in constant expressions");
+static_assert(60 in dense_set{}, "Constant sets are usable in constant expressions");
+static_assert(!(61 in dense_set{}), "Constant sets are usable in constant expressions");
+static_assert(4294967296 in large_set{}, "Constant sets are usable in constant expressions");
+static_assert(!(4294967297 in large_set{}), "Constant sets are usable in constant expressions");
+
+TEST_CASE("testing operator in on constant sets")
+{
+    SUBCASE("testing the chosen tests")
+    {
+        CHECK(eps::__in_strategy::bitmask == strategy_of(dense_set{}));
+        CHECK(eps::__in_strategy::bitmask == strategy_of(eps::value_set<short, -10, -3, 0, 40>{}));
+        CHECK(eps::__in_strategy::compare == strategy_of(small_set{}));
+        CHECK(eps::__in_strategy::compare == strategy_of(eps::value_set<long long, -5, 1000000000000>{}));
+#if EPS_IN_CXX14
+        CHECK(eps::__in_strategy::perfect_hash == strategy_of(large_set{}));
+#else
+        CHECK(eps::__in_strategy::compare == strategy_of(large_set{}));
+#endif
+    }
+
+    SUBCASE("testing every test")
+    {
+        check_value_set(dense_set{}, -100, 200);
+        check_value_set(eps::value_set<short, -10, -3, 0, 40>{}, -100, 100);
+        check_value_set(small_set{}, -100, 200);
+        check_value_set(eps::value_set<long long, -5, 1000000000000>{}, -100, 100);
+        check_value_set(large_set{}, -70000, 70000);
+        CHECK(true == (-1000000007 in large_set{}));
+        CHECK(true == (1000000000000 in large_set{}));
+        CHECK(false == (999999999999 in large_set{}));
+        check_value_set(eps::value_set<int, 9, 9, 900, 90, 9000, 90, -9, -90, -900, 9>{}, -10000, 10000);
+    }
+
+    SUBCASE("testing values of other types")
+    {
+        CHECK(false == (-1 in eps::value_set<unsigned int, 0xFFFFFFFF>{}));
+        CHECK(true == (std::uint64_t{0xFFFFFFFF} in eps::value_set<unsigned int, 0xFFFFFFFF>{}));
+        CHECK(false == (std::uint64_t{0xFFFFFFFF} in eps::value_set<int, -1>{}));
+        CHECK(false == (-1 in eps::value_set<std::uint64_t, 1, 3, 5, 7, 11, 13, 17, 19, 23, 0xFFFFFFFFFFFFFFFF>{}));
+        CHECK(true == (std::uint8_t{7} in eps::value_set<std::uint64_t, 1, 3, 5, 7, 11, 13, 17, 19, 23, 900>{}));
+        CHECK(false == (((1LL << 32) + 3) in small_set{}));
+        CHECK(true == ('*' in small_set{}));
+        CHECK(true == (color::blue in eps::value_set<color, color::red, color::blue>{}));
+        CHECK(false == (color::green in eps::value_set<color, color::red, color::blue>{}));
+    }
+
+#if EPS_IN_CXX14
+    SUBCASE("testing the variable template")
+    {
+        static_assert(99 in eps::values<3, 17, 42, 99>, "Constant sets are usable in constant expressions");
+        CHECK(true == (std::uint16_t{17} in eps::values<3, 17, 42, 99>));
+        CHECK(false == (18 in eps::values<3, 17, 42, 99>));
+#if EPS_IN_CXX17
+        CHECK(true == (color::green in eps::values<color::green, color::blue>));
+        CHECK(false == (color::red in eps::values<color::green, color::blue>));
+#endif
+    }
+#endif
+}
+
+struct versioned
+{
+    int id;
+    int version;
+
+    bool operator<(const versioned& rhs) const
+    {
+        return id < rhs.id;
+    }
+
+    bool operator==(const versioned& rhs) const
+    {
+        return id == rhs.id && version == rhs.version;
+    }
+};
+
+struct fragile
+{
+    int value;
+
+    bool operator==(const fragile& rhs) const
+    {
+        if (value < 0 || rhs.value < 0)
+        {
+            throw std::runtime_error{"fragile: negative value"};
+        }
+        return value == rhs.value;
+    }
+};
+
+template<typename R, typename C>
+void check_batch(const R& keys, const C& c)
+{
+    const eps::membership_bitset bits = eps::each_of(keys) in c;
+    REQUIRE(bits.size() == static_cast<std::size_t>(std::distance(std::begin(keys), std::end(keys))));
+    std::size_t i = 0, found = 0;
+    for (const auto& key : keys)
+    {
+        CHECK(bits[i++] == (key in c));
+        found += (key in c) ? 1 : 0;
+    }
+    CHECK(bits.count() == found);
+    CHECK((eps::count_of(keys) in c) == found);
+    CHECK((eps::all_of(keys) in c) == (found == bits.size()));
+    CHECK((eps::any_of(keys) in c) == (found != 0));
+}
+
+TEST_CASE("testing batch lookups with operator in")
+{
+    SUBCASE("testing on vectors")
+    {
+        std::vector<int> v(1000);
+        for (std::size_t i = 0; i < v.size(); ++i)
+        {
+            v[i] = static_cast<int>(i * 7919 % 10007);
+        }
+        for (std::size_t m : {0, 1, 5, 100, 3000})
+        {
+            std::vector<long long> keys(m);
+            for (std::size_t i = 0; i < m; ++i)
+            {
+                keys[i] = static_cast<long long>(i * 31 % 10007);
+            }
+            check_batch(keys, v);
+            std::vector<double> doubles(v.begin(), v.end());
+            check_batch(keys, doubles);
+        }
+
+        const std::vector<int> subset(v.begin() + 100, v.begin() + 900);
+        CHECK(true == (eps::all_of(subset) in v));
+        CHECK(false == (eps::all_of(v) in subset));
+        CHECK(true == (eps::any_of(v) in subset));
+        CHECK((eps::count_of(v) in subset) == 800);
+        CHECK(true == (eps::all_of(std::vector<int>{}) in v));
+        CHECK(false == (eps::any_of(std::vector<int>{}) in v));
+    }
+
+    SUBCASE("testing on containers of strings")
+    {
+        std::list<std::string> words;
+        std::vector<std::string> keys;
+        for (int i = 0; i < 300; ++i)
+        {
+            words.push_back("word" + std::to_string(i * 2));
+            keys.push_back("word" + std::to_string(i * 3));
+        }
+        check_batch(keys, words);
+        const char* const few[] = {"word0", "word1"};
+        check_batch(few, words);
+    }
+
+    SUBCASE("testing elements whose ordering and equality disagree")
+    {
+        std::vector<double> v(100, 1.0);
+        v[50] = std::numeric_limits<double>::quiet_NaN();
+        const std::vector<double> nans(200, std::numeric_limits<double>::quiet_NaN());
+        check_batch(nans, v);
+        CHECK(false == (eps::all_of(nans) in v));
+        CHECK(false == (eps::any_of(nans) in v));
+
+        std::vector<versioned> entries, keys;
+        for (int i = 0; i < 100; ++i)
+        {
+            entries.push_back(versioned{i / 2, i % 2});
+        }
+        for (int i = 0; i < 200; ++i)
+        {
+            keys.push_back(versioned{i % 60, i % 3});
+        }
+        check_batch(keys, entries);
+        CHECK((eps::count_of(keys) in entries) == 116);
+
+        std::vector<std::string> storage;
+        for (int i = 0; i < 200; ++i)
+        {
+            storage.push_back("w" + std::to_string(i));
+        }
+        std::vector<const char*> hay;
+        for (const std::string& s : storage)
+        {
+            hay.push_back(s.c_str());
+        }
+        std::vector<std::string> words;
+        for (int i = 0; i < 5000; ++i)
+        {
+            words.push_back(storage[static_cast<std::size_t>(i * 7 % 200)]);
+        }
+        check_batch(words, hay);
+        CHECK(true == (eps::all_of(words) in hay));
+        CHECK((eps::count_of(words) in hay) == 5000);
+    }
+
+    SUBCASE("testing on containers with a lookup of their own")
+    {
+        const std::vector<int> keys = {1, 2, 3, 5, 8, 13, 21};
+        check_batch(keys, std::set<int>{1, 3, 5, 7, 9, 11, 13});
+        check_batch(keys, std::unordered_set<int>{2, 4, 8, 16});
+        const std::vector<int> sorted_values = {0, 2, 4, 8, 16, 32};
+        CHECK((eps::count_of(keys) in eps::sorted(sorted_values)) == 2);
+        CHECK((eps::count_of(keys) in eps::value_set<int, 1, 3, 5, 7, 9, 11, 13>{}) == 4);
+        const eps::membership_bitset bits = eps::each_of(keys) in eps::value_set<int, 2, 21>{};
+        CHECK(false == bits[0]);
+        CHECK(true == bits[1]);
+        CHECK(true == bits[6]);
+    }
+
+    SUBCASE("testing membership_bitset")
+    {
+        eps::membership_bitset bits{130};
+        CHECK(bits.size() == 130);
+        CHECK(bits.none());
+        bits.set(0);
+        bits.set(64);
+        bits.set(129);
+        CHECK(bits.any());
+        CHECK(false == bits.all());
+        CHECK(bits.count() == 3);
+        CHECK(true == bits[64]);
+        CHECK(false == bits[65]);
+        CHECK(bits.data()[2] == 2);
+        for (std::size_t i = 0; i < bits.size(); ++i)
+        {
+            bits.set(i);
+        }
+        CHECK(bits.all());
+        CHECK(eps::membership_bitset{0}.all());
+        CHECK(eps::membership_bitset{0}.none());
+    }
+}
+
+TEST_CASE("testing operator in with eps::par")
+{
+    SUBCASE("testing the serial fallback")
+    {
+        const std::vector<int> small = {1, 2, 3};
+        CHECK(true == (2 in eps::par(small)));
+        CHECK(false == (4 in eps::par(small)));
+        const std::list<int> l = {1, 2, 3};
+        CHECK(true == (3 in eps::par(l)));
+        const std::set<int> s = {1, 2, 3};
+        CHECK(false == (0 in eps::par(s)));
+        const int a[] = {4, 5, 6};
+        CHECK(true == (6 in eps::par(a)));
+        CHECK((eps::count_of(small) in eps::par(l)) == 3);
+    }
+
+    SUBCASE("testing the parallel search")
+    {
+        eps::__in_thread_pool pool{3};
+        std::vector<int> v(eps::__in_par_min_size * 4 + 123);
+        for (std::size_t i = 0; i < v.size(); ++i)
+        {
+            v[i] = static_cast<int>(i);
+        }
+        const int last = static_cast<int>(v.size()) - 1;
+        for (int x : {0, 1, static_cast<int>(eps::__in_par_block) - 1, static_cast<int>(eps::__in_par_block), last})
+        {
+            CHECK(true == eps::__in_parallel(x, v, v.size(), pool));
+        }
+        CHECK(false == eps::__in_parallel(-1, v, v.size(), pool));
+        CHECK(false == eps::__in_parallel(last + 1, v, v.size(), pool));
+        CHECK(true == (last in eps::par(v)));
+        CHECK(false == (-1 in eps::par(v)));
+
+        std::vector<std::string> words(eps::__in_par_min_size, "word");
+        words[words.size() / 2] = "needle";
+        CHECK(true == eps::__in_parallel(std::string{"needle"}, words, words.size(), pool));
+        CHECK(false == eps::__in_parallel(std::string{"hay"}, words, words.size(), pool));
+
+        const std::vector<int> keys = {-1, 0, last, last + 1};
+        CHECK((eps::count_of(keys) in eps::par(v)) == 2);
+    }
+
+    SUBCASE("testing the early cancellation")
+    {
+        std::vector<int> v(eps::__in_par_block * 8, 0);
+        const int one = 1;
+        v[1]          = one;
+        eps::__in_par_job<int, std::vector<int>> job{one, v, v.size()};
+        job.search();
+        CHECK(true == job.found);
+        CHECK(job.next == 1);
+
+        eps::__in_par_job<int, std::vector<int>> closed{one, v, v.size()};
+        closed.closed = true;
+        closed.help();
+        CHECK(false == closed.found);
+        CHECK(closed.next == 0);
+        CHECK(closed.busy == 0);
+    }
+
+    SUBCASE("testing throwing comparisons")
+    {
+        eps::__in_thread_pool pool{3};
+        std::vector<fragile> v(eps::__in_par_block * 8, fragile{0});
+        for (std::size_t i : {std::size_t{0}, v.size() / 2, v.size() - 1})
+        {
+            v[i] = fragile{-1};
+            CHECK_THROWS_AS(eps::__in_parallel(fragile{1}, v, v.size(), pool), std::runtime_error);
+            v[i] = fragile{0};
+        }
+        CHECK(true == eps::__in_parallel(fragile{0}, v, v.size(), pool));
+        CHECK(false == eps::__in_parallel(fragile{1}, v, v.size(), pool));
+
+        const fragile poison{-1};
+        eps::__in_par_job<fragile, std::vector<fragile>> job{poison, v, v.size()};
+        job.help();
+        CHECK(true == job.failed);
+        CHECK(true == job.closed);
+        CHECK(job.busy == 0);
+        CHECK(static_cast<bool>(job.error));
+    }
+}
@@ -4,8 +4,16 @@
 #include <algorithm>
 #include <array>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <mutex>
+#include <numeric>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <vector>
 
@@ -153,3 +161,1162 @@ TEST_CASE("testing pstream")
         CHECK(std::all_of(results.cbegin(), results.cend(), [](bool x) constexpr -> bool { return x; }));
     }
 }
+
+struct blocker
+{
+    std::atomic<bool>& entered;
+    std::atomic<bool>& release;
+    std::atomic<bool>& released;
+};
+
+std::ostream& operator<<(std::ostream& os, const blocker& b)
+{
+    b.entered = true;
+    for (int i = 0; i < 2000 && !b.release; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+    b.released = b.release.load();
+    return os;
+}
+
+TEST_CASE("testing pstream lock registry")
+{
+    SUBCASE("unrelated streams don't block each other")
+    {
+        std::stringstream ss1, ss2;
+        std::atomic<bool> entered = false, release = false, released = false;
+        blocker b{entered, release, released};
+
+        std::thread t{[&]() { eps::postream{ss1} << b; }};
+        while (!entered);
+        eps::postream{ss2} << "unblocked";
+        release = true;
+        t.join();
+
+        CHECK(released);
+        CHECK(ss2.str() == "unblocked");
+    }
+
+    SUBCASE("wrappers around the same stream share the lock")
+    {
+        std::stringstream ss;
+        std::atomic<bool> entered = false, release = false, released = false;
+        blocker b{entered, release, released};
+
+        std::thread t{[&]() { eps::postream<std::stringstream>{ss} << b; }};
+        while (!entered);
+        std::thread releaser{[&]()
+                             {
+                                 std::this_thread::sleep_for(std::chrono::milliseconds{50});
+                                 release = true;
+                             }};
+        std::string s = "shared";
+        eps::pstream<std::istream, std::ostream>{ss, ss} << s;
+        // The write above could only happen once the chain holding the blocker has completed
+        CHECK(released);
+        t.join();
+        releaser.join();
+    }
+}
+
+template<typename lock_t>
+void check_lock_policy()
+{
+    unsigned int num_threads = std::thread::hardware_concurrency();
+    num_threads              = num_threads == 0 ? default_num_threads : num_threads;
+    constexpr unsigned int messages_per_thread = 1000;
+
+    // Mutual exclusion, checked with an unsynchronized counter
+    lock_t lock;
+    unsigned int counter = 0;
+    {
+        std::vector<std::thread> threads;
+        threads.reserve(num_threads);
+        for (unsigned int i = 0; i < num_threads; ++i)
+        {
+            threads.emplace_back(
+                [&]()
+                {
+                    while (!go);
+                    for (unsigned int j = 0; j < messages_per_thread; ++j)
+                    {
+                        std::lock_guard<lock_t> lk{lock};
+                        ++counter;
+                    }
+                }
+            );
+        }
+        go = true;
+        for (std::thread& t : threads)
+        {
+            t.join();
+        }
+        go = false;
+    }
+    CHECK(counter == num_threads * messages_per_thread);
+    {
+        std::lock_guard<lock_t> lk{lock};
+        std::thread{[&]() { counter = lock.try_lock() ? 0 : 1; }}.join();
+    }
+    CHECK(counter == 1);
+    REQUIRE(lock.try_lock());
+    lock.unlock();
+
+    // Locks held at once are released in any order
+    lock_t other;
+    lock.lock();
+    other.lock();
+    lock.unlock();
+    CHECK(lock.try_lock());
+    other.unlock();
+    lock.unlock();
+
+    // The wrappers
+    std::stringstream ss;
+    {
+        std::vector<std::thread> threads;
+        threads.reserve(num_threads);
+        for (unsigned int i = 0; i < num_threads; ++i)
+        {
+            threads.emplace_back(
+                [i, postream = eps::postream<std::stringstream, lock_t>{ss}]() mutable
+                {
+                    while (!go);
+                    for (unsigned int j = 0; j < messages_per_thread; ++j)
+                    {
+                        postream << i << ' ' << j << '\n';
+                    }
+                }
+            );
+        }
+        go = true;
+        for (std::thread& t : threads)
+        {
+            t.join();
+        }
+        go = false;
+    }
+
+    eps::pstream<std::stringstream, std::stringstream, lock_t> pstream{ss, ss};
+    eps::pistream<std::stringstream, lock_t> pistream = pstream;
+    std::vector<unsigned int> next(num_threads, 0);
+    unsigned int i = 0, j = 0;
+    for (unsigned int line = 0; line < num_threads * messages_per_thread; ++line)
+    {
+        pistream >> i >> j;
+        REQUIRE(ss);
+        REQUIRE(i < num_threads);
+        CHECK(j == next[i]++);
+    }
+    ss.clear();
+    std::string word;
+    pstream << "policy" >> word;
+    CHECK(word == "policy");
+}
+
+TEST_CASE("testing pstream lock policies")
+{
+    SUBCASE("std::mutex")
+    {
+        check_lock_policy<std::mutex>();
+    }
+
+    SUBCASE("ttas_lock")
+    {
+        check_lock_policy<eps::ttas_lock>();
+    }
+
+    SUBCASE("ticket_lock")
+    {
+        check_lock_policy<eps::ticket_lock>();
+    }
+
+    SUBCASE("mcs_lock")
+    {
+        check_lock_policy<eps::mcs_lock>();
+    }
+
+    SUBCASE("wrappers around the same stream have to agree on the policy")
+    {
+        using mcs_postream = eps::postream<std::ostringstream, eps::mcs_lock>;
+
+        std::ostringstream oss;
+        {
+            eps::postream<std::ostringstream> postream{oss};
+            CHECK_THROWS_AS(mcs_postream{oss}, std::logic_error);
+            CHECK_NOTHROW(eps::postream<std::ostream>{oss});
+        }
+        mcs_postream postream{oss};
+        postream << "switched";
+        CHECK(oss.str() == "switched");
+    }
+}
+
+TEST_CASE("testing pstream chains with rvalue operands")
+{
+    std::stringstream ss;
+    eps::postream{ss} << std::string{"answer"} << ' ' << 42 << ' ' << std::to_string(4.5).substr(0, 3);
+    CHECK(ss.str() == "answer 42 4.5");
+
+    std::string prefix, suffix;
+    int number = 0;
+    eps::pistream{ss} >> std::setw(3) >> prefix >> suffix >> number;
+    CHECK(prefix == "ans");
+    CHECK(suffix == "wer");
+    CHECK(number == 42);
+
+    std::stringstream io;
+    int a = 0, b = 0, c = 0;
+    io << "1 2";
+    eps::pstream<std::stringstream, std::stringstream>{io, io} >> a << std::string{" 3"} >> b >> c;
+    CHECK(a == 1);
+    CHECK(b == 2);
+    CHECK(c == 3);
+}
+
+class message_log: public std::streambuf
+{
+public:
+    std::vector<std::string> messages;
+
+protected:
+    std::streamsize xsputn(const char* s, std::streamsize n) override
+    {
+        messages.emplace_back(s, static_cast<std::size_t>(n));
+        return n;
+    }
+
+    int_type overflow(int_type ch) override
+    {
+        messages.emplace_back(1, traits_type::to_char_type(ch));
+        return ch;
+    }
+};
+
+class failing_log: public message_log
+{
+public:
+    bool fail = false;
+
+protected:
+    std::streamsize xsputn(const char* s, std::streamsize n) override
+    {
+        if (fail)
+        {
+            throw std::runtime_error{"write failed"};
+        }
+        return message_log::xsputn(s, n);
+    }
+};
+
+class slow_log: public message_log
+{
+public:
+    std::atomic<bool> entered = false;
+
+protected:
+    std::streamsize xsputn(const char* s, std::streamsize n) override
+    {
+        entered = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        return message_log::xsputn(s, n);
+    }
+};
+
+TEST_CASE("testing buffered_postream")
+{
+    unsigned int num_threads = std::thread::hardware_concurrency();
+    num_threads              = num_threads == 0 ? default_num_threads : num_threads;
+
+    message_log log;
+    std::ostream os{&log};
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads);
+    for (unsigned int i = 0; i < num_threads; ++i)
+    {
+        threads.emplace_back(
+            [i, bpostream = eps::buffered_postream{os}]() mutable
+            {
+                while (!go);
+                bpostream << i << ' ' << std::to_string(i) << ' ' << i << '\n';
+            }
+        );
+    }
+    go = true;
+    for (std::thread& t : threads)
+    {
+        t.join();
+    }
+    go = false;
+
+    // Every message reaches the stream buffer as a single write
+    REQUIRE(log.messages.size() == num_threads);
+    std::vector<bool> seen(num_threads, false);
+    for (const std::string& message : log.messages)
+    {
+        std::istringstream iss{message};
+        std::array<data_type, same_values_in_a_row> readings;
+        for (data_type& reading : readings)
+        {
+            iss >> reading;
+        }
+        CHECK(
+            std::adjacent_find(readings.cbegin(), readings.cend(), std::not_equal_to<data_type>{}) == readings.cend()
+        );
+        REQUIRE(readings[0] < num_threads);
+        seen[readings[0]] = true;
+    }
+    CHECK(std::all_of(seen.cbegin(), seen.cend(), [](bool x) constexpr -> bool { return x; }));
+
+    // The formatting settings of the original stream are used
+    std::ostringstream oss;
+    oss << std::hex << std::showbase;
+    eps::buffered_postream{oss} << 255 << std::string{" "} << 16;
+    CHECK(oss.str() == "0xff 0x10");
+}
+
+// Writes through a wrapper from a thread_local destructor, running after the slots of the thread are closed
+struct late_writer
+{
+    eps::try_postream<std::ostream>* wrapper = nullptr;
+
+    ~late_writer()
+    {
+        if (wrapper != nullptr)
+        {
+            // Frees the closed slot of this very thread before writing again
+            wrapper->flush();
+            *wrapper << "late\n";
+        }
+    }
+};
+
+thread_local late_writer t_late_writer;
+
+TEST_CASE("testing try_postream")
+{
+    message_log log;
+    std::ostream os{&log};
+    std::atomic<bool> entered = false, release = false, released = false;
+    blocker b{entered, release, released};
+
+    eps::try_postream dropping{os, eps::contention_policy::drop};
+    eps::try_postream parking{os, eps::contention_policy::park, 8};
+    dropping << "free\n";
+    CHECK(dropping.written() == 1);
+
+    std::thread t{[&]() { eps::postream{os} << b; }};
+    while (!entered);
+    // Neither chain waits for the blocker
+    dropping << "dropped\n";
+    parking << 1 << '\n';
+    parking << 2 << '\n';
+    parking << "too long\n";
+    release = true;
+    t.join();
+
+    CHECK(released);
+    CHECK(dropping.dropped() == 1);
+    CHECK(parking.parked() == 2);
+    CHECK(parking.dropped() == 1);
+    CHECK(log.messages == std::vector<std::string>{"free\n"});
+
+    // Parked messages are written before the next message of the thread
+    parking << 3 << '\n';
+    CHECK(parking.written() == 1);
+    CHECK(log.messages == std::vector<std::string>{"free\n", "1\n2\n", "3\n"});
+
+    // flush() writes the parked messages without a new message
+    entered = false;
+    release = false;
+    t       = std::thread{[&]() { eps::postream{os} << b; }};
+    while (!entered);
+    parking << 4 << '\n';
+    release = true;
+    t.join();
+    parking.flush();
+    CHECK(log.messages.back() == "4\n");
+
+    // A thread exiting writes the messages it has parked
+    entered = false;
+    release = false;
+    t       = std::thread{[&]() { eps::postream{os} << b; }};
+    while (!entered);
+    std::thread exiting{[&]() { parking << 5 << '\n'; }};
+    while (parking.parked() != 4);
+    release = true;
+    t.join();
+    exiting.join();
+    CHECK(log.messages.back() == "5\n");
+
+    // A thread_local destroyed after the slots of its thread gets a slot of its own
+    std::thread late{[&]()
+                     {
+                         t_late_writer.wrapper = &parking;
+                         parking << "early\n";
+                     }};
+    late.join();
+    CHECK(log.messages.back() == "late\n");
+
+    // A wrapper destroyed before the threads writes the messages they have parked
+    std::atomic<bool> parked = false, destroyed = false;
+    std::thread surviving;
+    {
+        eps::try_postream scoped{os, eps::contention_policy::park, 8};
+        entered = false;
+        release = false;
+        t       = std::thread{[&]() { eps::postream{os} << b; }};
+        while (!entered);
+        surviving = std::thread{
+            [&]()
+            {
+                scoped << 6 << '\n';
+                parked = true;
+                while (!destroyed);
+            }
+        };
+        while (!parked);
+        release = true;
+        t.join();
+    }
+    CHECK(log.messages.back() == "6\n");
+    destroyed = true;
+    surviving.join();
+}
+
+struct counted
+{
+    int& formatted;
+};
+
+std::ostream& operator<<(std::ostream& os, const counted& c)
+{
+    ++c.formatted;
+    return os;
+}
+
+TEST_CASE("testing sampled_postream")
+{
+    SUBCASE("every Nth chain is written and suppressed ones aren't formatted")
+    {
+        std::ostringstream oss;
+        int formatted = 0;
+        {
+            eps::sampled_postream site{eps::postream{oss}, eps::sample_every{3}, "site", std::chrono::seconds{0}};
+            for (int i = 0; i < 8; ++i)
+            {
+                site << counted{formatted} << i << '\n';
+            }
+        }
+        CHECK(formatted == 3);
+        // With no summary period every admitted chain writes the summary line of the chains suppressed before it
+        const std::string two = "site: 2 messages suppressed\n";
+        CHECK(oss.str() == "0\n" + two + "3\n" + two + "6\n" + "site: 1 message suppressed\n");
+    }
+
+    SUBCASE("chains are rate limited with bursts")
+    {
+        std::ostringstream oss;
+        {
+            eps::sampled_postream site{eps::buffered_postream{oss}, eps::rate_limit{0.001, 3}, "burst"};
+            for (int i = 0; i < 10; ++i)
+            {
+                site << i << '\n';
+            }
+        }
+        // The summary line of a period not over yet is written by the last copy of the adaptor
+        CHECK(oss.str() == "0\n1\n2\nburst: 7 messages suppressed\n");
+    }
+
+    SUBCASE("the summary line comes while every chain is suppressed")
+    {
+        std::ostringstream oss;
+        eps::sampled_postream site{
+            eps::postream{oss}, eps::rate_limit{0.001, 1}, "quiet", std::chrono::milliseconds{10}
+        };
+        site << "admitted\n";
+        for (int i = 0; i < 63; ++i)
+        {
+            site << i << '\n';
+        }
+        CHECK(oss.str() == "admitted\n");
+        std::this_thread::sleep_for(std::chrono::milliseconds{20});
+        // Only one in so many suppressed chains reads the clock
+        site << "suppressed\n";
+        CHECK(oss.str() == "admitted\nquiet: 64 messages suppressed\n");
+        site << "suppressed\n";
+        CHECK(oss.str() == "admitted\nquiet: 64 messages suppressed\n");
+    }
+}
+
+TEST_CASE("testing binary_postream")
+{
+    const std::string str = "string";
+    const auto write      = [&str](auto&& postream, int i)
+    {
+        postream << true << ' ' << 'c' << static_cast<signed char>('s') << static_cast<unsigned char>('u') << ' '
+                 << static_cast<short>(-i) << ' ' << static_cast<unsigned short>(i) << ' ' << -i << ' ' << i * 2u
+                 << ' ' << -i * 100000L << ' ' << i * 100000UL << ' ' << -i * 10000000000LL << ' '
+                 << i * 10000000000ULL << ' ' << i / 3.0f << ' ' << i / 7.0 << ' ' << i / 9.0L << ' ' << "literal"
+                 << ' ' << str << ' ' << std::string_view{str}.substr(3) << ' ' << str.c_str() << '\n';
+    };
+
+    SUBCASE("the decoded text is what postream would have written")
+    {
+        std::stringstream log{std::ios_base::in | std::ios_base::out | std::ios_base::binary};
+        std::ostringstream expected;
+        expected << std::setprecision(10) << std::boolalpha;
+        for (int i = 0; i < 10; ++i)
+        {
+            write(eps::binary_postream{log}, i);
+            write(eps::postream{expected}, i);
+        }
+
+        std::ostringstream decoded;
+        decoded << std::setprecision(10) << std::boolalpha;
+        CHECK(eps::decode_binary_log(log, decoded) == 10);
+        CHECK(decoded.str() == expected.str());
+    }
+
+    SUBCASE("records are written whole by concurrent threads")
+    {
+        unsigned int num_threads = std::thread::hardware_concurrency();
+        num_threads              = num_threads == 0 ? default_num_threads : num_threads;
+        constexpr unsigned int messages_per_thread = 100;
+
+        std::stringstream log{std::ios_base::in | std::ios_base::out | std::ios_base::binary};
+        std::vector<std::thread> threads;
+        threads.reserve(num_threads);
+        for (unsigned int i = 0; i < num_threads; ++i)
+        {
+            threads.emplace_back(
+                [i, bpostream = eps::binary_postream{log}]() mutable
+                {
+                    while (!go);
+                    for (unsigned int j = 0; j < messages_per_thread; ++j)
+                    {
+                        bpostream << i << ' ' << j << ' ' << std::to_string(i) << '\n';
+                    }
+                }
+            );
+        }
+        go = true;
+        for (std::thread& t : threads)
+        {
+            t.join();
+        }
+        go = false;
+
+        std::stringstream decoded;
+        CHECK(eps::decode_binary_log(log, decoded) == num_threads * messages_per_thread);
+        std::vector<unsigned int> next(num_threads, 0);
+        unsigned int i = 0, j = 0, k = 0;
+        while (decoded >> i >> j >> k)
+        {
+            REQUIRE(i < num_threads);
+            CHECK(i == k);
+            CHECK(j == next[i]++);
+        }
+        CHECK(std::all_of(next.cbegin(), next.cend(), [](unsigned int n) { return n == messages_per_thread; }));
+    }
+
+    SUBCASE("complete records of a log cut short are decoded")
+    {
+        std::stringstream log{std::ios_base::in | std::ios_base::out | std::ios_base::binary};
+        eps::binary_postream bpostream{log};
+        bpostream << 1 << '\n';
+        bpostream << 2.5 << '\n';
+        bpostream << "three" << '\n';
+
+        const std::string full = log.str();
+        std::istringstream cut{full.substr(0, full.size() - 2), std::ios_base::in | std::ios_base::binary};
+        std::ostringstream decoded;
+        CHECK(eps::decode_binary_log(cut, decoded) == 2);
+        CHECK(decoded.str() == "1\n2.5\n");
+
+        std::string garbage = full;
+        garbage[sizeof(std::uint32_t) + 1] = '\x7f';
+        std::istringstream malformed{garbage, std::ios_base::in | std::ios_base::binary};
+        CHECK_THROWS_AS(eps::decode_binary_log(malformed, decoded), std::runtime_error);
+
+        // A bool stored as anything other than 0 or 1 is rejected
+        std::stringstream bool_log{std::ios_base::in | std::ios_base::out | std::ios_base::binary};
+        eps::binary_postream{bool_log} << true;
+        std::string bad_bool = bool_log.str();
+        REQUIRE(bad_bool.size() == sizeof(std::uint32_t) + 3);
+        bad_bool.back() = '\x02';
+        std::istringstream bad_bool_log{bad_bool, std::ios_base::in | std::ios_base::binary};
+        CHECK_THROWS_AS(eps::decode_binary_log(bad_bool_log, decoded), std::runtime_error);
+    }
+
+    SUBCASE("null strings are recorded as empty strings")
+    {
+        std::stringstream log{std::ios_base::in | std::ios_base::out | std::ios_base::binary};
+        const char* null = nullptr;
+        eps::binary_postream{log} << '[' << null << ']' << '\n';
+        CHECK(log.good());
+
+        std::ostringstream decoded;
+        CHECK(eps::decode_binary_log(log, decoded) == 1);
+        CHECK(decoded.str() == "[]\n");
+    }
+}
+
+class gated_log: public message_log
+{
+public:
+    std::atomic<bool> open = false;
+
+protected:
+    std::streamsize xsputn(const char* s, std::streamsize n) override
+    {
+        while (!open)
+        {
+            std::this_thread::yield();
+        }
+        return message_log::xsputn(s, n);
+    }
+};
+
+TEST_CASE("testing async_postream")
+{
+    unsigned int num_threads = std::thread::hardware_concurrency();
+    num_threads              = num_threads == 0 ? default_num_threads : num_threads;
+    constexpr unsigned int messages_per_thread = 100;
+
+    SUBCASE("messages are written whole and flush() waits for them")
+    {
+        message_log log;
+        std::ostream os{&log};
+        eps::async_postream apostream{os, 16};
+        std::vector<std::thread> threads;
+        threads.reserve(num_threads);
+        for (unsigned int i = 0; i < num_threads; ++i)
+        {
+            threads.emplace_back(
+                [i, &apostream]()
+                {
+                    while (!go);
+                    for (unsigned int j = 0; j < messages_per_thread; ++j)
+                    {
+                        apostream << i << ' ' << j << ' ' << i << '\n';
+                    }
+                }
+            );
+        }
+        go = true;
+        for (std::thread& t : threads)
+        {
+            t.join();
+        }
+        go = false;
+        apostream.flush();
+
+        REQUIRE(log.messages.size() == num_threads * messages_per_thread);
+        CHECK(apostream.dropped() == 0);
+        std::vector<unsigned int> next(num_threads, 0);
+        for (const std::string& message : log.messages)
+        {
+            std::istringstream iss{message};
+            unsigned int i = 0, j = 0, k = 0;
+            iss >> i >> j >> k;
+            REQUIRE(i < num_threads);
+            CHECK(i == k);
+            CHECK(j == next[i]++); // Messages of a thread keep their order
+        }
+    }
+
+    SUBCASE("producers wait for room with overflow_policy::block")
+    {
+        gated_log log;
+        std::ostream os{&log};
+        std::atomic<unsigned int> pushed = 0;
+        {
+            eps::async_postream apostream{os, 4, eps::overflow_policy::block};
+            std::thread producer{[&]()
+                                 {
+                                     for (unsigned int j = 0; j < messages_per_thread; ++j)
+                                     {
+                                         apostream << j << '\n';
+                                         ++pushed;
+                                     }
+                                 }};
+            std::this_thread::sleep_for(std::chrono::milliseconds{20});
+            // The consumer holds one message at the gate, the queue the next ones
+            CHECK(pushed < messages_per_thread);
+            log.open = true;
+            producer.join();
+            CHECK(apostream.dropped() == 0);
+        }
+        REQUIRE(log.messages.size() == messages_per_thread);
+        CHECK(log.messages.back() == std::to_string(messages_per_thread - 1) + "\n");
+    }
+
+    SUBCASE("overflow policies")
+    {
+        for (eps::overflow_policy policy : {eps::overflow_policy::drop_newest, eps::overflow_policy::drop_oldest})
+        {
+            gated_log log;
+            std::ostream os{&log};
+            std::size_t dropped = 0;
+            {
+                eps::async_postream apostream{os, 4, policy};
+                for (unsigned int j = 0; j < messages_per_thread; ++j)
+                {
+                    apostream << j << '\n';
+                }
+                dropped = apostream.dropped();
+                CHECK(dropped > 0);
+                log.open = true;
+            }
+            REQUIRE(log.messages.size() == messages_per_thread - dropped);
+            if (policy == eps::overflow_policy::drop_oldest)
+            {
+                CHECK(log.messages.back() == std::to_string(messages_per_thread - 1) + "\n");
+            }
+            else
+            {
+                CHECK(log.messages.front() == "0\n");
+            }
+        }
+    }
+}
+
+TEST_CASE("testing fanout_sink")
+{
+    constexpr unsigned int num_messages = 100;
+
+    std::ostringstream fast;
+    gated_log log;
+    std::ostream slow{&log};
+    {
+        eps::fanout_sink fanout;
+        CHECK(fanout.add(fast, num_messages) == 0);
+        CHECK(fanout.add(slow, 4) == 1);
+        CHECK(fanout.size() == 2);
+
+        eps::sink_postream spostream{fanout};
+        for (unsigned int j = 0; j < num_messages; ++j)
+        {
+            spostream << j << '\n';
+        }
+        // The slow destination doesn't hold up the fast one
+        fanout.flush(0);
+        CHECK(fanout.lag(0) == 0);
+        CHECK(fanout.dropped(0) == 0);
+        CHECK(fanout.dropped(1) > 0);
+
+        std::istringstream iss{fast.str()};
+        unsigned int j = 0, next = 0;
+        while (iss >> j)
+        {
+            CHECK(j == next++);
+        }
+        CHECK(next == num_messages);
+
+        log.open = true;
+        fanout.flush();
+        CHECK(fanout.lag(1) == 0);
+        CHECK(log.messages.size() == num_messages - fanout.dropped(1));
+    }
+}
+
+TEST_CASE("testing batched_postream")
+{
+    unsigned int num_threads = std::thread::hardware_concurrency();
+    num_threads              = num_threads == 0 ? default_num_threads : num_threads;
+    constexpr unsigned int messages_per_thread = 100;
+
+    message_log log;
+    std::ostream os{&log};
+    eps::batched_postream bpostream{os};
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads);
+    for (unsigned int i = 0; i < num_threads; ++i)
+    {
+        threads.emplace_back(
+            [i, bpostream]() mutable
+            {
+                while (!go);
+                for (unsigned int j = 0; j < messages_per_thread; ++j)
+                {
+                    bpostream << i << ' ' << j << ' ' << i << '\n';
+                }
+            }
+        );
+    }
+    go = true;
+    for (std::thread& t : threads)
+    {
+        t.join();
+    }
+    go = false;
+
+    // Batches hold whole messages
+    CHECK(log.messages.size() <= num_threads * messages_per_thread);
+    std::size_t num_messages = 0;
+    std::vector<unsigned int> next(num_threads, 0);
+    for (const std::string& batch : log.messages)
+    {
+        REQUIRE(!batch.empty());
+        CHECK(batch.back() == '\n');
+        std::istringstream iss{batch};
+        unsigned int i = 0, j = 0, k = 0;
+        while (iss >> i >> j >> k)
+        {
+            ++num_messages;
+            REQUIRE(i < num_threads);
+            CHECK(i == k);
+            CHECK(j == next[i]++); // Messages of a thread keep their order
+        }
+    }
+    CHECK(num_messages == num_threads * messages_per_thread);
+
+    // A limit of zero on the pending batch doesn't block the producers
+    std::ostringstream unlimited;
+    eps::batched_postream{unlimited, 0} << "a" << 1;
+    CHECK(unlimited.str() == "a1");
+
+    // A stream buffer failing with an exception sets badbit and the writer role is given back
+    failing_log failing;
+    std::ostream fos{&failing};
+    eps::batched_postream fbpostream{fos};
+    failing.fail = true;
+    fbpostream << "lost\n";
+    CHECK(fos.bad());
+    fos.clear();
+    failing.fail = false;
+    fbpostream << "kept\n";
+    REQUIRE(failing.messages.size() == 1);
+    CHECK(failing.messages.back() == "kept\n");
+
+    // The first writer hands the writer role over while the other threads keep producing
+    constexpr unsigned int max_produced = 1000;
+    slow_log slow;
+    std::ostream sos{&slow};
+    eps::batched_postream sbpostream{sos, 64};
+    std::atomic<bool> leader_done = false;
+    std::atomic<unsigned int> produced = 0;
+    threads.clear();
+    for (unsigned int i = 0; i < 4; ++i)
+    {
+        threads.emplace_back(
+            [&, sbpostream]() mutable
+            {
+                while (!slow.entered);
+                while (!leader_done && produced < max_produced)
+                {
+                    sbpostream << "producer\n";
+                    ++produced;
+                }
+            }
+        );
+    }
+    sbpostream << "leader\n";
+    leader_done = true;
+    for (std::thread& t : threads)
+    {
+        t.join();
+    }
+    CHECK(produced < max_produced);
+    std::size_t lines = 0;
+    for (const std::string& batch : slow.messages)
+    {
+        lines += static_cast<std::size_t>(std::count(batch.begin(), batch.end(), '\n'));
+    }
+    CHECK(lines == produced + 1);
+}
+
+TEST_CASE("testing sharded_postream")
+{
+    SUBCASE("messages stay whole and ordered per thread")
+    {
+        unsigned int num_threads = std::thread::hardware_concurrency();
+        num_threads              = num_threads == 0 ? default_num_threads : num_threads;
+        constexpr unsigned int messages_per_thread = 100;
+
+        message_log log;
+        std::ostream os{&log};
+        {
+            eps::sharded_postream spostream{os, std::chrono::milliseconds{1}};
+            std::vector<std::thread> threads;
+            threads.reserve(num_threads);
+            for (unsigned int i = 0; i < num_threads; ++i)
+            {
+                threads.emplace_back(
+                    [i, &spostream]()
+                    {
+                        while (!go);
+                        for (unsigned int j = 0; j < messages_per_thread; ++j)
+                        {
+                            spostream << i << ' ' << j << ' ' << i << '\n';
+                        }
+                    }
+                );
+            }
+            go = true;
+            for (std::thread& t : threads)
+            {
+                t.join();
+            }
+            go = false;
+        }
+
+        std::size_t num_messages = 0;
+        std::vector<unsigned int> next(num_threads, 0);
+        for (const std::string& batch : log.messages)
+        {
+            REQUIRE(!batch.empty());
+            CHECK(batch.back() == '\n');
+            std::istringstream iss{batch};
+            unsigned int i = 0, j = 0, k = 0;
+            while (iss >> i >> j >> k)
+            {
+                ++num_messages;
+                REQUIRE(i < num_threads);
+                CHECK(i == k);
+                CHECK(j == next[i]++);
+            }
+        }
+        CHECK(num_messages == num_threads * messages_per_thread);
+    }
+
+    SUBCASE("messages are ordered by time across threads")
+    {
+        constexpr unsigned int num_messages = 1000;
+
+        std::ostringstream oss;
+        eps::sharded_postream spostream{oss, std::chrono::milliseconds{1}};
+        std::atomic<unsigned int> turn = 0;
+        const auto play = [&](unsigned int parity)
+        {
+            for (unsigned int n = parity; n < num_messages; n += 2)
+            {
+                while (turn != n)
+                {
+                    std::this_thread::yield();
+                }
+                spostream << n << '\n';
+                turn = n + 1;
+            }
+        };
+        std::thread even{play, 0u};
+        std::thread odd{play, 1u};
+        even.join();
+        odd.join();
+        spostream.flush();
+
+        std::istringstream iss{oss.str()};
+        unsigned int expected = 0, n = 0;
+        while (iss >> n)
+        {
+            CHECK(n == expected++);
+        }
+        CHECK(expected == num_messages);
+    }
+
+    SUBCASE("threads may exit before or after the wrapper")
+    {
+        std::ostringstream oss;
+        std::atomic<bool> written = false, destroyed = false;
+        std::thread survivor;
+        {
+            eps::sharded_postream spostream{oss, std::chrono::milliseconds{1}};
+            for (unsigned int i = 0; i < 50; ++i)
+            {
+                std::thread{[i, &spostream]() { spostream << i << '\n'; }}.join();
+            }
+            spostream.flush();
+            survivor = std::thread{
+                [&]()
+                {
+                    spostream << 50 << '\n';
+                    written = true;
+                    while (!destroyed)
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            };
+            while (!written)
+            {
+                std::this_thread::yield();
+            }
+        }
+        // The survivor exits after the wrapper is gone
+        destroyed = true;
+        survivor.join();
+
+        std::istringstream iss{oss.str()};
+        unsigned int expected = 0, n = 0;
+        while (iss >> n)
+        {
+            CHECK(n == expected++);
+        }
+        CHECK(expected == 51);
+    }
+}
+
+TEST_CASE("testing pstream lock statistics")
+{
+    unsigned int num_threads = std::thread::hardware_concurrency();
+    num_threads              = num_threads == 0 ? default_num_threads : num_threads;
+    constexpr unsigned int messages_per_thread = 100;
+
+    std::ostringstream oss;
+    std::istringstream iss{"1 2 3"};
+    eps::postream postream{oss};
+    eps::pistream pistream{iss};
+
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads);
+    for (unsigned int i = 0; i < num_threads; ++i)
+    {
+        threads.emplace_back(
+            [i, postream]() mutable
+            {
+                while (!go);
+                for (unsigned int j = 0; j < messages_per_thread; ++j)
+                {
+                    postream << i << ' ' << j << '\n';
+                }
+            }
+        );
+    }
+    go = true;
+    for (std::thread& t : threads)
+    {
+        t.join();
+    }
+    go = false;
+    int a = 0, b = 0, c = 0;
+    pistream >> a >> b >> c;
+
+    const eps::pstream_stats ostats = eps::pstream_stats_of(oss);
+    const eps::pstream_stats istats = eps::pstream_stats_of(iss);
+    const auto snapshot             = eps::pstream_stats_snapshot();
+    const auto has_stats = [&snapshot](const void* stream)
+    {
+        return std::any_of(snapshot.begin(), snapshot.end(), [stream](const auto& s) { return s.first == stream; });
+    };
+    if constexpr (eps::pstream_stats_enabled)
+    {
+        const auto total = [](const auto& histogram)
+        { return std::accumulate(histogram.begin(), histogram.end(), std::uint64_t{0}); };
+
+        CHECK(ostats.acquisitions == num_threads * messages_per_thread);
+        CHECK(ostats.contended <= ostats.acquisitions);
+        CHECK(ostats.chains == num_threads * messages_per_thread);
+        CHECK(ostats.actions == 4 * num_threads * messages_per_thread);
+        CHECK(total(ostats.wait_histogram) == ostats.acquisitions);
+        CHECK(total(ostats.held_histogram) == ostats.acquisitions);
+        CHECK(istats.acquisitions == 1);
+        CHECK(istats.chains == 1);
+        CHECK(istats.actions == 3);
+        CHECK(has_stats(&oss));
+        CHECK(has_stats(&iss));
+    }
+    else
+    {
+        CHECK(ostats.acquisitions == 0);
+        CHECK(istats.chains == 0);
+        CHECK(snapshot.empty());
+    }
+}
+
+TEST_CASE("testing chunked_pistream")
+{
+    SUBCASE("records are handed out whole and exactly once")
+    {
+        unsigned int num_threads = std::thread::hardware_concurrency();
+        num_threads              = num_threads == 0 ? default_num_threads : num_threads;
+        constexpr unsigned int num_records = 20000;
+
+        std::stringstream ss;
+        for (unsigned int i = 0; i < num_records; ++i)
+        {
+            ss << i << ' ' << std::string(i % 13 + 1, '.') << ' ' << i << '\n';
+        }
+
+        eps::chunked_pistream reader{ss, 100};
+        std::vector<std::vector<std::string>> seen(num_threads);
+        std::vector<std::thread> threads;
+        threads.reserve(num_threads);
+        for (unsigned int t = 0; t < num_threads; ++t)
+        {
+            threads.emplace_back(
+                [&reader, &records = seen[t]]()
+                {
+                    while (!go);
+                    eps::pistream_chunk<char> chunk;
+                    while (reader.next(chunk))
+                    {
+                        chunk.for_each_record([&records](std::string_view record) { records.emplace_back(record); });
+                        // Chunks end with a whole record
+                        records.back() += chunk.view().back();
+                    }
+                }
+            );
+        }
+        go = true;
+        for (std::thread& t : threads)
+        {
+            t.join();
+        }
+        go = false;
+
+        std::vector<unsigned int> all;
+        for (const std::vector<std::string>& records : seen)
+        {
+            for (std::size_t r = 0; r < records.size(); ++r)
+            {
+                std::istringstream iss{records[r]};
+                unsigned int i = 0, k = 0;
+                std::string dots;
+                iss >> i >> dots >> k;
+                CHECK(i == k);
+                CHECK(dots == std::string(i % 13 + 1, '.'));
+                CHECK((all.empty() || r == 0 || i > all.back())); // Records of a thread keep their order
+                all.push_back(i);
+            }
+        }
+        std::sort(all.begin(), all.end());
+        REQUIRE(all.size() == num_records);
+        for (unsigned int i = 0; i < num_records; ++i)
+        {
+            CHECK(all[i] == i);
+        }
+        CHECK(ss.eof());
+    }
+
+    SUBCASE("long and unterminated records")
+    {
+        const std::string long_record(1000, 'x');
+        std::stringstream ss{"a;b;" + long_record + ";c;d"};
+        eps::chunked_pistream reader{ss, 4, ';'};
+
+        std::vector<std::string> chunks;
+        std::vector<std::string> records;
+        eps::pistream_chunk<char> chunk;
+        while (reader.next(chunk))
+        {
+            chunks.emplace_back(chunk.view());
+            chunk.for_each_record([&records](std::string_view record) { records.emplace_back(record); });
+        }
+        CHECK(chunk.empty());
+        CHECK(chunks == std::vector<std::string>{"a;b;", long_record + ";", "c;", "d"});
+        CHECK(records == std::vector<std::string>{"a", "b", long_record, "c", "d"});
+    }
+
+    SUBCASE("chunks outlive the reader")
+    {
+        std::wstringstream ss{L"first\nsecond\n"};
+        eps::pistream_chunk<wchar_t> chunk;
+        {
+            eps::chunked_pistream reader{ss, 6};
+            CHECK(reader.next(chunk));
+        }
+        CHECK(chunk.view() == L"first\n");
+    }
+}
@@ -0,0 +1,312 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "epics/pstream_coro20.hpp"
+
+// Single-threaded executor running posted coroutines on the thread calling run()
+class executor
+{
+public:
+    void post(std::coroutine_handle<> handle)
+    {
+        std::lock_guard<std::mutex> lk{m_mtx};
+        m_queue.push_back(handle);
+    }
+
+    // Resume the posted coroutines until the predicate holds, returns the number of resumed coroutines
+    template<typename Pred>
+    std::size_t run_until(Pred pred)
+    {
+        std::size_t resumed = 0;
+        while (!pred())
+        {
+            std::coroutine_handle<> handle;
+            {
+                std::lock_guard<std::mutex> lk{m_mtx};
+                if (!m_queue.empty())
+                {
+                    handle = m_queue.front();
+                    m_queue.pop_front();
+                }
+            }
+            if (handle)
+            {
+                handle.resume();
+                ++resumed;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+        return resumed;
+    }
+
+private:
+    std::mutex m_mtx;
+    std::deque<std::coroutine_handle<>> m_queue;
+};
+
+// Fire-and-forget coroutine
+struct task
+{
+    struct promise_type
+    {
+        task get_return_object()
+        {
+            return {};
+        }
+
+        std::suspend_never initial_suspend()
+        {
+            return {};
+        }
+
+        std::suspend_never final_suspend() noexcept
+        {
+            return {};
+        }
+
+        void return_void()
+        {}
+
+        void unhandled_exception()
+        {
+            std::terminate();
+        }
+    };
+};
+
+// Holds the lock of a stream while written until released
+struct gate
+{
+    std::atomic<bool>& entered;
+    std::atomic<bool>& open;
+};
+
+std::ostream& operator<<(std::ostream& os, const gate& g)
+{
+    g.entered = true;
+    while (!g.open)
+    {
+        std::this_thread::yield();
+    }
+    return os;
+}
+
+// Input waiting in underflow() until provided, then ending
+class waiting_input: public std::streambuf
+{
+public:
+    void provide(std::string data)
+    {
+        std::lock_guard<std::mutex> lk{m_mtx};
+        m_data     = std::move(data);
+        m_provided = true;
+        m_cv.notify_one();
+    }
+
+protected:
+    int_type underflow() override
+    {
+        std::unique_lock<std::mutex> lk{m_mtx};
+        m_cv.wait(lk, [this]() { return m_provided; });
+        if (m_consumed)
+        {
+            return traits_type::eof();
+        }
+        m_consumed = true;
+        setg(m_data.data(), m_data.data(), m_data.data() + m_data.size());
+        return m_data.empty() ? traits_type::eof() : traits_type::to_int_type(m_data.front());
+    }
+
+private:
+    std::mutex m_mtx;
+    std::condition_variable m_cv;
+    std::string m_data;
+    bool m_provided = false;
+    bool m_consumed = false;
+};
+
+// Input with a first chunk buffered right away, waiting in underflow() for the next chunks until closed
+class chunked_input: public std::streambuf
+{
+public:
+    explicit chunked_input(std::string first): m_chunk{std::move(first)}
+    {
+        setg(m_chunk.data(), m_chunk.data(), m_chunk.data() + m_chunk.size());
+    }
+
+    void provide(std::string data)
+    {
+        std::lock_guard<std::mutex> lk{m_mtx};
+        m_next.push_back(std::move(data));
+        m_cv.notify_one();
+    }
+
+    void close()
+    {
+        std::lock_guard<std::mutex> lk{m_mtx};
+        m_closed = true;
+        m_cv.notify_one();
+    }
+
+protected:
+    int_type underflow() override
+    {
+        std::unique_lock<std::mutex> lk{m_mtx};
+        m_cv.wait(lk, [this]() { return !m_next.empty() || m_closed; });
+        if (m_next.empty())
+        {
+            return traits_type::eof();
+        }
+        m_chunk = std::move(m_next.front());
+        m_next.pop_front();
+        setg(m_chunk.data(), m_chunk.data(), m_chunk.data() + m_chunk.size());
+        return traits_type::to_int_type(m_chunk.front());
+    }
+
+private:
+    std::mutex m_mtx;
+    std::condition_variable m_cv;
+    std::string m_chunk;
+    std::deque<std::string> m_next;
+    bool m_closed = false;
+};
+
+task write_numbers(executor& ex, std::ostream& os, int id, int count, std::atomic<int>& done)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        co_await (eps::async(eps::postream{os}, ex) << id << ' ' << i << ' ' << id << '\n');
+    }
+    ++done;
+}
+
+task read_pairs(executor& ex, std::istream& is, std::vector<std::string>& words, std::atomic<int>& done)
+{
+    std::string key, value;
+    while (co_await (eps::async(eps::pistream{is}, ex) >> key >> value), is)
+    {
+        words.push_back(key + '=' + value);
+    }
+    ++done;
+}
+
+TEST_CASE("testing co_postream")
+{
+    SUBCASE("chains complete right away on a free stream")
+    {
+        executor ex;
+        std::ostringstream oss;
+        std::atomic<int> done = 0;
+        write_numbers(ex, oss, 7, 3, done);
+        CHECK(done == 1);
+        CHECK(oss.str() == "7 0 7\n7 1 7\n7 2 7\n");
+    }
+
+    SUBCASE("coroutines are suspended instead of the thread on a locked stream")
+    {
+        constexpr int num_tasks = 8, count = 20;
+
+        executor ex;
+        std::ostringstream oss;
+        std::atomic<bool> entered = false, open = false;
+        std::thread holder{[&]() { eps::postream{oss} << gate{entered, open}; }};
+        while (!entered);
+
+        std::atomic<int> done = 0;
+        for (int id = 0; id < num_tasks; ++id)
+        {
+            write_numbers(ex, oss, id, count, done);
+        }
+        // Every coroutine is suspended on its first chain while the thread goes on
+        CHECK(done == 0);
+
+        open = true;
+        holder.join();
+        const std::size_t resumed = ex.run_until([&]() { return done == num_tasks; });
+        CHECK(resumed >= num_tasks);
+
+        std::istringstream iss{oss.str()};
+        std::vector<int> next(num_tasks, 0);
+        int id = 0, i = 0, k = 0, lines = 0;
+        while (iss >> id >> i >> k)
+        {
+            REQUIRE(id >= 0);
+            REQUIRE(id < num_tasks);
+            CHECK(id == k);
+            CHECK(i == next[id]++);
+            ++lines;
+        }
+        CHECK(lines == num_tasks * count);
+    }
+}
+
+TEST_CASE("testing co_pistream")
+{
+    SUBCASE("buffered input is read by the worker")
+    {
+        executor ex;
+        std::istringstream iss{"a 1 b 2 c 3"};
+        std::vector<std::string> words;
+        std::atomic<int> done = 0;
+        read_pairs(ex, iss, words, done);
+        CHECK(done == 0);
+        ex.run_until([&]() { return done == 1; });
+        CHECK(words == std::vector<std::string>{"a=1", "b=2", "c=3"});
+    }
+
+    SUBCASE("a token crossing the end of the buffered input doesn't block the awaiting thread")
+    {
+        executor ex;
+        chunked_input input{"k"};
+        std::istream is{&input};
+        std::vector<std::string> words;
+        std::atomic<int> done = 0;
+        read_pairs(ex, is, words, done);
+        CHECK(done == 0);
+        input.provide(" v");
+        input.close();
+        ex.run_until([&]() { return done == 1; });
+        CHECK(words == std::vector<std::string>{"k=v"});
+    }
+
+    SUBCASE("a read waiting for input doesn't hold up other streams")
+    {
+        executor ex;
+        waiting_input input;
+        std::istream is{&input};
+        std::vector<std::string> words;
+        std::atomic<int> read_done = 0;
+        read_pairs(ex, is, words, read_done);
+        CHECK(read_done == 0);
+
+        std::ostringstream oss;
+        std::atomic<bool> entered = false, open = false;
+        std::thread holder{[&]() { eps::postream{oss} << gate{entered, open}; }};
+        while (!entered);
+        std::atomic<int> write_done = 0;
+        write_numbers(ex, oss, 1, 1, write_done);
+        CHECK(write_done == 0);
+        open = true;
+        holder.join();
+        ex.run_until([&]() { return write_done == 1; });
+        CHECK(oss.str() == "1 0 1\n");
+        CHECK(read_done == 0);
+
+        input.provide("k v");
+        ex.run_until([&]() { return read_done == 1; });
+        CHECK(words == std::vector<std::string>{"k=v"});
+    }
+}
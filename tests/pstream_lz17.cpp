@@ -0,0 +1,146 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <atomic>
+#include <cstdint>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "epics/pstream_lz17.hpp"
+
+constexpr unsigned int default_num_threads = 5;
+
+std::atomic<bool> go = false;
+
+std::string decompress(const std::string& compressed)
+{
+    std::istringstream source{compressed, std::ios_base::in | std::ios_base::binary};
+    eps::lz_istream lz{source};
+    std::ostringstream oss;
+    oss << lz.rdbuf();
+    return oss.str();
+}
+
+TEST_CASE("testing lz_ostream")
+{
+    SUBCASE("messages of concurrent threads are compressed and read back whole")
+    {
+        unsigned int num_threads = std::thread::hardware_concurrency();
+        num_threads              = num_threads == 0 ? default_num_threads : num_threads;
+        constexpr unsigned int messages_per_thread = 2000;
+
+        std::stringstream file{std::ios_base::in | std::ios_base::out | std::ios_base::binary};
+        std::uint64_t raw_size = 0, compressed_size = 0;
+        {
+            eps::lz_ostream lz{file, 4096};
+            std::vector<std::thread> threads;
+            threads.reserve(num_threads);
+            for (unsigned int i = 0; i < num_threads; ++i)
+            {
+                threads.emplace_back(
+                    [i, postream = eps::postream{lz}]() mutable
+                    {
+                        while (!go);
+                        for (unsigned int j = 0; j < messages_per_thread; ++j)
+                        {
+                            postream << "request " << i << ' ' << j << " handled in " << j % 97 << " us\n";
+                        }
+                    }
+                );
+            }
+            go = true;
+            for (std::thread& t : threads)
+            {
+                t.join();
+            }
+            go = false;
+
+            lz.flush();
+            raw_size        = lz.buffer().raw_size();
+            compressed_size = lz.buffer().compressed_size();
+        }
+        CHECK(compressed_size == file.str().size() - 8);
+        CHECK(compressed_size * 3 < raw_size);
+
+        eps::lz_istream lz{file};
+        eps::pistream pistream{lz};
+        std::vector<unsigned int> next(num_threads, 0);
+        std::string request, handled, in, us;
+        unsigned int i = 0, j = 0, k = 0;
+        for (unsigned int line = 0; line < num_threads * messages_per_thread; ++line)
+        {
+            pistream >> request >> i >> j >> handled >> in >> k >> us;
+            REQUIRE(lz);
+            REQUIRE(i < num_threads);
+            CHECK(j == next[i]++);
+            CHECK(k == j % 97);
+        }
+        pistream >> request;
+        CHECK(lz.eof());
+    }
+
+    SUBCASE("incompressible blocks are stored as they are")
+    {
+        std::mt19937 gen{42};
+        std::string data(10000, '\0');
+        for (char& c : data)
+        {
+            c = static_cast<char>(gen());
+        }
+
+        std::ostringstream file{std::ios_base::out | std::ios_base::binary};
+        {
+            eps::lz_ostream lz{file, 1024};
+            lz << data;
+        }
+        CHECK(file.str().size() < data.size() + 8 + 10 * 12 + 12);
+        CHECK(decompress(file.str()) == data);
+    }
+
+    SUBCASE("complete blocks of a stream cut short are readable")
+    {
+        std::string data;
+        for (unsigned int i = 0; i < 1000; ++i)
+        {
+            data += "line " + std::to_string(i) + '\n';
+        }
+
+        std::ostringstream file{std::ios_base::out | std::ios_base::binary};
+        {
+            eps::lz_ostream lz{file, 1024};
+            lz << data;
+        }
+        const std::string decompressed = decompress(file.str());
+        CHECK(decompressed == data);
+
+        // Cut in the middle of every block in turn
+        std::size_t pos = 8, blocks = 0;
+        const std::string full = file.str();
+        while (pos < full.size())
+        {
+            const std::size_t payload_size = eps::__lz_load32(full.data() + pos + 4);
+            const std::string cut          = decompress(full.substr(0, pos + 12 + payload_size / 2));
+            CHECK(cut == data.substr(0, blocks * 1024));
+            pos += 12 + payload_size;
+            ++blocks;
+        }
+        CHECK(blocks == (data.size() + 1023) / 1024);
+
+        // A damaged block ends the stream as well
+        std::string damaged = full;
+        damaged[8 + 12 + 3] ^= 0x55;
+        CHECK(decompress(damaged).empty());
+    }
+
+    SUBCASE("other streams are rejected")
+    {
+        std::istringstream source{"plain text"};
+        eps::lz_istream lz{source};
+        std::string word;
+        CHECK_FALSE(lz >> word);
+        CHECK(lz.bad());
+    }
+}
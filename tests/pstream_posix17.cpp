@@ -0,0 +1,537 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <complex>
+#include <memory>
+#include <cstdint>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "epics/pstream_posix17.hpp"
+
+constexpr unsigned int default_num_threads = 5;
+
+std::atomic<bool> go = false;
+
+std::string read_all(int fd)
+{
+    std::string result;
+    char buf[4096];
+    ssize_t n;
+    while ((n = ::read(fd, buf, sizeof(buf))) > 0)
+    {
+        result.append(buf, static_cast<std::size_t>(n));
+    }
+    return result;
+}
+
+TEST_CASE("testing fd_sink")
+{
+    SUBCASE("formats like std::ostream")
+    {
+        int fds[2];
+        REQUIRE(::pipe(fds) == 0);
+
+        const std::string str = "str";
+        const std::complex<double> c{1.5, -2};
+        std::ostringstream expected;
+        expected << 42 << ' ' << -7L << ' ' << 18446744073709551615ULL << ' ' << true << ' ' << 'c' << ' ' << 3.25
+                 << ' ' << 1e-10 << ' ' << 1.0 / 3 << ' ' << 123456789.0 << ' ' << 2.5f << ' ' << "literal" << ' '
+                 << str << ' ' << c;
+        {
+            eps::fd_sink sink{fds[1], 16};
+            eps::postream{sink} << 42 << ' ' << -7L << ' ' << 18446744073709551615ULL << ' ' << true << ' ' << 'c'
+                                << ' ' << 3.25 << ' ' << 1e-10 << ' ' << 1.0 / 3 << ' ' << 123456789.0 << ' ' << 2.5f
+                                << ' ' << "literal" << ' ' << str << ' ' << c;
+            CHECK(sink.good());
+        }
+        ::close(fds[1]);
+
+        CHECK(read_all(fds[0]) == expected.str());
+        ::close(fds[0]);
+    }
+
+    SUBCASE("honors manipulators")
+    {
+        int fds[2];
+        REQUIRE(::pipe(fds) == 0);
+
+        std::ostringstream expected;
+        expected << std::hex << 255 << ' ' << std::setprecision(2) << 3.14159 << ' ' << std::setw(5) << "ab"
+                 << std::boolalpha << true << std::endl
+                 << std::dec << std::setprecision(6) << std::noboolalpha << 255 << ' ' << 3.14159 << std::endl;
+        {
+            eps::fd_sink sink{fds[1], 64, eps::fd_buffering::full};
+            eps::postream{sink} << std::hex << 255 << ' ' << std::setprecision(2) << 3.14159 << ' ' << std::setw(5)
+                                << "ab" << std::boolalpha << true << '\n';
+            sink << std::dec << std::setprecision(6) << std::noboolalpha << 255 << ' ' << 3.14159 << std::endl;
+            CHECK(sink.good());
+            // std::endl has written the buffer out
+            ::close(fds[1]);
+            CHECK(read_all(fds[0]) == expected.str());
+        }
+        ::close(fds[0]);
+    }
+
+    SUBCASE("messages stay whole")
+    {
+        unsigned int num_threads = std::thread::hardware_concurrency();
+        num_threads              = num_threads == 0 ? default_num_threads : num_threads;
+
+        int fds[2];
+        REQUIRE(::pipe(fds) == 0);
+        std::string output;
+        std::thread reader{[&]() { output = read_all(fds[0]); }};
+        {
+            eps::fd_sink sink{fds[1], 64, eps::fd_buffering::full};
+            std::vector<std::thread> threads;
+            threads.reserve(num_threads);
+            for (unsigned int i = 0; i < num_threads; ++i)
+            {
+                threads.emplace_back(
+                    [i, psink = eps::postream{sink}]() mutable
+                    {
+                        while (!go);
+                        for (unsigned int j = 0; j < 100; ++j)
+                        {
+                            psink << i << ' ' << std::string(i % 7 * 10 + 1, '.') << ' ' << i << '\n';
+                        }
+                    }
+                );
+            }
+            go = true;
+            for (std::thread& t : threads)
+            {
+                t.join();
+            }
+            go = false;
+        }
+        ::close(fds[1]);
+        reader.join();
+        ::close(fds[0]);
+
+        std::istringstream iss{output};
+        std::size_t lines = 0;
+        unsigned int i = 0, k = 0;
+        std::string dots;
+        while (iss >> i >> dots >> k)
+        {
+            ++lines;
+            CHECK(i == k);
+            CHECK(dots == std::string(i % 7 * 10 + 1, '.'));
+        }
+        CHECK(lines == num_threads * 100);
+    }
+}
+
+TEST_CASE("testing mmap_ring_sink")
+{
+    char path[] = "/tmp/epics_ring_XXXXXX";
+    const int fd = ::mkstemp(path);
+    REQUIRE(fd >= 0);
+    ::close(fd);
+
+    SUBCASE("messages are read back in order")
+    {
+        {
+            eps::mmap_ring_sink sink{path, 4096};
+            eps::sink_postream psink{sink};
+            for (int i = 0; i < 10; ++i)
+            {
+                psink << "message " << i << ' ' << 0.5 << '\n';
+            }
+            sink.sync();
+            // 16 bytes of record words and 14 characters padded to 16
+            CHECK(sink.written() == 10 * 32);
+        }
+
+        std::string expected;
+        for (int i = 0; i < 10; ++i)
+        {
+            expected += "message " + std::to_string(i) + " 0.5\n";
+        }
+        CHECK(eps::read_mmap_ring(path) == expected);
+
+        // Reopening a ring of the same capacity appends to it
+        {
+            eps::mmap_ring_sink sink{path, 4096};
+            eps::sink_postream{sink} << "message 10 0.5\n";
+        }
+        CHECK(eps::read_mmap_ring(path) == expected + "message 10 0.5\n");
+
+        // Reopening it with another capacity starts it over
+        {
+            eps::mmap_ring_sink sink{path, 2048};
+            CHECK(sink.written() == 0);
+        }
+        CHECK(eps::read_mmap_ring(path).empty());
+    }
+
+    SUBCASE("uncommitted messages are skipped")
+    {
+        {
+            eps::mmap_ring_sink sink{path, 4096};
+            eps::sink_postream psink{sink};
+            for (int i = 0; i < 10; ++i)
+            {
+                psink << "message " << i << ' ' << 0.5 << '\n';
+            }
+        }
+
+        // Clear the commit word of the fourth record as if its writer had crashed before committing it
+        const int ring = ::open(path, O_WRONLY);
+        REQUIRE(ring >= 0);
+        const std::uint64_t zero = 0;
+        REQUIRE(::pwrite(ring, &zero, sizeof(zero), 64 + 3 * 32) == static_cast<ssize_t>(sizeof(zero)));
+        ::close(ring);
+
+        std::string expected;
+        for (int i = 0; i < 10; ++i)
+        {
+            if (i != 3)
+            {
+                expected += "message " + std::to_string(i) + " 0.5\n";
+            }
+        }
+        CHECK(eps::read_mmap_ring(path) == expected);
+    }
+
+    SUBCASE("only the newest messages are kept after wrapping around")
+    {
+        {
+            eps::mmap_ring_sink sink{path, 1000};
+            eps::sink_postream psink{sink};
+            for (int i = 0; i < 1000; ++i)
+            {
+                psink << i << '\n';
+            }
+        }
+
+        // Records of the 4-character messages take 24 bytes
+        const std::string contents = eps::read_mmap_ring(path);
+        CHECK(contents.size() <= 1000 / 24 * 4);
+        CHECK(contents.size() > 1000 / 24 * 4 - 8);
+        std::istringstream iss{contents};
+        int i = 0, expected = 0, lines = 0;
+        iss >> expected;
+        iss.seekg(0);
+        while (iss >> i)
+        {
+            CHECK(i == expected++);
+            ++lines;
+        }
+        CHECK(expected == 1000);
+        CHECK(lines > 20);
+    }
+
+    SUBCASE("messages stay whole")
+    {
+        unsigned int num_threads = std::thread::hardware_concurrency();
+        num_threads              = num_threads == 0 ? default_num_threads : num_threads;
+
+        {
+            eps::mmap_ring_sink sink{path, 1 << 20};
+            std::vector<std::thread> threads;
+            threads.reserve(num_threads);
+            for (unsigned int i = 0; i < num_threads; ++i)
+            {
+                threads.emplace_back(
+                    [i, psink = eps::sink_postream{sink}]() mutable
+                    {
+                        while (!go);
+                        for (unsigned int j = 0; j < 100; ++j)
+                        {
+                            psink << i << ' ' << std::string(i % 7 * 10 + 1, '.') << ' ' << i << '\n';
+                        }
+                    }
+                );
+            }
+            go = true;
+            for (std::thread& t : threads)
+            {
+                t.join();
+            }
+            go = false;
+        }
+
+        std::istringstream iss{eps::read_mmap_ring(path)};
+        std::size_t lines = 0;
+        unsigned int i = 0, k = 0;
+        std::string dots;
+        while (iss >> i >> dots >> k)
+        {
+            ++lines;
+            CHECK(i == k);
+            CHECK(dots == std::string(i % 7 * 10 + 1, '.'));
+        }
+        CHECK(lines == num_threads * 100);
+    }
+
+    SUBCASE("other files are rejected")
+    {
+        const int other = ::open(path, O_WRONLY | O_TRUNC);
+        REQUIRE(other >= 0);
+        const std::string garbage(200, 'x');
+        REQUIRE(::write(other, garbage.data(), garbage.size()) == static_cast<ssize_t>(garbage.size()));
+        ::close(other);
+
+        CHECK_THROWS_AS(eps::read_mmap_ring(path), std::runtime_error);
+        CHECK_THROWS_AS(eps::read_mmap_ring("/nonexistent/epics.ring"), std::system_error);
+    }
+
+    ::unlink(path);
+}
+
+std::vector<std::string> read_rotated(const std::string& path)
+{
+    std::vector<std::string> files;
+    for (unsigned int n = 0;; ++n)
+    {
+        const int fd = ::open((path + '.' + std::to_string(n)).c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return files;
+        }
+        files.push_back(read_all(fd));
+        ::close(fd);
+    }
+}
+
+void remove_rotated(const std::string& path, const std::vector<std::string>& files)
+{
+    for (std::size_t n = 0; n < files.size(); ++n)
+    {
+        ::unlink((path + '.' + std::to_string(n)).c_str());
+    }
+}
+
+TEST_CASE("testing rotating_file_sink")
+{
+    char dir[] = "/tmp/epics_rotate_XXXXXX";
+    REQUIRE(::mkdtemp(dir) != nullptr);
+    const std::string path = std::string{dir} + "/app.log";
+
+    SUBCASE("messages stay whole and ordered across the files")
+    {
+        unsigned int num_threads = std::thread::hardware_concurrency();
+        num_threads              = num_threads == 0 ? default_num_threads : num_threads;
+        constexpr unsigned int messages_per_thread = 500;
+
+        std::uint64_t rotations = 0;
+        {
+            eps::rotating_file_sink sink{path, 1000};
+            std::vector<std::thread> threads;
+            threads.reserve(num_threads);
+            for (unsigned int i = 0; i < num_threads; ++i)
+            {
+                threads.emplace_back(
+                    [i, psink = eps::sink_postream{sink}]() mutable
+                    {
+                        while (!go);
+                        for (unsigned int j = 0; j < messages_per_thread; ++j)
+                        {
+                            psink << i << ' ' << j << ' ' << std::string(i % 7 * 10 + 1, '.') << '\n';
+                            if (j % 50 == 0)
+                            {
+                                // Give the background thread time to open the next file
+                                std::this_thread::sleep_for(std::chrono::milliseconds{1});
+                            }
+                        }
+                    }
+                );
+            }
+            go = true;
+            for (std::thread& t : threads)
+            {
+                t.join();
+            }
+            go = false;
+            CHECK(sink.good());
+            rotations = sink.rotations();
+        }
+
+        const std::vector<std::string> files = read_rotated(path);
+        CHECK(files.size() == rotations + 1);
+        CHECK(files.size() > 1);
+        std::vector<unsigned int> next(num_threads, 0);
+        for (const std::string& file : files)
+        {
+            REQUIRE_FALSE(file.empty());
+            CHECK(file.back() == '\n');
+            std::istringstream iss{file};
+            unsigned int i = 0, j = 0;
+            std::string dots;
+            while (iss >> i >> j >> dots)
+            {
+                REQUIRE(i < num_threads);
+                CHECK(j == next[i]++);
+                CHECK(dots == std::string(i % 7 * 10 + 1, '.'));
+            }
+        }
+        for (unsigned int i = 0; i < num_threads; ++i)
+        {
+            CHECK(next[i] == messages_per_thread);
+        }
+        remove_rotated(path, files);
+    }
+
+    SUBCASE("files are rotated by age and by hand, existing files are kept")
+    {
+        const int existing = ::open((path + ".0").c_str(), O_WRONLY | O_CREAT, 0644);
+        REQUIRE(existing >= 0);
+        REQUIRE(::write(existing, "old\n", 4) == 4);
+        ::close(existing);
+
+        {
+            eps::rotating_file_sink sink{path, 0, std::chrono::milliseconds{100}};
+            eps::sink_postream psink{sink};
+            CHECK(sink.current_path() == path + ".1");
+
+            // An empty file isn't rotated out
+            CHECK_FALSE(sink.rotate());
+            std::this_thread::sleep_for(std::chrono::milliseconds{250});
+            CHECK(sink.rotations() == 0);
+
+            psink << "first\n";
+            std::this_thread::sleep_for(std::chrono::milliseconds{250});
+            CHECK(sink.rotations() == 1);
+            CHECK(sink.current_path() == path + ".2");
+
+            psink << "second\n";
+            for (int i = 0; i < 100 && !sink.rotate(); ++i)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds{10});
+            }
+            psink << "third\n";
+            sink.sync();
+        }
+
+        const std::vector<std::string> files = read_rotated(path);
+        CHECK(files == std::vector<std::string>{"old\n", "first\n", "second\n", "third\n"});
+        remove_rotated(path, files);
+    }
+
+    SUBCASE("the first file has to be created")
+    {
+        CHECK_THROWS_AS(eps::rotating_file_sink(std::string{dir} + "/missing/app.log", 1000), std::system_error);
+    }
+
+    ::rmdir(dir);
+}
+
+// Forks the writers of a shared-memory ring and collects their lines, returns the number of lines collected
+std::size_t collect_from_children(const std::string& name, std::size_t capacity, unsigned int children, bool lossless)
+{
+    constexpr unsigned int messages_per_child = 2000;
+
+    eps::shm_ring_istream collector{name, capacity};
+    // Holds the ring open until all the children have exited, so it doesn't end between two of them
+    auto keeper = std::make_unique<eps::shm_ring_sink>(name);
+
+    std::vector<pid_t> pids;
+    for (unsigned int i = 0; i < children; ++i)
+    {
+        const pid_t pid = ::fork();
+        if (pid == 0)
+        {
+            {
+                eps::shm_ring_sink sink{name};
+                eps::sink_postream psink{sink};
+                for (unsigned int j = 0; j < messages_per_child; ++j)
+                {
+                    psink << i << ' ' << j << ' ' << std::string(i % 7 * 10 + 1, '.') << '\n';
+                }
+            }
+            ::_exit(0);
+        }
+        pids.push_back(pid);
+    }
+    REQUIRE(std::find(pids.begin(), pids.end(), -1) == pids.end());
+
+    std::thread reaper{[&]()
+                       {
+                           for (pid_t pid : pids)
+                           {
+                               ::waitpid(pid, nullptr, 0);
+                           }
+                           keeper.reset();
+                       }};
+
+    std::vector<unsigned int> next(children, 0);
+    std::size_t lines = 0;
+    bool ordered      = true, whole = true;
+    unsigned int i = 0, j = 0;
+    std::string dots;
+    while (collector >> i >> j >> dots)
+    {
+        ++lines;
+        whole   = whole && i < children && dots == std::string(i % 7 * 10 + 1, '.');
+        ordered = ordered && i < children && (lossless ? j == next[i] : j >= next[i]);
+        next[i % children] = j + 1;
+    }
+    reaper.join();
+
+    CHECK(collector.eof());
+    CHECK(whole);
+    CHECK(ordered);
+    CHECK(lines + collector.buffer().dropped() == children * messages_per_child);
+    return lines;
+}
+
+TEST_CASE("testing shm_ring_sink")
+{
+    const std::string name = "/epics_shm_" + std::to_string(::getpid());
+
+    SUBCASE("messages of several processes are collected whole")
+    {
+        CHECK(collect_from_children(name, 1 << 22, 4, true) == 4 * 2000);
+    }
+
+    SUBCASE("messages that don't fit are dropped and counted")
+    {
+        CHECK(collect_from_children(name, 512, 4, false) > 0);
+    }
+
+    SUBCASE("long runs of empty messages are skipped")
+    {
+        eps::shm_ring_istream collector{name, 1 << 22};
+        {
+            eps::shm_ring_sink sink{name};
+            for (int i = 0; i < 200000; ++i)
+            {
+                sink.write_message("", 0);
+            }
+            sink.write_message("last\n", 5);
+        }
+        std::string line;
+        CHECK(std::getline(collector, line));
+        CHECK(line == "last");
+        CHECK_FALSE(std::getline(collector, line));
+    }
+
+    SUBCASE("other shared memory objects are rejected")
+    {
+        CHECK_THROWS_AS(eps::shm_ring_sink{name}, std::system_error);
+
+        const int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT, 0600);
+        REQUIRE(fd >= 0);
+        REQUIRE(::ftruncate(fd, 4096) == 0);
+        ::close(fd);
+        CHECK_THROWS_AS(eps::shm_ring_sink{name}, std::runtime_error);
+        ::shm_unlink(name.c_str());
+    }
+}